@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+/**
+ * Aligned allocation and leading dimension (column stride) selection for matrix storage.
+ */
+namespace MatrixKernels {
+
+/// Every matrix buffer starts on a cache line boundary.
+const size_t kMatrixAlignment = 64;
+/// Size of a cache line, the unit of padding added to aliasing column strides.
+const size_t kCacheLine = 64;
+/// Padded columns are rounded up to a whole SIMD register, so each column starts aligned.
+#ifdef __AVX__
+const size_t kColumnAlignment = 32;
+#else
+const size_t kColumnAlignment = 16;
+#endif
+/// A row walk with a column stride that is a multiple of this many bytes only touches
+/// 1/8th of the L1 sets (and even fewer for larger powers of two), so such strides get
+/// an extra cache line of padding. Columns shorter than this are never padded.
+const size_t kAliasingStride = 512;
+
+/// Matrices whose storage fits in this many bytes keep their elements inside the Matrix
+/// object itself and never allocate. Enough for a 6x6 matrix of doubles.
+const size_t kSmallBufferBytes = 288;
+
+/// Allocates bytes of memory aligned to the given power of two. Throws std::bad_alloc on failure.
+inline void * AlignedAllocate(size_t bytes, size_t alignment = kMatrixAlignment) {
+    if(bytes == 0)
+        bytes = alignment;
+    void * ptr = nullptr;
+#ifdef _MSC_VER
+    ptr = _aligned_malloc(bytes, alignment);
+#else
+    if(posix_memalign(&ptr, alignment, bytes) != 0)
+        ptr = nullptr;
+#endif
+    if(ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+/// Releases memory obtained from AlignedAllocate.
+inline void AlignedFree(void * ptr) {
+#ifdef _MSC_VER
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/// Returns true if ptr sits on a multiple of alignment bytes.
+inline bool IsAligned(const void * ptr, size_t alignment) {
+    return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+}
+
+/// When false, matrices are packed with their leading dimension equal to their row count.
+/// Mostly useful to measure what the padding buys.
+inline bool & PadLeadingDimension() {
+    static bool pad = true;
+    return pad;
+}
+
+/// Picks the distance, in elements, between the starts of consecutive columns of a new matrix.
+template <class T>
+size_t LeadingDimension(size_t rows, size_t cols) {
+    //A single column is never walked across, and short columns aren't worth the extra memory.
+    if(!PadLeadingDimension() || cols == 1 || rows * sizeof(T) < kAliasingStride || kColumnAlignment % sizeof(T) != 0)
+        return rows;
+
+    const size_t perRegister = kColumnAlignment / sizeof(T);
+    size_t ld = (rows + perRegister - 1) / perRegister * perRegister;
+    if((ld * sizeof(T)) % kAliasingStride == 0)
+        ld += kCacheLine / sizeof(T);
+    return ld;
+}
+
+} // namespace MatrixKernels
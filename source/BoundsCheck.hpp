@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+
+/**
+ * Bounds checking policy for element access.
+ *
+ * Get() always checks its coordinates and GetUnchecked() never does. operator() checks
+ * only when BoundsChecking<T> says so, which by default follows MATRIX_CHECK_BOUNDS:
+ * on in debug builds, off when NDEBUG is defined. Define MATRIX_CHECK_BOUNDS to 0 or 1
+ * before including any matrix header to override it for the whole program, or specialize
+ * BoundsChecking for one element type, e.g.
+ *
+ *     template <> struct BoundsChecking<double> : std::true_type {};
+ *
+ * Without the branch and the exception path, loops over operator() can be vectorized.
+ */
+#ifndef MATRIX_CHECK_BOUNDS
+#ifdef NDEBUG
+#define MATRIX_CHECK_BOUNDS 0
+#else
+#define MATRIX_CHECK_BOUNDS 1
+#endif
+#endif
+
+/// Whether operator() checks coordinates on matrices of T.
+template <class T>
+struct BoundsChecking
+{
+    static const bool value = MATRIX_CHECK_BOUNDS != 0;
+};
+
+namespace MatrixKernels {
+
+/// Throws if (row, col) lies outside a rows x cols matrix.
+inline void CheckBounds(size_t row, size_t col, size_t rows, size_t cols) {
+    if(row >= rows || col >= cols)
+        throw std::invalid_argument( "Invalid element coordinate" );
+}
+
+} // namespace MatrixKernels
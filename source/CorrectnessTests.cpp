@@ -1,9 +1,21 @@
 #include <iostream>
 #include <Eigen/Dense>
 #include <utility>
+#include <numeric>
+#include <algorithm>
 #include "Matrix.hpp"
+#include "DualMatrix.hpp"
+#include "TiledMatrix.hpp"
+#include "MatrixReductions.hpp"
+#include "MatrixMath.hpp"
+#include "MatrixScans.hpp"
+#include "MatrixPermutations.hpp"
+#include "MatrixConcatenation.hpp"
 #include "Rand.hpp"
 
+//Short matrices check every access, whatever the build type, to exercise the per-type policy.
+template <> struct BoundsChecking<short> : std::true_type {};
+
 using namespace std;
 template<class T>
 using EigenMat = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
@@ -11,10 +23,10 @@ using EigenMat = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
 std::mt19937 Rand::sBase( time(nullptr) );
 std::uniform_real_distribution<float> Rand::sFloatGen;
 
-template<class T>
-bool operator==(const Matrix<T> & A, const EigenMat<T> & B);
-template<class T>
-bool operator==(const Matrix<T> & A, const Matrix<T> & B);
+template<class T, class Order>
+bool operator==(const Matrix<T, Order> & A, const EigenMat<T> & B);
+template<class T, class LhsOrder, class RhsOrder>
+bool operator==(const Matrix<T, LhsOrder> & A, const Matrix<T, RhsOrder> & B);
 
 template <class T>
 pair<Matrix<T>, EigenMat<T>> generateRandomMatrix(int rowsMin = 10, int rowsMax = 20, int colsMin = 10, int colsMax = 20);
@@ -22,6 +34,30 @@ pair<Matrix<T>, EigenMat<T>> generateRandomMatrix(int rowsMin = 10, int rowsMax
 template <class T> void testMultiplication();
 void testInvalidMultiplication();
 template <class T> void testTranspose();
+template <class T> void testBlockedTranspose();
+template <class T> void testInPlaceTranspose();
+template <class T> void testTransposeView();
+template <class T> void testStreamingStores();
+template <class T> void testBatchTranspose();
+template <class T> void testMoveAndAssignment();
+template <class T> void testMemoryResources();
+template <class T> void testUninitializedConstruction();
+template <class T> void testHugePages();
+template <class T> void testSmallMatrices();
+template <class T> void testStorageOrders();
+template <class T> void testTiledMatrix();
+template <class T> void testSubMatrixViews();
+template <class T> void testCopyOnWrite();
+template <class T> void testExternalStorage();
+template <class T> void testBoundsChecking();
+template <class T> void testIterators();
+template <class T> void testExpressionTemplates();
+template <class T> void testElementwiseOperations();
+template <class T> void testReductions();
+template <class T> void testTranscendentals();
+template <class T> void testScans();
+template <class T> void testGatherScatter();
+template <class T> void testConcatenation();
 
 char sectionBreak[81];
 
@@ -95,120 +131,2159 @@ int main() {
     cout << "Testing the transpose function of a LONG matrix" << endl;
     testTranspose<long>();
     cout << sectionBreak;
-    
-	return 0;
-}
 
-template<class T>
-void testMultiplication() {
-    // Make the matrices.
-    auto pair1 = generateRandomMatrix<T>(100, 200, 100, 200);
-    Matrix<T> & A = pair1.first;
-    EigenMat<T> & ACond = pair1.second;
-    
-    auto pair2 = generateRandomMatrix<T>(A.Columns(), A.Columns(), 100, 200);
-    Matrix<T> & B = pair2.first;
-    EigenMat<T> & BCond = pair2.second;
-    
-    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
-    cout <<"\tMatrix B is " << B.Rows() << 'x' << B.Columns() << endl;
-    
-    cout << endl;
-    
-    //Multiply!
-    try {
-        Matrix<T> result = A * B;
-        EigenMat<T> resultsCond = ACond * BCond;
-        
-        //Verify.
-        if(result == resultsCond)
-            cout << "\tTest Passed!" << endl;
-        else
-            cout << "\tTest Failed!" << endl;
-    } catch(std::invalid_argument & e) {
-        cout << e.what() << endl;
-        return;
-    }
-}
+    cout << "Testing the blocked transpose of a large FLOAT matrix" << endl;
+    testBlockedTranspose<float>();
+    cout << sectionBreak;
 
-void testInvalidMultiplication() {
-    cout << "Number of columns in matrix A "
-        << "is not equal " << endl;
-    cout << "to the number of columns in B, so multiplication is not possible." << endl;
+    cout << "Testing the blocked transpose of a large DOUBLE matrix" << endl;
+    testBlockedTranspose<double>();
+    cout << sectionBreak;
 
-    // Make the matrices.    
-    auto pair1 = generateRandomMatrix<float>(50, 100, 50, 100);
-    Matrix<float> & A = pair1.first;
-    
-    auto pair2 = generateRandomMatrix<float>(A.Columns() - 1, A.Columns() - 1, 50, 100);
-    Matrix<float> & B = pair2.first;
+    cout << "Testing the blocked transpose of a large INT matrix" << endl;
+    testBlockedTranspose<int>();
+    cout << sectionBreak;
 
-    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
-    cout <<"\tMatrix B is " << B.Rows() << 'x' << B.Columns() << endl;
+    cout << "Testing the blocked transpose of a large UNSIGNED INT matrix" << endl;
+    testBlockedTranspose<unsigned int>();
+    cout << sectionBreak;
 
-    try {
-        A * B;
-        cout << "Test Failed!" << endl; // if this line is reached, error.
+    cout << "Testing the blocked transpose of a large SHORT matrix" << endl;
+    testBlockedTranspose<short>();
+    cout << sectionBreak;
 
-    } catch (std::invalid_argument & e) {
-        cout << "\tSuccessfully caught exception" << endl;
-        cout << endl;
-        cout << "\tTest Passed!" << endl;
-    }
-}
+    cout << "Testing the blocked transpose of a large LONG matrix" << endl;
+    testBlockedTranspose<long>();
+    cout << sectionBreak;
 
-template<class T>
-void testTranspose() {
-    auto pair = generateRandomMatrix<T>(50, 100, 50, 100);
-    Matrix<T> & A = pair.first;
+    cout << "Testing the in-place transpose of FLOAT matrices" << endl;
+    testInPlaceTranspose<float>();
+    cout << sectionBreak;
 
-    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout << "Testing the in-place transpose of DOUBLE matrices" << endl;
+    testInPlaceTranspose<double>();
+    cout << sectionBreak;
 
-    auto B = A.Transpose();
-    cout << "\tThe transpose of Matrix A is " << B.Rows() << "x" << B.Columns() << endl;
+    cout << "Testing the in-place transpose of INT matrices" << endl;
+    testInPlaceTranspose<int>();
+    cout << sectionBreak;
 
-    cout << endl;
+    cout << "Testing the in-place transpose of UNSIGNED INT matrices" << endl;
+    testInPlaceTranspose<unsigned int>();
+    cout << sectionBreak;
 
-    //Verify transpose
-    for (int i = 0; i < A.Rows(); ++i)
-    {
-        for (int j = 0; j < A.Columns(); ++j)
-        {
-            if(A(i,j) != B(j, i)) {
-                cout << "\tTest Failed!" << endl;
-                return;
-            }
-        }
-    }
+    cout << "Testing the in-place transpose of SHORT matrices" << endl;
+    testInPlaceTranspose<short>();
+    cout << sectionBreak;
 
-    //Transpose of a transpose should give back the original matrix.
-    auto C = B.Transpose();
-    if(!(A == C)) {
-        cout << "\tTest Failed!" << endl;
-        cout << "\tTranspose of a transpose should yield the orignal matrix." << endl;
-        return;
-    }
+    cout << "Testing the in-place transpose of LONG matrices" << endl;
+    testInPlaceTranspose<long>();
+    cout << sectionBreak;
 
-    cout << "\tTest Passed!" << endl;
-}
+    cout << "Testing multiplication through lazy transpose views of FLOAT matrices" << endl;
+    testTransposeView<float>();
+    cout << sectionBreak;
 
+    cout << "Testing multiplication through lazy transpose views of DOUBLE matrices" << endl;
+    testTransposeView<double>();
+    cout << sectionBreak;
 
-template<class T>
-bool operator==(const Matrix<T> & A, const EigenMat<T> & B) {
-    for (size_t i = 0; i < A.Rows(); i++) {
-        for (size_t j = 0; j < A.Columns(); j++) {
-            if(A(i, j) != B(i, j)) {
-                std::cout << "\tFailing value: " << A(i,j) << endl;
-                std::cout << "\tCorrect value: " << B(i,j) << endl;
-                return false;
-            }
-        }
-    }
-    return true;
-}
+    cout << "Testing multiplication through lazy transpose views of INT matrices" << endl;
+    testTransposeView<int>();
+    cout << sectionBreak;
 
-template<class T>
-bool operator==(const Matrix<T> & A, const Matrix<T> & B) {
+    cout << "Testing multiplication through lazy transpose views of UNSIGNED INT matrices" << endl;
+    testTransposeView<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing multiplication through lazy transpose views of SHORT matrices" << endl;
+    testTransposeView<short>();
+    cout << sectionBreak;
+
+    cout << "Testing multiplication through lazy transpose views of LONG matrices" << endl;
+    testTransposeView<long>();
+    cout << sectionBreak;
+
+    cout << "Testing streaming-store fill, copy & transpose of FLOAT matrices" << endl;
+    testStreamingStores<float>();
+    cout << sectionBreak;
+
+    cout << "Testing streaming-store fill, copy & transpose of DOUBLE matrices" << endl;
+    testStreamingStores<double>();
+    cout << sectionBreak;
+
+    cout << "Testing streaming-store fill, copy & transpose of INT matrices" << endl;
+    testStreamingStores<int>();
+    cout << sectionBreak;
+
+    cout << "Testing streaming-store fill, copy & transpose of UNSIGNED INT matrices" << endl;
+    testStreamingStores<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing streaming-store fill, copy & transpose of SHORT matrices" << endl;
+    testStreamingStores<short>();
+    cout << sectionBreak;
+
+    cout << "Testing streaming-store fill, copy & transpose of LONG matrices" << endl;
+    testStreamingStores<long>();
+    cout << sectionBreak;
+
+    cout << "Testing the batched transpose of small FLOAT matrices" << endl;
+    testBatchTranspose<float>();
+    cout << sectionBreak;
+
+    cout << "Testing the batched transpose of small DOUBLE matrices" << endl;
+    testBatchTranspose<double>();
+    cout << sectionBreak;
+
+    cout << "Testing the batched transpose of small INT matrices" << endl;
+    testBatchTranspose<int>();
+    cout << sectionBreak;
+
+    cout << "Testing the batched transpose of small UNSIGNED INT matrices" << endl;
+    testBatchTranspose<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing the batched transpose of small SHORT matrices" << endl;
+    testBatchTranspose<short>();
+    cout << sectionBreak;
+
+    cout << "Testing the batched transpose of small LONG matrices" << endl;
+    testBatchTranspose<long>();
+    cout << sectionBreak;
+
+    cout << "Testing move, assignment & buffer reuse of FLOAT matrices" << endl;
+    testMoveAndAssignment<float>();
+    cout << sectionBreak;
+
+    cout << "Testing move, assignment & buffer reuse of DOUBLE matrices" << endl;
+    testMoveAndAssignment<double>();
+    cout << sectionBreak;
+
+    cout << "Testing move, assignment & buffer reuse of INT matrices" << endl;
+    testMoveAndAssignment<int>();
+    cout << sectionBreak;
+
+    cout << "Testing move, assignment & buffer reuse of UNSIGNED INT matrices" << endl;
+    testMoveAndAssignment<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing move, assignment & buffer reuse of SHORT matrices" << endl;
+    testMoveAndAssignment<short>();
+    cout << sectionBreak;
+
+    cout << "Testing move, assignment & buffer reuse of LONG matrices" << endl;
+    testMoveAndAssignment<long>();
+    cout << sectionBreak;
+
+    cout << "Testing arena & pool allocation of FLOAT matrices" << endl;
+    testMemoryResources<float>();
+    cout << sectionBreak;
+
+    cout << "Testing arena & pool allocation of DOUBLE matrices" << endl;
+    testMemoryResources<double>();
+    cout << sectionBreak;
+
+    cout << "Testing arena & pool allocation of INT matrices" << endl;
+    testMemoryResources<int>();
+    cout << sectionBreak;
+
+    cout << "Testing arena & pool allocation of UNSIGNED INT matrices" << endl;
+    testMemoryResources<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing arena & pool allocation of SHORT matrices" << endl;
+    testMemoryResources<short>();
+    cout << sectionBreak;
+
+    cout << "Testing arena & pool allocation of LONG matrices" << endl;
+    testMemoryResources<long>();
+    cout << sectionBreak;
+
+    cout << "Testing uninitialized construction & parallel fill and copy of FLOAT matrices" << endl;
+    testUninitializedConstruction<float>();
+    cout << sectionBreak;
+
+    cout << "Testing uninitialized construction & parallel fill and copy of DOUBLE matrices" << endl;
+    testUninitializedConstruction<double>();
+    cout << sectionBreak;
+
+    cout << "Testing uninitialized construction & parallel fill and copy of INT matrices" << endl;
+    testUninitializedConstruction<int>();
+    cout << sectionBreak;
+
+    cout << "Testing uninitialized construction & parallel fill and copy of UNSIGNED INT matrices" << endl;
+    testUninitializedConstruction<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing uninitialized construction & parallel fill and copy of SHORT matrices" << endl;
+    testUninitializedConstruction<short>();
+    cout << sectionBreak;
+
+    cout << "Testing uninitialized construction & parallel fill and copy of LONG matrices" << endl;
+    testUninitializedConstruction<long>();
+    cout << sectionBreak;
+
+    cout << "Testing huge page backing of large FLOAT matrices" << endl;
+    testHugePages<float>();
+    cout << sectionBreak;
+
+    cout << "Testing huge page backing of large DOUBLE matrices" << endl;
+    testHugePages<double>();
+    cout << sectionBreak;
+
+    cout << "Testing huge page backing of large INT matrices" << endl;
+    testHugePages<int>();
+    cout << sectionBreak;
+
+    cout << "Testing huge page backing of large UNSIGNED INT matrices" << endl;
+    testHugePages<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing huge page backing of large SHORT matrices" << endl;
+    testHugePages<short>();
+    cout << sectionBreak;
+
+    cout << "Testing huge page backing of large LONG matrices" << endl;
+    testHugePages<long>();
+    cout << sectionBreak;
+
+    cout << "Testing inline storage of tiny FLOAT matrices" << endl;
+    testSmallMatrices<float>();
+    cout << sectionBreak;
+
+    cout << "Testing inline storage of tiny DOUBLE matrices" << endl;
+    testSmallMatrices<double>();
+    cout << sectionBreak;
+
+    cout << "Testing inline storage of tiny INT matrices" << endl;
+    testSmallMatrices<int>();
+    cout << sectionBreak;
+
+    cout << "Testing inline storage of tiny UNSIGNED INT matrices" << endl;
+    testSmallMatrices<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing inline storage of tiny SHORT matrices" << endl;
+    testSmallMatrices<short>();
+    cout << sectionBreak;
+
+    cout << "Testing inline storage of tiny LONG matrices" << endl;
+    testSmallMatrices<long>();
+    cout << sectionBreak;
+
+    cout << "Testing row-major, column-major & dual storage of FLOAT matrices" << endl;
+    testStorageOrders<float>();
+    cout << sectionBreak;
+
+    cout << "Testing row-major, column-major & dual storage of DOUBLE matrices" << endl;
+    testStorageOrders<double>();
+    cout << sectionBreak;
+
+    cout << "Testing row-major, column-major & dual storage of INT matrices" << endl;
+    testStorageOrders<int>();
+    cout << sectionBreak;
+
+    cout << "Testing row-major, column-major & dual storage of UNSIGNED INT matrices" << endl;
+    testStorageOrders<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing row-major, column-major & dual storage of SHORT matrices" << endl;
+    testStorageOrders<short>();
+    cout << sectionBreak;
+
+    cout << "Testing row-major, column-major & dual storage of LONG matrices" << endl;
+    testStorageOrders<long>();
+    cout << sectionBreak;
+
+    cout << "Testing tiled & Z-order storage of FLOAT matrices" << endl;
+    testTiledMatrix<float>();
+    cout << sectionBreak;
+
+    cout << "Testing tiled & Z-order storage of DOUBLE matrices" << endl;
+    testTiledMatrix<double>();
+    cout << sectionBreak;
+
+    cout << "Testing tiled & Z-order storage of INT matrices" << endl;
+    testTiledMatrix<int>();
+    cout << sectionBreak;
+
+    cout << "Testing tiled & Z-order storage of UNSIGNED INT matrices" << endl;
+    testTiledMatrix<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing tiled & Z-order storage of SHORT matrices" << endl;
+    testTiledMatrix<short>();
+    cout << sectionBreak;
+
+    cout << "Testing tiled & Z-order storage of LONG matrices" << endl;
+    testTiledMatrix<long>();
+    cout << sectionBreak;
+
+    cout << "Testing block, range & slice views of FLOAT matrices" << endl;
+    testSubMatrixViews<float>();
+    cout << sectionBreak;
+
+    cout << "Testing block, range & slice views of DOUBLE matrices" << endl;
+    testSubMatrixViews<double>();
+    cout << sectionBreak;
+
+    cout << "Testing block, range & slice views of INT matrices" << endl;
+    testSubMatrixViews<int>();
+    cout << sectionBreak;
+
+    cout << "Testing block, range & slice views of UNSIGNED INT matrices" << endl;
+    testSubMatrixViews<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing block, range & slice views of SHORT matrices" << endl;
+    testSubMatrixViews<short>();
+    cout << sectionBreak;
+
+    cout << "Testing block, range & slice views of LONG matrices" << endl;
+    testSubMatrixViews<long>();
+    cout << sectionBreak;
+
+    cout << "Testing copy-on-write sharing of FLOAT matrices" << endl;
+    testCopyOnWrite<float>();
+    cout << sectionBreak;
+
+    cout << "Testing copy-on-write sharing of DOUBLE matrices" << endl;
+    testCopyOnWrite<double>();
+    cout << sectionBreak;
+
+    cout << "Testing copy-on-write sharing of INT matrices" << endl;
+    testCopyOnWrite<int>();
+    cout << sectionBreak;
+
+    cout << "Testing copy-on-write sharing of UNSIGNED INT matrices" << endl;
+    testCopyOnWrite<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing copy-on-write sharing of SHORT matrices" << endl;
+    testCopyOnWrite<short>();
+    cout << sectionBreak;
+
+    cout << "Testing copy-on-write sharing of LONG matrices" << endl;
+    testCopyOnWrite<long>();
+    cout << sectionBreak;
+
+    cout << "Testing FLOAT matrices over borrowed & adopted memory" << endl;
+    testExternalStorage<float>();
+    cout << sectionBreak;
+
+    cout << "Testing DOUBLE matrices over borrowed & adopted memory" << endl;
+    testExternalStorage<double>();
+    cout << sectionBreak;
+
+    cout << "Testing INT matrices over borrowed & adopted memory" << endl;
+    testExternalStorage<int>();
+    cout << sectionBreak;
+
+    cout << "Testing UNSIGNED INT matrices over borrowed & adopted memory" << endl;
+    testExternalStorage<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing SHORT matrices over borrowed & adopted memory" << endl;
+    testExternalStorage<short>();
+    cout << sectionBreak;
+
+    cout << "Testing LONG matrices over borrowed & adopted memory" << endl;
+    testExternalStorage<long>();
+    cout << sectionBreak;
+
+    cout << "Testing checked & unchecked access to FLOAT matrices" << endl;
+    testBoundsChecking<float>();
+    cout << sectionBreak;
+
+    cout << "Testing checked & unchecked access to DOUBLE matrices" << endl;
+    testBoundsChecking<double>();
+    cout << sectionBreak;
+
+    cout << "Testing checked & unchecked access to INT matrices" << endl;
+    testBoundsChecking<int>();
+    cout << sectionBreak;
+
+    cout << "Testing checked & unchecked access to UNSIGNED INT matrices" << endl;
+    testBoundsChecking<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing checked & unchecked access to SHORT matrices" << endl;
+    testBoundsChecking<short>();
+    cout << sectionBreak;
+
+    cout << "Testing checked & unchecked access to LONG matrices" << endl;
+    testBoundsChecking<long>();
+    cout << sectionBreak;
+
+    cout << "Testing iterators & row/column ranges of FLOAT matrices" << endl;
+    testIterators<float>();
+    cout << sectionBreak;
+
+    cout << "Testing iterators & row/column ranges of DOUBLE matrices" << endl;
+    testIterators<double>();
+    cout << sectionBreak;
+
+    cout << "Testing iterators & row/column ranges of INT matrices" << endl;
+    testIterators<int>();
+    cout << sectionBreak;
+
+    cout << "Testing iterators & row/column ranges of UNSIGNED INT matrices" << endl;
+    testIterators<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing iterators & row/column ranges of SHORT matrices" << endl;
+    testIterators<short>();
+    cout << sectionBreak;
+
+    cout << "Testing iterators & row/column ranges of LONG matrices" << endl;
+    testIterators<long>();
+    cout << sectionBreak;
+
+    cout << "Testing expression templates on FLOAT matrices" << endl;
+    testExpressionTemplates<float>();
+    cout << sectionBreak;
+
+    cout << "Testing expression templates on DOUBLE matrices" << endl;
+    testExpressionTemplates<double>();
+    cout << sectionBreak;
+
+    cout << "Testing expression templates on INT matrices" << endl;
+    testExpressionTemplates<int>();
+    cout << sectionBreak;
+
+    cout << "Testing expression templates on UNSIGNED INT matrices" << endl;
+    testExpressionTemplates<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing expression templates on SHORT matrices" << endl;
+    testExpressionTemplates<short>();
+    cout << sectionBreak;
+
+    cout << "Testing expression templates on LONG matrices" << endl;
+    testExpressionTemplates<long>();
+    cout << sectionBreak;
+
+    cout << "Testing elementwise operations & broadcasting on FLOAT matrices" << endl;
+    testElementwiseOperations<float>();
+    cout << sectionBreak;
+
+    cout << "Testing elementwise operations & broadcasting on DOUBLE matrices" << endl;
+    testElementwiseOperations<double>();
+    cout << sectionBreak;
+
+    cout << "Testing elementwise operations & broadcasting on INT matrices" << endl;
+    testElementwiseOperations<int>();
+    cout << sectionBreak;
+
+    cout << "Testing elementwise operations & broadcasting on UNSIGNED INT matrices" << endl;
+    testElementwiseOperations<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing elementwise operations & broadcasting on SHORT matrices" << endl;
+    testElementwiseOperations<short>();
+    cout << sectionBreak;
+
+    cout << "Testing elementwise operations & broadcasting on LONG matrices" << endl;
+    testElementwiseOperations<long>();
+    cout << sectionBreak;
+
+    cout << "Testing reductions of FLOAT matrices" << endl;
+    testReductions<float>();
+    cout << sectionBreak;
+
+    cout << "Testing reductions of DOUBLE matrices" << endl;
+    testReductions<double>();
+    cout << sectionBreak;
+
+    cout << "Testing reductions of INT matrices" << endl;
+    testReductions<int>();
+    cout << sectionBreak;
+
+    cout << "Testing reductions of UNSIGNED INT matrices" << endl;
+    testReductions<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing reductions of SHORT matrices" << endl;
+    testReductions<short>();
+    cout << sectionBreak;
+
+    cout << "Testing reductions of LONG matrices" << endl;
+    testReductions<long>();
+    cout << sectionBreak;
+
+    cout << "Testing exp, log, tanh, sigmoid and sqrt of FLOAT matrices" << endl;
+    testTranscendentals<float>();
+    cout << sectionBreak;
+
+    cout << "Testing exp, log, tanh, sigmoid and sqrt of DOUBLE matrices" << endl;
+    testTranscendentals<double>();
+    cout << sectionBreak;
+
+    cout << "Testing exp, log, tanh, sigmoid and sqrt of INT matrices" << endl;
+    testTranscendentals<int>();
+    cout << sectionBreak;
+
+    cout << "Testing exp, log, tanh, sigmoid and sqrt of UNSIGNED INT matrices" << endl;
+    testTranscendentals<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing exp, log, tanh, sigmoid and sqrt of SHORT matrices" << endl;
+    testTranscendentals<short>();
+    cout << sectionBreak;
+
+    cout << "Testing exp, log, tanh, sigmoid and sqrt of LONG matrices" << endl;
+    testTranscendentals<long>();
+    cout << sectionBreak;
+
+    cout << "Testing scans and integral images of FLOAT matrices" << endl;
+    testScans<float>();
+    cout << sectionBreak;
+
+    cout << "Testing scans and integral images of DOUBLE matrices" << endl;
+    testScans<double>();
+    cout << sectionBreak;
+
+    cout << "Testing scans and integral images of INT matrices" << endl;
+    testScans<int>();
+    cout << sectionBreak;
+
+    cout << "Testing scans and integral images of UNSIGNED INT matrices" << endl;
+    testScans<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing scans and integral images of SHORT matrices" << endl;
+    testScans<short>();
+    cout << sectionBreak;
+
+    cout << "Testing scans and integral images of LONG matrices" << endl;
+    testScans<long>();
+    cout << sectionBreak;
+
+    cout << "Testing gathers, scatters and permutations of FLOAT matrices" << endl;
+    testGatherScatter<float>();
+    cout << sectionBreak;
+
+    cout << "Testing gathers, scatters and permutations of DOUBLE matrices" << endl;
+    testGatherScatter<double>();
+    cout << sectionBreak;
+
+    cout << "Testing gathers, scatters and permutations of INT matrices" << endl;
+    testGatherScatter<int>();
+    cout << sectionBreak;
+
+    cout << "Testing gathers, scatters and permutations of UNSIGNED INT matrices" << endl;
+    testGatherScatter<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing gathers, scatters and permutations of SHORT matrices" << endl;
+    testGatherScatter<short>();
+    cout << sectionBreak;
+
+    cout << "Testing gathers, scatters and permutations of LONG matrices" << endl;
+    testGatherScatter<long>();
+    cout << sectionBreak;
+
+    cout << "Testing stacking, splitting and reshaping of FLOAT matrices" << endl;
+    testConcatenation<float>();
+    cout << sectionBreak;
+
+    cout << "Testing stacking, splitting and reshaping of DOUBLE matrices" << endl;
+    testConcatenation<double>();
+    cout << sectionBreak;
+
+    cout << "Testing stacking, splitting and reshaping of INT matrices" << endl;
+    testConcatenation<int>();
+    cout << sectionBreak;
+
+    cout << "Testing stacking, splitting and reshaping of UNSIGNED INT matrices" << endl;
+    testConcatenation<unsigned int>();
+    cout << sectionBreak;
+
+    cout << "Testing stacking, splitting and reshaping of SHORT matrices" << endl;
+    testConcatenation<short>();
+    cout << sectionBreak;
+
+    cout << "Testing stacking, splitting and reshaping of LONG matrices" << endl;
+    testConcatenation<long>();
+    cout << sectionBreak;
+    
+	return 0;
+}
+
+template<class T>
+void testMultiplication() {
+    // Make the matrices.
+    auto pair1 = generateRandomMatrix<T>(100, 200, 100, 200);
+    Matrix<T> & A = pair1.first;
+    EigenMat<T> & ACond = pair1.second;
+    
+    auto pair2 = generateRandomMatrix<T>(A.Columns(), A.Columns(), 100, 200);
+    Matrix<T> & B = pair2.first;
+    EigenMat<T> & BCond = pair2.second;
+    
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout <<"\tMatrix B is " << B.Rows() << 'x' << B.Columns() << endl;
+    
+    cout << endl;
+    
+    //Multiply!
+    try {
+        Matrix<T> result = A * B;
+        EigenMat<T> resultsCond = ACond * BCond;
+        
+        //Verify.
+        if(result == resultsCond)
+            cout << "\tTest Passed!" << endl;
+        else
+            cout << "\tTest Failed!" << endl;
+    } catch(std::invalid_argument & e) {
+        cout << e.what() << endl;
+        return;
+    }
+}
+
+void testInvalidMultiplication() {
+    cout << "Number of columns in matrix A "
+        << "is not equal " << endl;
+    cout << "to the number of columns in B, so multiplication is not possible." << endl;
+
+    // Make the matrices.    
+    auto pair1 = generateRandomMatrix<float>(50, 100, 50, 100);
+    Matrix<float> & A = pair1.first;
+    
+    auto pair2 = generateRandomMatrix<float>(A.Columns() - 1, A.Columns() - 1, 50, 100);
+    Matrix<float> & B = pair2.first;
+
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout <<"\tMatrix B is " << B.Rows() << 'x' << B.Columns() << endl;
+
+    try {
+        A * B;
+        cout << "Test Failed!" << endl; // if this line is reached, error.
+
+    } catch (std::invalid_argument & e) {
+        cout << "\tSuccessfully caught exception" << endl;
+        cout << endl;
+        cout << "\tTest Passed!" << endl;
+    }
+}
+
+template<class T>
+void testTranspose() {
+    auto pair = generateRandomMatrix<T>(50, 100, 50, 100);
+    Matrix<T> & A = pair.first;
+
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+
+    auto B = A.Transpose();
+    cout << "\tThe transpose of Matrix A is " << B.Rows() << "x" << B.Columns() << endl;
+
+    cout << endl;
+
+    //Verify transpose
+    for (int i = 0; i < A.Rows(); ++i)
+    {
+        for (int j = 0; j < A.Columns(); ++j)
+        {
+            if(A(i,j) != B(j, i)) {
+                cout << "\tTest Failed!" << endl;
+                return;
+            }
+        }
+    }
+
+    //Transpose of a transpose should give back the original matrix.
+    auto C = B.Transpose();
+    if(!(A == C)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tTranspose of a transpose should yield the orignal matrix." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testBlockedTranspose() {
+    //Large enough to go through the recursive, multi-threaded path,
+    //and random so the edges don't line up with the SIMD blocks.
+    auto pair = generateRandomMatrix<T>(500, 1100, 500, 1100);
+    Matrix<T> & A = pair.first;
+    EigenMat<T> expected = pair.second.transpose();
+
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout << endl;
+
+    auto B = A.Transpose();
+    if(B.Rows() != A.Columns() || B.Columns() != A.Rows() || !(B == expected)) {
+        cout << "\tTest Failed!" << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+
+template<class T>
+void testInPlaceTranspose() {
+    //A square matrix, a random rectangle, and a rectangle whose sides share a large common factor.
+    int size = Rand::randInt(100, 300);
+    int factor = Rand::randInt(5, 40);
+    pair<Matrix<T>, EigenMat<T>> cases[] = {
+        generateRandomMatrix<T>(size, size, size, size),
+        generateRandomMatrix<T>(100, 400, 100, 400),
+        generateRandomMatrix<T>(12 * factor, 12 * factor, 8 * factor, 8 * factor)
+    };
+
+    for(auto & test : cases) {
+        Matrix<T> & A = test.first;
+        EigenMat<T> expected = test.second.transpose();
+        cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+
+        A.TransposeInPlace();
+        if(A.Rows() != static_cast<size_t>(expected.rows()) || A.Columns() != static_cast<size_t>(expected.cols()) || !(A == expected)) {
+            cout << "\tTest Failed!" << endl;
+            return;
+        }
+    }
+
+    cout << endl;
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testTransposeView() {
+    //A and B share their row count, so A^T * B and B^T * A are both valid.
+    auto pair1 = generateRandomMatrix<T>(100, 200, 100, 200);
+    Matrix<T> & A = pair1.first;
+    EigenMat<T> & ACond = pair1.second;
+
+    auto pair2 = generateRandomMatrix<T>(A.Rows(), A.Rows(), 100, 200);
+    Matrix<T> & B = pair2.first;
+    EigenMat<T> & BCond = pair2.second;
+
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout <<"\tMatrix B is " << B.Rows() << 'x' << B.Columns() << endl;
+    cout << endl;
+
+    auto AT = A.TransposeView();
+    if(AT.Rows() != A.Columns() || AT.Columns() != A.Rows() || &AT(0, 1) != &A(1, 0)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tThe view should alias the elements of A." << endl;
+        return;
+    }
+
+    EigenMat<T> ATB = ACond.transpose() * BCond;
+    EigenMat<T> BTA = BCond.transpose() * ACond;
+    EigenMat<T> ATA = ACond.transpose() * ACond;
+    if(!(AT * B == ATB) || !(B.TransposeView() * A == BTA) || !(AT * AT.Transpose() == ATA)) {
+        cout << "\tTest Failed!" << endl;
+        return;
+    }
+
+    //Materializing the view must give the same matrix as the eager transpose.
+    if(!(AT.Materialize() == A.Transpose())) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMaterialized view does not match Transpose()." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testStreamingStores() {
+    //Drop the threshold so that test-sized matrices take the streaming paths.
+    size_t & threshold = MatrixKernels::StreamingStoreThreshold();
+    const size_t previousThreshold = threshold;
+    threshold = 1;
+
+    auto pair = generateRandomMatrix<T>(300, 600, 300, 600);
+    Matrix<T> & A = pair.first;
+    EigenMat<T> expected = pair.second.transpose();
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout << endl;
+
+    bool passed = true;
+    Matrix<T> filled(A.Rows(), A.Columns(), 7);
+    for (size_t i = 0; i < filled.Rows() && passed; i++) {
+        for (size_t j = 0; j < filled.Columns(); j++) {
+            if(filled(i, j) != 7) { passed = false; break; }
+        }
+    }
+    Matrix<T> copy(A);
+    passed = passed && copy == A;
+    passed = passed && A.Transpose() == expected;
+    passed = passed && A.TransposeView().Materialize() == expected;
+
+    threshold = previousThreshold;
+    cout << (passed ? "\tTest Passed!" : "\tTest Failed!") << endl;
+}
+
+template<class T>
+void testBatchTranspose() {
+    //Every fixed-size kernel shape that is exercised, plus shapes that take the generic path.
+    const size_t shapes[][2] = { {4, 4}, {8, 8}, {16, 16}, {32, 32}, {4, 32}, {16, 8}, {5, 7}, {12, 12} };
+    const size_t count = Rand::randInt(100, 200);
+
+    for(auto & shape : shapes) {
+        const size_t rows = shape[0], cols = shape[1], size = rows * cols;
+        std::vector<T> src(count * size), dst(count * size);
+        for(auto & value : src)
+            value = static_cast<T>(Rand::randInt(100));
+
+        MatrixKernels::BatchTranspose(src.data(), dst.data(), count, rows, cols);
+
+        for(size_t b = 0; b < count; b++) {
+            for(size_t i = 0; i < rows; i++) {
+                for(size_t j = 0; j < cols; j++) {
+                    if(src[b * size + i + j * rows] != dst[b * size + j + i * cols]) {
+                        cout << "\tTest Failed!" << endl;
+                        cout << "\tMismatch for " << rows << 'x' << cols << " matrices." << endl;
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    cout << "\tBatches of " << count << " matrices" << endl;
+    cout << endl;
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testMoveAndAssignment() {
+    auto pair = generateRandomMatrix<T>(100, 300, 100, 300);
+    Matrix<T> & A = pair.first;
+    EigenMat<T> & ACond = pair.second;
+    cout <<"\tMatrix A is " << A.Rows() << 'x' << A.Columns() << endl;
+    cout << endl;
+
+    //Moving hands over the buffer and leaves the source empty.
+    Matrix<T> copy(A);
+    const T * buffer = &copy(0, 0);
+    Matrix<T> moved(std::move(copy));
+    if(&moved(0, 0) != buffer || copy.Rows() != 0 || copy.Capacity() != 0 || !(moved == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMove construction copied or lost the data." << endl;
+        return;
+    }
+
+    //Assigning a matrix of the same shape reuses the existing buffer.
+    Matrix<T> assigned(A.Rows(), A.Columns());
+    buffer = &assigned(0, 0);
+    assigned = A;
+    if(&assigned(0, 0) != buffer || !(assigned == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tCopy assignment reallocated or lost the data." << endl;
+        return;
+    }
+
+    Matrix<T> small(2, 3, 1);
+    swap(small, moved);
+    moved = std::move(small);
+    if(!(moved == ACond) || small.Rows() != 0) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tSwap or move assignment lost the data." << endl;
+        return;
+    }
+
+    //Results written into existing matrices.
+    Matrix<T> result(A.Rows(), A.Columns());
+    buffer = &result(0, 0);
+    A.TransposeInto(result);
+    EigenMat<T> ATA = ACond.transpose() * ACond;
+    if(&result(0, 0) != buffer || !(result == EigenMat<T>(ACond.transpose()))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tTransposeInto reallocated or gave the wrong result." << endl;
+        return;
+    }
+    result.AssignProduct(result.View(), A.View());
+    if(!(result == ATA)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tAssignProduct gave the wrong result when aliasing an operand." << endl;
+        return;
+    }
+
+    //Shrinking keeps the buffer; reshaping keeps the column-major element order.
+    const size_t capacity = A.Capacity();
+    buffer = &A(0, 0);
+    A.Resize(A.Rows() / 2, A.Columns());
+    if(A.Capacity() != capacity || &A(0, 0) != buffer) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tResize reallocated a big enough buffer." << endl;
+        return;
+    }
+    for (size_t i = 0; i < A.Rows(); i++) {
+        for (size_t j = 0; j < A.Columns(); j++)
+            A(i, j) = static_cast<T>(i + j * A.Rows());
+    }
+    const size_t count = A.Rows() * A.Columns();
+    A.Reshape(A.Columns(), A.Rows());
+    A.Reshape(1, count);
+    for (size_t j = 0; j < count; j++) {
+        if(A(0, j) != static_cast<T>(j)) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tReshape changed the element order." << endl;
+            return;
+        }
+    }
+
+    //Reshaping a contiguous matrix only changes its dimensions, and leaves it contiguous.
+    Matrix<T> tall(1024, 1000, Uninitialized);
+    tall.Reshape(1, tall.Rows() * tall.Columns());
+    buffer = &tall(0, 0);
+    tall.Reshape(1024, 1000);
+    const bool kept = tall.IsContiguous() && tall.LeadingDimension() == 1024;
+    tall.Reshape(1000, 1024);
+    if(!kept || !tall.IsContiguous() || tall.LeadingDimension() != 1000 || &tall(0, 0) != buffer) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tReshape moved the elements of a contiguous matrix." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testMemoryResources() {
+    auto pair1 = generateRandomMatrix<T>(50, 150, 50, 150);
+    auto pair2 = generateRandomMatrix<T>(pair1.first.Columns(), pair1.first.Columns(), 50, 150);
+    EigenMat<T> expected = pair1.second * pair2.second;
+    cout <<"\tMatrix A is " << pair1.first.Rows() << 'x' << pair1.first.Columns() << endl;
+    cout <<"\tMatrix B is " << pair2.first.Rows() << 'x' << pair2.first.Columns() << endl;
+    cout << endl;
+
+    //Everything made inside the scope, products included, comes from the arena.
+    MatrixKernels::ArenaResource arena(64 * 1024);
+    for(int request = 0; request < 3; request++) {
+        {
+            MatrixKernels::ScopedResource scope(&arena);
+            Matrix<T> A(pair1.first), B(pair2.first);
+            Matrix<T> C = A * B;
+            if(C.Resource() != &arena || !(C == expected)) {
+                cout << "\tTest Failed!" << endl;
+                cout << "\tProduct was not allocated from the arena or is wrong." << endl;
+                return;
+            }
+        }
+        if(MatrixKernels::DefaultResource() != MatrixKernels::HeapMemory()) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tThe default resource was not restored." << endl;
+            return;
+        }
+        //After the first request the arena has all the memory it needs.
+        const size_t reserved = arena.BytesReserved();
+        arena.Reset();
+        if(request > 0 && arena.BytesReserved() != reserved) {
+            cout << "\tTest Failed!" << endl;
+            return;
+        }
+    }
+
+    //A freed block of the same size comes straight back out of the pool.
+    MatrixKernels::PoolResource pool;
+    const T * first;
+    {
+        Matrix<T> A(pair1.first.View(), &pool);
+        first = &A(0, 0);
+    }
+    Matrix<T> A(pair1.first.View(), &pool);
+    Matrix<T> C(1, 1, 0, MatrixKernels::PerThreadPool());
+    C.AssignProduct(A.View(), pair2.first.View());
+    if(&A(0, 0) != first || !(A == pair1.second) || !(C == expected)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tPool did not reuse the freed block or lost data." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testUninitializedConstruction() {
+    //Large enough for the fill and copy to be split over all the threads.
+    const size_t rows = Rand::randInt(1000, 1200);
+    const size_t columns = Rand::randInt(1000, 1200);
+    cout <<"\tMatrix A is " << rows << 'x' << columns << endl;
+    cout << endl;
+
+    Matrix<T> A(rows, columns, 3);
+    Matrix<T> uninitialized(rows, columns, Uninitialized);
+    if(uninitialized.Rows() != rows || uninitialized.Columns() != columns || uninitialized.LeadingDimension() != A.LeadingDimension()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tUninitialized matrix has the wrong shape." << endl;
+        return;
+    }
+
+    for (size_t j = 0; j < columns; j++) {
+        for (size_t i = 0; i < rows; i++) {
+            if(A(i, j) != 3) {
+                cout << "\tTest Failed!" << endl;
+                cout << "\tParallel fill missed element (" << i << ", " << j << ")." << endl;
+                return;
+            }
+            uninitialized(i, j) = static_cast<T>(i + j);
+        }
+    }
+
+    Matrix<T> copy(uninitialized);
+    if(!(copy == uninitialized) || !(uninitialized.Transpose() == uninitialized.TransposeView().Materialize())) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel copy or transpose lost data." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testHugePages() {
+    //At least 2 MB for every element type, so the buffers are mapped in huge pages.
+    auto pair = generateRandomMatrix<T>(1100, 1200, 1100, 1200);
+    EigenMat<T> expected = pair.second.transpose();
+    cout <<"\tMatrix A is " << pair.first.Rows() << 'x' << pair.first.Columns() << endl;
+    cout << endl;
+
+    //Explicit mode falls back to transparent huge pages when no hugetlbfs pages are reserved.
+    MatrixKernels::HugePageResource transparent, hugetlb(MatrixKernels::HugePageMode::Explicit);
+    MatrixKernels::HugePageResource * resources[] = { &transparent, &hugetlb };
+    for(auto resource : resources) {
+        Matrix<T> A(pair.first.View(), resource);
+        Matrix<T> AT(1, 1, 0, resource);
+        A.TransposeInto(AT);
+#ifdef __linux__
+        const bool aligned = MatrixKernels::IsAligned(&A(0, 0), MatrixKernels::kHugePageSize);
+#else
+        const bool aligned = true; // No mmap, so the resource just passes through to the heap.
+#endif
+        if(!aligned || !(A == pair.second) || !(AT == expected)) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tHuge page backed matrix is misaligned or wrong." << endl;
+            return;
+        }
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testSmallMatrices() {
+    for(int size = 2; size <= 6; size++) {
+        auto pair1 = generateRandomMatrix<T>(size, size, size, size);
+        auto pair2 = generateRandomMatrix<T>(size, size, 1, 6);
+        Matrix<T> & A = pair1.first;
+        Matrix<T> & B = pair2.first;
+
+        Matrix<T> AB = A * B;
+        Matrix<T> moved(std::move(AB));
+        Matrix<T> ATB = A.TransposeView() * B;
+        swap(moved, ATB);
+        B.TransposeInPlace();
+        if(!A.IsInline() || !moved.IsInline() || AB.Rows() != 0
+           || !(ATB == EigenMat<T>(pair1.second * pair2.second))
+           || !(moved == EigenMat<T>(pair1.second.transpose() * pair2.second))
+           || !(B == EigenMat<T>(pair2.second.transpose()))) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tWrong result or heap storage for a " << size << 'x' << size << " matrix." << endl;
+            return;
+        }
+    }
+
+    //Growing past the small buffer moves to the heap, and assigning a small matrix back reuses it.
+    Matrix<T> grown(2, 2, 1);
+    grown.Resize(50, 50);
+    Matrix<T> small(3, 3, 2);
+    grown = small;
+    if(grown.IsInline() || !(grown == small)) {
+        cout << "\tTest Failed!" << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T>
+void testStorageOrders() {
+    auto pair1 = generateRandomMatrix<T>(50, 150, 50, 150);
+    auto pair2 = generateRandomMatrix<T>(pair1.first.Columns(), pair1.first.Columns(), 50, 150);
+    EigenMat<T> & ACond = pair1.second;
+    EigenMat<T> & BCond = pair2.second;
+    EigenMat<T> expected = ACond * BCond;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout <<"\tMatrix B is " << BCond.rows() << 'x' << BCond.cols() << endl;
+    cout << endl;
+
+    const Matrix<T, ColumnMajor> & A = pair1.first;
+    const Matrix<T, ColumnMajor> & B = pair2.first;
+    Matrix<T, RowMajor> ARow(A.View()), BRow(B.View());
+    if(!(ARow == ACond) || ARow.View().ColumnStride() != 1) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tRow-major copy does not match." << endl;
+        return;
+    }
+
+    //Every combination of operand and result orders.
+    bool passed = A * B == expected && A * BRow == expected && ARow * B == expected && ARow * BRow == expected;
+    passed = passed && Multiply<RowMajor, T>(A.View(), B.View()) == expected && Multiply<RowMajor, T>(ARow.View(), B.View()) == expected;
+    passed = passed && Multiply<RowMajor, T>(A.View(), BRow.View()) == expected && Multiply<RowMajor, T>(ARow.View(), BRow.View()) == expected;
+    if(!passed) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tProduct of mixed storage orders is wrong." << endl;
+        return;
+    }
+
+    //Transposes stay in the same order.
+    Matrix<T, RowMajor> ATRow = ARow.Transpose();
+    ARow.TransposeInPlace();
+    if(!(ATRow == EigenMat<T>(ACond.transpose())) || !(ARow == ATRow)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tRow-major transpose is wrong." << endl;
+        return;
+    }
+
+    //Both copies of a dual matrix stay in sync and serve either side of a product.
+    DualMatrix<T> ADual(A), BDual(BRow);
+    ADual.Set(0, 0, ADual(0, 0));
+    if(!(ADual * BDual == expected) || !(ADual * B == expected) || !(A * BDual == expected)
+       || !(ADual.RowMajorMatrix() == ADual.ColumnMajorMatrix())) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tDual storage product is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testTiledMatrix() {
+    auto pair1 = generateRandomMatrix<T>(50, 150, 50, 150);
+    auto pair2 = generateRandomMatrix<T>(pair1.first.Columns(), pair1.first.Columns(), 50, 150);
+    EigenMat<T> & ACond = pair1.second;
+    EigenMat<T> & BCond = pair2.second;
+    EigenMat<T> expected = ACond * BCond;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout <<"\tMatrix B is " << BCond.rows() << 'x' << BCond.cols() << endl;
+    cout << endl;
+
+    const Matrix<T> & A = pair1.first;
+    const Matrix<T> & B = pair2.first;
+    const TileOrder orders[] = { TileOrder::ColumnMajor, TileOrder::RowMajor, TileOrder::Morton };
+    for(TileOrder order : orders) {
+        //Round trip through tiled storage, from either standard layout.
+        TiledMatrix<T> ATiled(A.View(), order);
+        TiledMatrix<T, 16> BTiled(Matrix<T, RowMajor>(B.View()).View(), order);
+        if(!(ATiled.ToMatrix() == ACond) || !(ATiled.template ToMatrix<RowMajor>() == ACond) || !(BTiled.ToMatrix() == BCond)) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tConversion to or from tiled storage is wrong." << endl;
+            return;
+        }
+
+        //Element access lands in the right tile, including the padded edge tiles.
+        const size_t lastRow = A.Rows() - 1, lastCol = A.Columns() - 1;
+        if(ATiled(lastRow, lastCol) != A(lastRow, lastCol) || ATiled(33, 1) != A(33, 1) || ATiled(1, 40) != A(1, 40)) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tElement access into tiled storage is wrong." << endl;
+            return;
+        }
+        ATiled(lastRow, 0) = T(7);
+        if(ATiled.ToMatrix()(lastRow, 0) != T(7)) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tWrite into tiled storage is lost." << endl;
+            return;
+        }
+        ATiled(lastRow, 0) = A(lastRow, 0);
+
+        //Tile-native kernels, with edge tiles on every side.
+        TiledMatrix<T, 16> ATiled16(A.View(), order);
+        if(!(ATiled.Transpose().ToMatrix() == EigenMat<T>(ACond.transpose())) || !((ATiled16 * BTiled).ToMatrix() == expected)) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tTiled transpose or product is wrong." << endl;
+            return;
+        }
+    }
+
+    //Like Matrix copies, copies allocate from the default resource, not the source's.
+    MatrixKernels::PoolResource pool;
+    const TiledMatrix<T> pooled(A.View(), TileOrder::Morton, &pool);
+    const TiledMatrix<T> copy(pooled);
+    if(copy.Resource() != MatrixKernels::DefaultResource() || !(copy.ToMatrix() == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tCopy of tiled storage does not allocate from the default resource." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testSubMatrixViews() {
+    auto pair1 = generateRandomMatrix<T>(50, 150, 50, 150);
+    auto pair2 = generateRandomMatrix<T>(pair1.first.Columns(), pair1.first.Columns(), 50, 150);
+    EigenMat<T> & ACond = pair1.second;
+    EigenMat<T> & BCond = pair2.second;
+    EigenMat<T> expected = ACond * BCond;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout <<"\tMatrix B is " << BCond.rows() << 'x' << BCond.cols() << endl;
+    cout << endl;
+
+    Matrix<T> & A = pair1.first;
+    const Matrix<T> & B = pair2.first;
+    const size_t m = A.Rows(), k = A.Columns(), n = B.Columns();
+
+    //Blocks, ranges and strided slices address the same elements as Eigen's.
+    const size_t sliceRows = (m + 1) / 2, sliceCols = (k + 2) / 3;
+    EigenMat<T> sliced(sliceRows, sliceCols);
+    for(size_t i = 0; i < sliceRows; i++)
+        for(size_t j = 0; j < sliceCols; j++)
+            sliced(i, j) = ACond(2 * i, 3 * j);
+    Matrix<T, RowMajor> ARow(A.View());
+    if(!(A.Block(3, 5, 20, 30).Materialize() == EigenMat<T>(ACond.block(3, 5, 20, 30)))
+       || !(ARow.RowRange(10, 7).Materialize() == EigenMat<T>(ACond.middleRows(10, 7)))
+       || !(A.ColumnRange(4, 9).Materialize() == EigenMat<T>(ACond.middleCols(4, 9)))
+       || !(ARow.Column(2).Materialize() == EigenMat<T>(ACond.col(2))) || !(A.Row(m - 1).Materialize() == EigenMat<T>(ACond.row(m - 1)))
+       || !(A.Slice(0, 0, sliceRows, sliceCols, 2, 3).Materialize() == sliced)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tSub-matrix view addresses the wrong elements." << endl;
+        return;
+    }
+
+    //A blocked product, each block of C written in place by its own call.
+    Matrix<T> C(m, n);
+    const size_t m1 = m / 2, n1 = n / 3;
+    const size_t rowStarts[] = { 0, m1 }, rowCounts[] = { m1, m - m1 };
+    const size_t colStarts[] = { 0, n1 }, colCounts[] = { n1, n - n1 };
+    for(int bi = 0; bi < 2; bi++)
+        for(int bj = 0; bj < 2; bj++)
+            Multiply(A.RowRange(rowStarts[bi], rowCounts[bi]), B.ColumnRange(colStarts[bj], colCounts[bj]),
+                     C.Block(rowStarts[bi], colStarts[bj], rowCounts[bi], colCounts[bj]));
+    Matrix<T, RowMajor> CRow(m, n);
+    Multiply(ARow.View(), B.View(), CRow.Block(0, 0, m, n));
+    if(!(C == expected) || !(CRow == expected)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tProduct written into blocks is wrong." << endl;
+        return;
+    }
+
+    //Transposes into a block of a bigger matrix, and into a strided slice.
+    Matrix<T> big(k + 3, m + 2, 0);
+    Transpose(A.View(), big.Block(3, 2, k, m));
+    Matrix<T, RowMajor> spread(2 * k, m, 0);
+    Transpose(A.View(), spread.Slice(0, 0, k, m, 2, 1));
+    if(!(big.Block(3, 2, k, m).Materialize() == EigenMat<T>(ACond.transpose())) || big(0, 0) != T(0)
+       || !(spread.Slice(0, 0, k, m, 2, 1).Materialize() == EigenMat<T>(ACond.transpose())) || spread(1, 0) != T(0)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tTranspose written into a view is wrong." << endl;
+        return;
+    }
+
+    //Outputs that overlap the inputs go through a temporary.
+    const size_t s = std::min(m, k);
+    Matrix<T> square = A.Block(0, 0, s, s).Materialize();
+    Multiply(square.View(), square.View(), square.View());
+    A.Block(1, 0, m - 1, k).Assign(A.Block(0, 0, m - 1, k));
+    if(!(square == EigenMat<T>(ACond.topLeftCorner(s, s) * ACond.topLeftCorner(s, s))) || !(A.Block(1, 0, m - 1, k).Materialize() == EigenMat<T>(ACond.topRows(m - 1)))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tWrite over an overlapping view is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testCopyOnWrite() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout << endl;
+
+    Matrix<T> A = pair.first;
+    const Matrix<T> plain(A);
+    A.EnableCopyOnWrite();
+    if(plain.IsCopyOnWrite() || !A.IsCopyOnWrite() || A.IsShared()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tCopy-on-write is not opt-in." << endl;
+        return;
+    }
+
+    //Copies share the buffer until one of them is written.
+    Matrix<T> B(A), C;
+    C = B;
+    const Matrix<T> & constB = B;
+    if(!A.IsShared() || !C.IsShared() || !C.IsCopyOnWrite() || constB.View().Data() != static_cast<const Matrix<T> &>(A).View().Data()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tCopies of a copy-on-write matrix don't share its storage." << endl;
+        return;
+    }
+    B(0, 0) = B(0, 0) + T(1);
+    C.TransposeInPlace();
+    if(B.IsShared() || C.IsShared() || A.IsShared() || !(A == ACond) || !(C == EigenMat<T>(ACond.transpose()))
+       || B(0, 0) != T(ACond(0, 0) + T(1)) || !(B.Block(1, 0, B.Rows() - 1, B.Columns()).Materialize() == EigenMat<T>(ACond.bottomRows(ACond.rows() - 1)))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tWrite to a shared matrix is not private to it." << endl;
+        return;
+    }
+
+    //Moves keep sharing, and writes that replace the contents just let go of the buffer.
+    Matrix<T> D(A);
+    Matrix<T> E(std::move(D));
+    Matrix<T> F(A), G(A);
+    F = plain;
+    G.Resize(10, 10);
+    if(!E.IsShared() || !(E == ACond) || !(F == ACond) || F.IsShared()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMove or overwrite of a shared matrix is wrong." << endl;
+        return;
+    }
+    E.AssignProduct(A.TransposeView(), A.View());
+    if(A.IsShared() || !(E == EigenMat<T>(ACond.transpose() * ACond)) || !(A == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tProduct into a shared matrix is wrong." << endl;
+        return;
+    }
+
+    //Owners come and go on many threads at once.
+    //Only read through const references here: a mutable accessor on A itself would detach it.
+    const Matrix<T> & shared = A;
+    bool consistent = true;
+    #pragma omp parallel for reduction(&&:consistent)
+    for(int i = 0; i < 64; i++) {
+        const Matrix<T> local(shared);
+        Matrix<T> writer(local);
+        writer(0, 0) = T(i);
+        consistent = consistent && local(0, 0) == shared(0, 0) && writer(0, 0) == T(i);
+    }
+    if(!consistent || A.IsShared() || !(A == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tConcurrent copies of a shared matrix are wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testExternalStorage() {
+    auto pair1 = generateRandomMatrix<T>(50, 150, 50, 150);
+    auto pair2 = generateRandomMatrix<T>(pair1.first.Columns(), pair1.first.Columns(), 50, 150);
+    EigenMat<T> & ACond = pair1.second;
+    EigenMat<T> & BCond = pair2.second;
+    EigenMat<T> expected = ACond * BCond;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout <<"\tMatrix B is " << BCond.rows() << 'x' << BCond.cols() << endl;
+    cout << endl;
+
+    const Matrix<T> & A = pair1.first;
+    const Matrix<T> & B = pair2.first;
+    const size_t m = A.Rows(), k = A.Columns(), n = B.Columns();
+
+    //A column-major frame from somewhere else, with its own padding.
+    const size_t ld = m + 3;
+    std::vector<T> frame(ld * k, T(0));
+    MatrixView<T>(frame.data(), m, k, 1, ld).Assign(A.View());
+    Matrix<T> borrowed(frame.data(), m, k, ld);
+    if(!borrowed.IsExternal() || borrowed.View().Data() != frame.data() || !(borrowed == ACond)
+       || !(borrowed * B == expected) || !(MatrixView<const T>(frame.data(), m, k, 1, ld) * B == expected)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMatrix over borrowed memory is wrong." << endl;
+        return;
+    }
+
+    //Writes land in the caller's memory; copies are ordinary, independent matrices.
+    borrowed(1, 0) = T(5);
+    Matrix<T> copy(borrowed);
+    copy(1, 0) = T(6);
+    std::vector<T> productFrame(m * n);
+    Matrix<T> product(productFrame.data(), m, n, m);
+    product.AssignProduct(borrowed.View(), B.View());
+    ACond(1, 0) = T(5);
+    if(frame[1] != T(5) || copy.IsExternal() || !(product == EigenMat<T>(ACond * BCond))
+       || !(MatrixView<const T>(productFrame.data(), m, n, 1, m) * Matrix<T>(n, 1, 1) == EigenMat<T>(ACond * BCond * EigenMat<T>::Ones(n, 1)))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tWrite to borrowed memory is wrong." << endl;
+        return;
+    }
+
+    //A buffer sized the BLAS way ends with the last line, so copies read no further and get padding of their own.
+    std::vector<T> tight(ld * (k - 1) + m);
+    MatrixView<T>(tight.data(), m, k, 1, ld).Assign(borrowed.View());
+    const Matrix<T> tightMatrix(tight.data(), m, k, ld);
+    const Matrix<T> tightCopy(tightMatrix);
+    Matrix<T> tightAssigned(2, 2);
+    tightAssigned = tightMatrix;
+    if(tightMatrix.Capacity() != tight.size() || tightCopy.IsExternal() || tightCopy.LeadingDimension() != A.LeadingDimension()
+       || !(tightCopy == ACond) || !(tightAssigned == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tCopy of a tightly sized borrowed buffer is wrong." << endl;
+        return;
+    }
+
+    //An operand that starts before the destination in one caller buffer and runs into it.
+    std::vector<T> shared(m * (k + n));
+    const MatrixView<T> operand(shared.data(), m, k, 1, m);
+    operand.Assign(borrowed.View());
+    Matrix<T> overlapping(shared.data() + m, m, n, m);
+    overlapping.AssignProduct(operand, B.View());
+    if(!(overlapping == EigenMat<T>(ACond * BCond))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tProduct over an operand that runs into the destination is wrong." << endl;
+        return;
+    }
+
+    //Adopted memory is freed exactly once, by whichever matrix ends up holding it.
+    int deletions = 0;
+    {
+        T * raw = new T[m * k];
+        std::copy(frame.begin(), frame.begin() + m * k, raw);
+        Matrix<T, RowMajor> adopted(raw, k, m, m, [&deletions](T * p) { delete[] p; deletions++; });
+        Matrix<T, RowMajor> moved(std::move(adopted));
+        Matrix<T, RowMajor> swapped(2, 2);
+        swapped.Swap(moved);
+        if(!swapped.IsExternal() || moved.IsExternal() || swapped(0, 1) != frame[1] || deletions != 0) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tOwnership of adopted memory did not move with the matrix." << endl;
+            return;
+        }
+        swapped.Resize(k + 1, m + 1);
+        if(swapped.IsExternal() || deletions != 1) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tAdopted memory is not released when the matrix outgrows it." << endl;
+            return;
+        }
+        Matrix<T> kept(new T[m * k], m, k, m, [&deletions](T * p) { delete[] p; deletions++; });
+    }
+    if(deletions != 2) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tAdopted memory is not released exactly once." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testBoundsChecking() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout << "\toperator() is " << (BoundsChecking<T>::value ? "checked" : "unchecked") << endl;
+    cout << endl;
+
+    const Matrix<T> & A = pair.first;
+    const Matrix<T, RowMajor> ARow(A.View());
+    const MatrixView<const T> AT = A.TransposeView();
+    const TiledMatrix<T> ATiled(A.View());
+    bool same = true;
+    for(size_t j = 0; j < A.Columns(); j++)
+        for(size_t i = 0; i < A.Rows(); i++)
+            same = same && A.GetUnchecked(i, j) == ACond(i, j) && ARow.GetUnchecked(i, j) == ACond(i, j)
+                && AT.GetUnchecked(j, i) == ACond(i, j) && ATiled.GetUnchecked(i, j) == ACond(i, j);
+    if(!same) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tUnchecked access reads the wrong element." << endl;
+        return;
+    }
+
+    //Get() always checks; operator() only when the policy says so.
+    auto throws = [](std::function<void()> access) {
+        try { access(); } catch(std::invalid_argument &) { return true; }
+        return false;
+    };
+    const size_t m = A.Rows(), n = A.Columns();
+    if(!throws([&] { A.Get(m, 0); }) || !throws([&] { AT.Get(0, m); }) || !throws([&] { ATiled.Get(m, n); })) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tGet() accepted an invalid coordinate." << endl;
+        return;
+    }
+    if(BoundsChecking<T>::value && (!throws([&] { A(0, n); }) || !throws([&] { ARow(m, 0); }) || !throws([&] { AT(n, 0); }))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tChecked operator() accepted an invalid coordinate." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testIterators() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    cout <<"\tMatrix A is " << ACond.rows() << 'x' << ACond.cols() << endl;
+    cout << endl;
+
+    const Matrix<T> & A = pair.first;
+    const Matrix<T, RowMajor> ARow(A.View());
+    const size_t m = A.Rows(), n = A.Columns();
+
+    //Whole matrices iterate in storage order, skipping any padding.
+    std::vector<T> columnOrder(A.begin(), A.end()), rowOrder(ARow.begin(), ARow.end());
+    bool ordered = size_t(std::distance(A.begin(), A.end())) == A.size() && columnOrder.size() == m * n && rowOrder.size() == m * n;
+    for(size_t j = 0; ordered && j < n; j++)
+        for(size_t i = 0; i < m; i++)
+            ordered = ordered && columnOrder[i + j * m] == ACond(i, j) && rowOrder[i * n + j] == ACond(i, j);
+    if(!ordered) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tIteration does not visit the elements in storage order." << endl;
+        return;
+    }
+
+    //Standard algorithms on whole matrices and on strided rows and columns.
+    Matrix<T> B(m, n);
+    std::transform(A.begin(), A.end(), B.begin(), [](T x) { return T(x * 2 + 1); });
+    Matrix<T, RowMajor> C(ARow);
+    auto column = C.Column(n / 2);
+    std::sort(column.begin(), column.end());
+    std::vector<T> sortedColumn(ACond.col(n / 2).data(), ACond.col(n / 2).data() + m);
+    std::sort(sortedColumn.begin(), sortedColumn.end());
+    const auto row = A.Row(m / 2);
+    if(!(B == EigenMat<T>(ACond * T(2) + EigenMat<T>::Constant(m, n, T(1)))) || !std::equal(sortedColumn.begin(), sortedColumn.end(), column.begin())
+       || std::count(row.begin(), row.end(), ACond(m / 2, 0)) != (ACond.row(m / 2).array() == ACond(m / 2, 0)).count()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tStandard algorithm over a matrix, row or column is wrong." << endl;
+        return;
+    }
+
+    //Random access across the padding, in both directions.
+    auto first = A.begin(), last = A.end() - 1;
+    std::reverse_iterator<typename Matrix<T>::const_iterator> reversed(A.end());
+    if(first[m + 1] != ACond(1, 1) || *(last - m) != ACond(m - 1, n - 2) || last - first != std::ptrdiff_t(m * n - 1)
+       || *reversed != ACond(m - 1, n - 1) || !(first < last) || (first + (m * n)) != A.end() || *(--(first + m)) != ACond(m - 1, 0)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tRandom access iteration is wrong." << endl;
+        return;
+    }
+
+    //Views whose elements run further apart than their lines, so that the address after the
+    //last line is an element: a transposed view, and the view and a block of a row-major matrix.
+    std::vector<T> transposedOrder, rowMajorOrder;
+    for(const T & x : A.TransposeView())
+        transposedOrder.push_back(x);
+    for(const T & x : ARow.View())
+        rowMajorOrder.push_back(x);
+    const auto block = ARow.Block(1, 1, m - 2, n - 2);
+    long long total = 0, blockTotal = 0;
+    for(size_t i = 0; i < m; i++)
+        for(size_t j = 0; j < n; j++)
+            (i > 0 && j > 0 && i < m - 1 && j < n - 1 ? blockTotal : total) += (long long)ACond(i, j);
+    if(transposedOrder != rowOrder || rowMajorOrder != columnOrder
+       || std::accumulate(A.TransposeView().begin(), A.TransposeView().end(), 0LL) != total + blockTotal
+       || std::accumulate(block.begin(), block.end(), 0LL) != blockTotal || size_t(std::distance(block.begin(), block.end())) != block.size()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tIteration over a transposed or row-major view is wrong." << endl;
+        return;
+    }
+
+    //data() is the storage itself, and indexed iteration runs in parallel.
+    Matrix<T> D(m, n, 0);
+    const std::ptrdiff_t count = D.size();
+    auto dBegin = D.begin();
+    #pragma omp parallel for
+    for(std::ptrdiff_t k = 0; k < count; k++)
+        dBegin[k] = T(k % 100);
+    if(D.data() != &D(0, 0) || D.data()[D.LeadingDimension()] != T(m % 100) || D(m - 1, n - 1) != T((m * n - 1) % 100)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel indexed iteration or data() is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testExpressionTemplates() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    auto pairB = generateRandomMatrix<T>(m, m, n, n);
+    auto pairC = generateRandomMatrix<T>(m, m, n, n);
+    const Matrix<T> & B = pairB.first, & C = pairC.first;
+    const EigenMat<T> & BCond = pairB.second, & CCond = pairC.second;
+    cout <<"\tMatrices A, B and C are " << m << 'x' << n << endl;
+    cout << endl;
+
+    //One fused pass, into new and existing matrices of either storage order.
+    const EigenMat<T> expected = ACond + BCond * T(2) - CCond;
+    Matrix<T> D = A + B * 2 - C;
+    Matrix<T> E(2, 2);
+    E = A + B * 2 - C;
+    Matrix<T, RowMajor> F = A + B * 2 - C;
+    Matrix<T> G = -A + Hadamard(B, C) - C / 3;
+    if(!(D == expected) || !(E == expected) || !(F == expected)
+       || !(G == EigenMat<T>(-ACond + EigenMat<T>(BCond.cwiseProduct(CCond)) - CCond / T(3)))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tElementwise expression is wrong." << endl;
+        return;
+    }
+
+    //Expressions that read their own destination, in place and shifted.
+    Matrix<T> H(A);
+    H = H + B;
+    H += C;
+    H *= 2;
+    H -= A;
+    Matrix<T> K(A);
+    K.Block(1, 0, m - 1, n).Assign(K.Block(0, 0, m - 1, n) + B.Block(1, 0, m - 1, n));
+    EigenMat<T> KCond = ACond;
+    KCond.bottomRows(m - 1) = EigenMat<T>(ACond.topRows(m - 1) + BCond.bottomRows(m - 1));
+    Matrix<T> L(A);
+    L = L.Block(0, 0, m / 2, n / 2) + L.Block(m / 2, n / 2, m / 2, n / 2);
+    const EigenMat<T> LCond = ACond.topLeftCorner(m / 2, n / 2) + ACond.block(m / 2, n / 2, m / 2, n / 2);
+    if(!(H == EigenMat<T>((ACond + BCond + CCond) * T(2) - ACond)) || !(K == KCond) || !(L == LCond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tExpression aliasing its destination is wrong." << endl;
+        return;
+    }
+
+    //Views as operands and destinations, and mixed storage orders.
+    const Matrix<T, RowMajor> ARow(A.View());
+    Matrix<T> M(n, m, 0);
+    M.View().Assign(A.TransposeView() + ARow.TransposeView() * 3);
+    Matrix<T> N(m, n, 0);
+    N.ColumnRange(0, n / 2).Assign(ARow.ColumnRange(0, n / 2) - C.ColumnRange(0, n / 2));
+    EigenMat<T> NCond = EigenMat<T>::Zero(m, n);
+    NCond.leftCols(n / 2) = ACond.leftCols(n / 2) - CCond.leftCols(n / 2);
+    if(!(M == EigenMat<T>(ACond.transpose() + ACond.transpose() * T(3))) || !(N == NCond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tExpression over views is wrong." << endl;
+        return;
+    }
+
+    //Matrix products inside expressions, and expressions as product operands.
+    const Matrix<T> P = A * A.TransposeView() + A * A.TransposeView() * 2;
+    const Matrix<T> Q = (A + B) * C.TransposeView();
+    const EigenMat<T> AAt = ACond * ACond.transpose();
+    if(!(P == EigenMat<T>(AAt + AAt * T(2))) || !(Q == EigenMat<T>((ACond + BCond) * CCond.transpose()))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMatrix product within an expression is wrong." << endl;
+        return;
+    }
+
+    bool caught = false;
+    try {
+        Matrix<T> R = A + A.Block(0, 0, m - 1, n);
+    } catch(std::invalid_argument &) {
+        caught = true;
+    }
+    if(!caught) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMismatched operand dimensions were accepted." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testElementwiseOperations() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    auto pairB = generateRandomMatrix<T>(m, m, n, n);
+    auto pairC = generateRandomMatrix<T>(m, m, n, n);
+    const Matrix<T> & B = pairB.first, & C = pairC.first;
+    const EigenMat<T> & BCond = pairB.second, & CCond = pairC.second;
+    cout <<"\tMatrices A, B and C are " << m << 'x' << n << endl;
+    cout << endl;
+
+    //Scalars on either side, elementwise division, min, max, abs and clamp.
+    const EigenMat<T> ones = EigenMat<T>::Constant(m, n, T(1));
+    const Matrix<T> D = 100 - A + 1;
+    const Matrix<T> E = A / (B + 1);
+    const Matrix<T> F = Min(A, B) + Max(C, 50);
+    const Matrix<T> G = Abs(A - B);
+    const Matrix<T, RowMajor> H = Clamp(A, 20, 80);
+    if(!(D == EigenMat<T>(ones * T(100) - ACond + ones)) || !(E == EigenMat<T>(ACond.cwiseQuotient(BCond + ones)))
+       || !(F == EigenMat<T>(ACond.cwiseMin(BCond) + CCond.cwiseMax(T(50))))
+       || !(G == EigenMat<T>((ACond - BCond).unaryExpr([](T x) { return T(x < T(0) ? -x : x); })))
+       || !(H == EigenMat<T>(ACond.cwiseMax(T(20)).cwiseMin(T(80))))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tScalar, division, min, max, abs or clamp expression is wrong." << endl;
+        return;
+    }
+
+    //Fused multiply-add and user functions.
+    const Matrix<T> K = MultiplyAdd(A, B, C);
+    Matrix<T, RowMajor> L(m, n, 0);
+    L = Map(A + B, [](T x) { return T(x > T(50) ? x - T(50) : x * T(2)); });
+    if(!(K == EigenMat<T>(EigenMat<T>(ACond.cwiseProduct(BCond)) + CCond))
+       || !(L == EigenMat<T>((ACond + BCond).unaryExpr([](T x) { return T(x > T(50) ? x - T(50) : x * T(2)); })))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMultiply-add or mapped expression is wrong." << endl;
+        return;
+    }
+
+    //A bias row added to every row, and every column scaled, in both storage orders.
+    const Matrix<T> bias = B.Row(0).Materialize();
+    const Matrix<T, RowMajor> scales(C.Column(0));
+    Matrix<T> M = A + BroadcastRow(bias, m);
+    Matrix<T, RowMajor> N = Hadamard(A, BroadcastRow(C.Row(1), m)) - BroadcastColumn(scales, n);
+    M += BroadcastColumn(B.Column(2), n);
+    EigenMat<T> MCond(m, n), NCond(m, n);
+    for(size_t j = 0; j < n; j++)
+        for(size_t i = 0; i < m; i++) {
+            MCond(i, j) = T(ACond(i, j) + BCond(0, j) + BCond(i, 2));
+            NCond(i, j) = T(ACond(i, j) * CCond(1, j) - CCond(i, 0));
+        }
+    if(!(M == MCond) || !(N == NCond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tBroadcast expression is wrong." << endl;
+        return;
+    }
+
+    //Broadcasting a row of the destination itself.
+    Matrix<T> P(A);
+    P = P - BroadcastRow(P.Row(m / 2), m);
+    EigenMat<T> PCond(m, n);
+    for(size_t j = 0; j < n; j++)
+        for(size_t i = 0; i < m; i++)
+            PCond(i, j) = T(ACond(i, j) - ACond(m / 2, j));
+    bool caught = false;
+    try {
+        Matrix<T> Q = BroadcastRow(A, m);
+    } catch(std::invalid_argument &) {
+        caught = true;
+    }
+    if(!(P == PCond) || !caught) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tBroadcast aliasing its destination, or a matrix broadcast as a row, is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testReductions() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    auto pairB = generateRandomMatrix<T>(m, m, n, n);
+    const Matrix<T> & B = pairB.first;
+    const EigenMat<T> & BCond = pairB.second;
+    const Matrix<T, RowMajor> ARow(A.View());
+    cout <<"\tMatrices A and B are " << m << 'x' << n << endl;
+    cout << endl;
+
+    //Whole-matrix reductions, of matrices in either order and of expressions. Sums of products
+    //outgrow the exactly representable integers of a float, so those may round differently.
+    auto close = [](T a, T b) { return std::is_integral<T>::value ? a == b : std::abs(double(a) - double(b)) <= 1e-5 * std::abs(double(b)); };
+    Eigen::Index minRow, minCol, maxRow, maxCol;
+    const T minimum = ACond.minCoeff(&minRow, &minCol), maximum = ACond.maxCoeff(&maxRow, &maxCol);
+    if(Sum(A) != ACond.sum() || Sum(ARow) != ACond.sum() || Sum(A - B) != T(ACond.sum() - BCond.sum())
+       || MinElement(A) != minimum || MaxElement(ARow) != maximum || Trace(A) != ACond.trace()
+       || !close(Dot(A, B), EigenMat<T>(ACond.cwiseProduct(BCond)).sum()) || !close(Dot(A.TransposeView(), ARow.TransposeView()), ACond.squaredNorm())
+       || ArgMin(A) != std::make_pair(size_t(minRow), size_t(minCol)) || ArgMax(ARow) != std::make_pair(size_t(maxRow), size_t(maxCol))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tSum, extremum, trace or dot product is wrong." << endl;
+        return;
+    }
+
+    //Statistics, in double for integer matrices.
+    typedef RealType<T> R;
+    const Eigen::Matrix<R, Eigen::Dynamic, Eigen::Dynamic> real = ACond.template cast<R>();
+    const R mean = real.mean();
+    const R variance = (real.array() - mean).square().mean();
+    const R tolerance = std::is_same<R, float>::value ? R(1e-4) : R(1e-10);
+    if(std::abs(Mean(A) - mean) > tolerance * mean || std::abs(Variance(ARow) - variance) > tolerance * variance
+       || std::abs(FrobeniusNorm(A) - real.norm()) > tolerance * real.norm()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tMean, variance or norm is wrong." << endl;
+        return;
+    }
+
+    //Per-column and per-row reductions, and the norms built on them.
+    const EigenMat<T> absolute = EigenMat<T>(ACond - BCond).unaryExpr([](T x) { return T(x < T(0) ? -x : x); });
+    const Matrix<R> columnMeans = ColumnMeans(A), rowMeans = RowMeans(ARow);
+    bool means = columnMeans.Rows() == 1 && columnMeans.Columns() == n && rowMeans.Rows() == m && rowMeans.Columns() == 1;
+    for(size_t j = 0; means && j < n; j++)
+        means = std::abs(columnMeans(0, j) - real.col(j).mean()) <= tolerance * real.col(j).mean();
+    for(size_t i = 0; means && i < m; i++)
+        means = std::abs(rowMeans(i, 0) - real.row(i).mean()) <= tolerance * real.row(i).mean();
+    if(!(ColumnSums(A) == EigenMat<T>(ACond.colwise().sum())) || !(RowSums(A) == EigenMat<T>(ACond.rowwise().sum()))
+       || !(ColumnSums(ARow) == EigenMat<T>(ACond.colwise().sum())) || !(RowSums(ARow - B) == EigenMat<T>((ACond - BCond).rowwise().sum()))
+       || !(ColumnMinima(A) == EigenMat<T>(ACond.colwise().minCoeff())) || !(RowMinima(A) == EigenMat<T>(ACond.rowwise().minCoeff()))
+       || !(ColumnMaxima(ARow) == EigenMat<T>(ACond.colwise().maxCoeff())) || !(RowMaxima(A) == EigenMat<T>(ACond.rowwise().maxCoeff()))
+       || !means || NormL1(A - B) != absolute.colwise().sum().maxCoeff() || NormInf(A - B) != absolute.rowwise().sum().maxCoeff()) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tPer-column or per-row reduction is wrong." << endl;
+        return;
+    }
+
+    //Extrema skip NaNs wherever they are: here the whole first column, which holds the first
+    //element and the first of every pair the row-wise reductions combine, and two more.
+    if(std::numeric_limits<T>::has_quiet_NaN) {
+        Matrix<T> N(A);
+        EigenMat<T> low = ACond, high = ACond;
+        auto poison = [&](size_t i, size_t j) {
+            N(i, j) = std::numeric_limits<T>::quiet_NaN();
+            low(i, j) = T(1000);
+            high(i, j) = T(-1000);
+        };
+        for(size_t i = 0; i < m; i++)
+            poison(i, 0);
+        poison(m / 2, n / 2);
+        poison(m - 1, n - 1);
+        const Matrix<T, RowMajor> NRow(N.View());
+        Eigen::Index row, column;
+        const T lowest = low.minCoeff(&row, &column);
+        const std::pair<size_t, size_t> lowestAt(row, column);
+        const T highest = high.maxCoeff(&row, &column);
+        const std::pair<size_t, size_t> highestAt(row, column);
+        const EigenMat<T> columnMinima = low.colwise().minCoeff(), columnMaxima = high.colwise().maxCoeff();
+        bool skipped = MinElement(N) == lowest && MaxElement(NRow) == highest && ArgMin(N) == lowestAt && ArgMax(NRow) == highestAt
+                       && ArgMax(N) == highestAt && RowMinima(N) == EigenMat<T>(low.rowwise().minCoeff())
+                       && RowMaxima(N) == EigenMat<T>(high.rowwise().maxCoeff()) && RowMinima(NRow) == EigenMat<T>(low.rowwise().minCoeff());
+        //The first column holds nothing but NaNs, so its extrema are the identities.
+        const Matrix<T> nMinima = ColumnMinima(N), nMaxima = ColumnMaxima(NRow);
+        skipped = skipped && nMinima(0, 0) == std::numeric_limits<T>::infinity() && nMaxima(0, 0) == -std::numeric_limits<T>::infinity();
+        for(size_t j = 1; skipped && j < n; j++)
+            skipped = nMinima(0, j) == columnMinima(0, j) && nMaxima(0, j) == columnMaxima(0, j);
+        if(!skipped) {
+            cout << "\tTest Failed!" << endl;
+            cout << "\tExtrema do not skip NaNs." << endl;
+            return;
+        }
+    }
+
+    //Large enough for the parallel paths.
+    const size_t size = 1100;
+    Matrix<T> L(size, size, 0);
+    L.View().Assign(Map(L, [](T) { return T(1); }));
+    L(size / 3, size / 2) = T(5);
+    const Matrix<T> rowSums = RowSums(L);
+    if(Sum(L) != T(size * size + 4) || MaxElement(L) != T(5) || ArgMax(L) != std::make_pair(size / 3, size / 2)
+       || rowSums(size / 3, 0) != T(size + 4) || rowSums(size - 1, 0) != T(size) || ColumnSums(L)(0, size / 2) != T(size + 4)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel reduction is wrong." << endl;
+        return;
+    }
+    //A few long columns are cut into pieces of rows for the threads.
+    const size_t tall = size * size / 3;
+    Matrix<T> narrow(tall, 3, 0);
+    narrow.View().Assign(Map(narrow, [](T) { return T(1); }));
+    narrow(tall / 3, 1) = T(5);
+    if(Sum(narrow) != T(3 * tall + 4) || Sum(narrow.Column(2)) != T(tall) || MaxElement(narrow) != T(5)
+       || ArgMax(narrow) != std::make_pair(tall / 3, size_t(1)) || Dot(narrow.Column(1), narrow.Column(0)) != T(tall + 4)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel reduction of narrow matrices is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testTranscendentals() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    cout <<"\tMatrix A is " << m << 'x' << n << endl;
+    cout << endl;
+
+    //Integer matrices are converted first. X is in [-5, 5) and Y in [1, 100].
+    typedef RealType<T> R;
+    const Matrix<R> X = (Cast<R>(A) - R(50)) / R(10);
+    const Matrix<R> Y = Cast<R>(A) + R(1);
+    const Matrix<R> E = Exp(X), L = Log(Y), S = Sigmoid(X), Q = Sqrt(Y);
+    const Matrix<R, RowMajor> H = Tanh(X);
+    //Within a few units in the last place of the standard library, for the matrix and the scalar functions.
+    auto close = [](R value, R expected) { return std::abs(value - expected) <= R(4) * std::numeric_limits<R>::epsilon() * std::abs(expected); };
+    for(size_t j = 0; j < n; j++) {
+        for(size_t i = 0; i < m; i++) {
+            const R x = X(i, j), y = Y(i, j);
+            if(!close(E(i, j), std::exp(x)) || !close(L(i, j), std::log(y)) || !close(H(i, j), std::tanh(x))
+               || !close(S(i, j), R(1) / (R(1) + std::exp(-x))) || Q(i, j) != std::sqrt(y)
+               || !close(Exp(x), std::exp(x)) || !close(Log(y), std::log(y)) || !close(Tanh(x), std::tanh(x))) {
+                cout << "\tTest Failed!" << endl;
+                cout << "\tElement (" << i << ", " << j << ") is wrong." << endl;
+                return;
+            }
+        }
+    }
+
+    //Limits and special values.
+    const R infinity = std::numeric_limits<R>::infinity();
+    if(Exp(R(1000)) != infinity || Exp(R(-1000)) != R(0) || Exp(-infinity) != R(0) || Log(R(0)) != -infinity
+       || Log(infinity) != infinity || !(Log(R(-1)) != Log(R(-1))) || Tanh(R(-1000)) != R(-1) || Sigmoid(R(1000)) != R(1)
+       || Sigmoid(R(-1000)) != R(0) || !close(Log(std::numeric_limits<R>::denorm_min()), std::log(std::numeric_limits<R>::denorm_min()))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tA limit or special value is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testScans() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    const Matrix<T, RowMajor> ARow(A.View());
+    cout <<"\tMatrix A is " << m << 'x' << n << endl;
+    cout << endl;
+
+    //Running sums by plain loops. The sums of small whole numbers are exact for every type, so
+    //the order of the additions doesn't matter.
+    EigenMat<T> columns(m, n), rows(m, n), integral(m, n);
+    for(Eigen::Index j = 0; j < Eigen::Index(n); j++) {
+        for(Eigen::Index i = 0; i < Eigen::Index(m); i++) {
+            columns(i, j) = T((i > 0 ? columns(i - 1, j) : T(0)) + ACond(i, j));
+            rows(i, j) = T((j > 0 ? rows(i, j - 1) : T(0)) + ACond(i, j));
+            integral(i, j) = T((j > 0 ? integral(i, j - 1) : T(0)) + columns(i, j));
+        }
+    }
+    const EigenMat<T> columnsBefore = EigenMat<T>(columns - ACond), rowsBefore = EigenMat<T>(rows - ACond);
+    if(!(InclusiveColumnScan(A) == columns) || !(InclusiveColumnScan(ARow) == columns) || !(ExclusiveColumnScan(A) == columnsBefore)
+       || !(ExclusiveColumnScan(ARow) == columnsBefore) || !(InclusiveRowScan(A) == rows) || !(InclusiveRowScan(ARow) == rows)
+       || !(ExclusiveRowScan(A) == rowsBefore) || !(ExclusiveRowScan(A.TransposeView()) == EigenMat<T>(columnsBefore.transpose()))
+       || !(InclusiveColumnScan(A + A) == EigenMat<T>(columns + columns))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tColumn or row scan is wrong." << endl;
+        return;
+    }
+
+    const Matrix<T> image = IntegralImage(A);
+    const size_t row = m / 3, column = n / 4, boxRows = m / 2, boxColumns = n / 2;
+    if(!(image == integral) || !(IntegralImage(ARow) == integral) || !(IntegralImage(A.TransposeView()) == EigenMat<T>(integral.transpose()))
+       || BoxSum(image, row, column, boxRows, boxColumns) != ACond.block(row, column, boxRows, boxColumns).sum()
+       || BoxSum(image, 0, 0, m, n) != ACond.sum() || BoxSum(image, 0, column, 1, 1) != ACond(0, column)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tIntegral image or box sum is wrong." << endl;
+        return;
+    }
+
+    //Large enough for the parallel paths, including the ones that split a few long lines into pieces.
+    const size_t length = 600000, size = 1100;
+    const Matrix<T> tall(length, 2, 1), wide(2, length, 1), ones(size, size, 1);
+    const Matrix<T> down = InclusiveColumnScan(tall), downBefore = ExclusiveColumnScan(tall);
+    const Matrix<T> across = InclusiveRowScan(wide), acrossBefore = ExclusiveRowScan(wide), big = IntegralImage(ones);
+    bool correct = true;
+    for(size_t k = 0; correct && k < length; k += 997) {
+        correct = down(k, 1) == T(k + 1) && downBefore(k, 0) == T(k) && across(1, k) == T(k + 1) && acrossBefore(0, k) == T(k)
+                  && big(k % size, (k / size) % size) == T((k % size + 1) * ((k / size) % size + 1));
+    }
+    if(!correct || down(length - 1, 0) != T(length) || across(0, length - 1) != T(length) || big(size - 1, size - 1) != T(size * size)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel scan is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testGatherScatter() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    const Matrix<T, RowMajor> ARow(A.View());
+    cout <<"\tMatrix A is " << m << 'x' << n << endl;
+    cout << endl;
+
+    //Random index lists with repeats for the gathers, and random permutations.
+    std::vector<size_t> rowIndices(Rand::randInt(1, 200)), columnIndices(Rand::randInt(1, 200));
+    for(size_t & index : rowIndices) index = Rand::randInt(int(m));
+    for(size_t & index : columnIndices) index = Rand::randInt(int(n));
+    std::vector<size_t> rowPermutation(m), columnPermutation(n);
+    std::iota(rowPermutation.begin(), rowPermutation.end(), size_t(0));
+    std::iota(columnPermutation.begin(), columnPermutation.end(), size_t(0));
+    for(size_t k = m - 1; k > 0; k--) std::swap(rowPermutation[k], rowPermutation[Rand::randInt(int(k + 1))]);
+    for(size_t k = n - 1; k > 0; k--) std::swap(columnPermutation[k], columnPermutation[Rand::randInt(int(k + 1))]);
+
+    EigenMat<T> rows(rowIndices.size(), n), columns(m, columnIndices.size()), permuted(m, n);
+    for(Eigen::Index i = 0; i < rows.rows(); i++)
+        rows.row(i) = ACond.row(rowIndices[i]);
+    for(Eigen::Index j = 0; j < columns.cols(); j++)
+        columns.col(j) = ACond.col(columnIndices[j]);
+    for(Eigen::Index i = 0; i < Eigen::Index(m); i++)
+        for(Eigen::Index j = 0; j < Eigen::Index(n); j++)
+            permuted(i, j) = ACond(rowPermutation[i], columnPermutation[j]);
+
+    if(!(GatherRows(A, rowIndices) == rows) || !(GatherRows(ARow, rowIndices) == rows)
+       || !(GatherColumns(A, columnIndices) == columns) || !(GatherColumns(ARow, columnIndices) == columns)
+       || !(GatherRows(A.TransposeView(), columnIndices) == EigenMat<T>(columns.transpose()))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tGather is wrong." << endl;
+        return;
+    }
+
+    Matrix<T> B(A);
+    Matrix<T, RowMajor> BRow(ARow);
+    PermuteRows(B, rowPermutation);
+    PermuteColumns(B, columnPermutation);
+    PermuteColumns(BRow, columnPermutation);
+    PermuteRows(BRow, rowPermutation);
+    if(!(B == permuted) || !(BRow == permuted)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tPermutation is wrong." << endl;
+        return;
+    }
+
+    //Scattering the permuted lines back to where they came from undoes the permutation, also
+    //when the source and destination are the same matrix.
+    Matrix<T> C(m, n, 0);
+    Matrix<T, RowMajor> CRow(m, n, 0);
+    ScatterRows(B, rowPermutation, C);
+    ScatterColumns(C, columnPermutation, CRow);
+    ScatterRows(BRow.View(), rowPermutation, BRow);
+    ScatterColumns(BRow.View(), columnPermutation, BRow.View());
+    if(!(CRow == ACond) || !(BRow == ACond)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tScatter is wrong." << endl;
+        return;
+    }
+
+    int threw = 0;
+    try { GatherRows(A, std::vector<size_t>(1, m)); } catch(std::invalid_argument &) { threw++; }
+    try { ScatterColumns(GatherColumns(A, std::vector<size_t>(2, 0)), std::vector<size_t>(2, 0), C); } catch(std::invalid_argument &) { threw++; }
+    try { PermuteRows(C, std::vector<size_t>(m, 0)); } catch(std::invalid_argument &) { threw++; }
+    try { GatherColumns(A, std::vector<size_t>()); } catch(std::invalid_argument &) { threw++; }
+    if(threw != 4) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tInvalid indices were accepted." << endl;
+        return;
+    }
+
+    //Large enough for the parallel paths. Reversing twice is the identity.
+    const size_t size = 1100;
+    Matrix<T> big(size, size);
+    for(size_t i = 0; i < size; i++)
+        for(size_t j = 0; j < size; j++)
+            big(i, j) = T((i * 7 + j) % 100);
+    std::vector<size_t> reverse(size);
+    for(size_t k = 0; k < size; k++) reverse[k] = size - 1 - k;
+    const Matrix<T> rowsReversed = GatherRows(big, reverse), columnsReversed = GatherColumns(big, reverse);
+    const Matrix<T> fromRowMajor = GatherRows(Matrix<T, RowMajor>(big.View()), reverse);
+    bool correct = true;
+    for(size_t k = 0; correct && k < size * size; k += 997) {
+        const size_t i = k % size, j = k / size;
+        correct = rowsReversed(i, j) == big(size - 1 - i, j) && columnsReversed(i, j) == big(i, size - 1 - j)
+                  && fromRowMajor(i, j) == big(size - 1 - i, j);
+    }
+    Matrix<T, RowMajor> bigRow(big.View());
+    PermuteRows(bigRow, reverse);
+    PermuteRows(bigRow, reverse);
+    PermuteColumns(bigRow, reverse);
+    PermuteColumns(bigRow, reverse);
+    if(!correct || !(bigRow == big)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel gather or permutation is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template <class T>
+void testConcatenation() {
+    auto pair = generateRandomMatrix<T>(50, 150, 50, 150);
+    EigenMat<T> & ACond = pair.second;
+    const Matrix<T> & A = pair.first;
+    const size_t m = A.Rows(), n = A.Columns();
+    const Matrix<T, RowMajor> ARow(A.View());
+    const Matrix<T> B(A + A);
+    const EigenMat<T> BCond = ACond + ACond;
+    cout <<"\tMatrix A is " << m << 'x' << n << endl;
+    cout << endl;
+
+    //Every other column (row) of A as a third part, so that one part is strided both ways.
+    const size_t half = (n + 1) / 2, halfRows = (m + 1) / 2;
+    EigenMat<T> sideBySide(m, 2 * n + half), stacked(2 * m + halfRows, n);
+    for(Eigen::Index j = 0; j < Eigen::Index(half); j++)
+        sideBySide.col(2 * n + j) = ACond.col(2 * j);
+    for(Eigen::Index i = 0; i < Eigen::Index(halfRows); i++)
+        stacked.row(2 * m + i) = ACond.row(2 * i);
+    sideBySide.leftCols(2 * n) << ACond, BCond;
+    stacked.topRows(2 * m) << ACond, BCond;
+
+    const std::vector<MatrixView<const T>> columnParts{ARow.View(), B.View(), ARow.Slice(0, 0, m, half, 1, 2)};
+    const std::vector<MatrixView<const T>> rowParts{A.View(), B.View(), A.Slice(0, 0, halfRows, n, 2, 1)};
+    const Matrix<T> wide = HorizontalStack(columnParts), tall = VerticalStack(rowParts);
+    if(!(wide == sideBySide) || !(tall == stacked) || !(HorizontalStack(A, B.View()) == EigenMat<T>(sideBySide.leftCols(2 * n)))
+       || !(VerticalStack(ARow, B) == EigenMat<T>(stacked.topRows(2 * m)))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tStacking is wrong." << endl;
+        return;
+    }
+
+    const std::vector<Matrix<T>> columnSplit = SplitColumns(wide, std::vector<size_t>{n, n, half});
+    const std::vector<Matrix<T>> rowSplit = SplitRows(ARow, std::vector<size_t>{1, m - 2, 1});
+    if(columnSplit.size() != 3 || !(columnSplit[0] == ACond) || !(columnSplit[1] == BCond) || !(columnSplit[2] == EigenMat<T>(sideBySide.rightCols(half)))
+       || rowSplit.size() != 3 || !(rowSplit[0] == EigenMat<T>(ACond.topRows(1))) || !(rowSplit[1] == EigenMat<T>(ACond.middleRows(1, m - 2)))
+       || !(rowSplit[2] == EigenMat<T>(ACond.bottomRows(1)))) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tSplitting is wrong." << endl;
+        return;
+    }
+
+    //Reshaping views: packed elements, a strided row, and a block, which can't be reshaped in place.
+    std::vector<T> buffer(24);
+    std::iota(buffer.begin(), buffer.end(), T(0));
+    const MatrixView<T> packed = MatrixView<T>(buffer.data(), 6, 4, 1, 6).Reshape(4, 6);
+    const MatrixView<const T> row = A.Row(m / 2).Reshape(n, 1);
+    bool correct = packed.Data() == buffer.data() && packed(3, 5) == T(23) && packed(1, 2) == T(9) && row.Data() == &A(m / 2, 0);
+    for(size_t j = 0; correct && j < n; j++)
+        correct = row(j, 0) == ACond(m / 2, j);
+    int threw = 0;
+    try { A.Block(0, 0, 2, 2).Reshape(4, 1); } catch(std::invalid_argument &) { threw++; }
+    try { A.View().Reshape(m + 1, n); } catch(std::invalid_argument &) { threw++; }
+    try { SplitRows(A, std::vector<size_t>{m, 1}); } catch(std::invalid_argument &) { threw++; }
+    try { HorizontalStack(A, A.TransposeView()); } catch(std::invalid_argument &) { threw += m != n; }
+    if(!correct || threw != 3 + int(m != n)) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tReshape or argument checking is wrong." << endl;
+        return;
+    }
+
+    //Large enough for the parallel copies, including blocked copies between views strided both ways.
+    const size_t size = 1100;
+    Matrix<T> big(size, size), spread(2 * size, 2 * size, 0);
+    for(size_t i = 0; i < size; i++)
+        for(size_t j = 0; j < size; j++)
+            big(i, j) = T((i * 7 + j) % 100);
+    const Matrix<T> joined = HorizontalStack(big, Matrix<T, RowMajor>(big.View())), piled = VerticalStack(big, big);
+    spread.Slice(1, 1, size, size, 2, 2).Assign(big.View());
+    const std::vector<Matrix<T>> pieces = SplitRows(Matrix<T, RowMajor>(big.View()), std::vector<size_t>{size / 2, size - size / 2});
+    for(size_t k = 0; correct && k < size * size; k += 997) {
+        const size_t i = k % size, j = k / size;
+        correct = joined(i, j) == big(i, j) && joined(i, size + j) == big(i, j) && piled(size + i, j) == big(i, j)
+                  && spread(2 * i + 1, 2 * j + 1) == big(i, j) && spread(2 * i, 2 * j) == T(0)
+                  && pieces[i < size / 2 ? 0 : 1](i < size / 2 ? i : i - size / 2, j) == big(i, j);
+    }
+    if(!correct) {
+        cout << "\tTest Failed!" << endl;
+        cout << "\tParallel stacking or splitting is wrong." << endl;
+        return;
+    }
+
+    cout << "\tTest Passed!" << endl;
+}
+
+template<class T, class Order>
+bool operator==(const Matrix<T, Order> & A, const EigenMat<T> & B) {
+    for (size_t i = 0; i < A.Rows(); i++) {
+        for (size_t j = 0; j < A.Columns(); j++) {
+            if(A(i, j) != B(i, j)) {
+                std::cout << "\tFailing value: " << A(i,j) << endl;
+                std::cout << "\tCorrect value: " << B(i,j) << endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template<class T, class LhsOrder, class RhsOrder>
+bool operator==(const Matrix<T, LhsOrder> & A, const Matrix<T, RhsOrder> & B) {
     for (size_t i = 0; i < A.Rows(); i++) {
         for (size_t j = 0; j < A.Columns(); j++) {
             if(A(i, j) != B(i, j)) return false;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Matrix.hpp"
+
+/**
+ * A read-mostly matrix kept in both storage orders at once.
+ * Whichever side of a product it is on, the operand handed to the kernel is the copy with the
+ * favourable layout: contiguous rows on the left, contiguous columns on the right, so neither
+ * rows need gathering nor columns packing. Costs twice the memory, and every write goes to
+ * both copies, so it pays off for matrices that are multiplied far more often than modified.
+ */
+template <class T>
+class DualMatrix
+{
+public:
+    DualMatrix(size_t numRows = 4, size_t numCols = 4, T defaultValue = 0, MatrixKernels::MemoryResource * resource = nullptr)
+    : m_columnMajor(numRows, numCols, defaultValue, resource), m_rowMajor(numRows, numCols, defaultValue, resource) {}
+    /// Copies a matrix of either order into both layouts.
+    template <class Order>
+    explicit DualMatrix(const Matrix<T, Order> & matrix)
+    : m_columnMajor(matrix.View()), m_rowMajor(matrix.View()) {}
+
+    /// Fetches the element at the given coordinates
+    const T & operator()(size_t row, size_t col) const { return m_columnMajor(row, col); }
+    /// Fetches the element at the given coordinates
+    const T & Get(size_t row, size_t col) const { return m_columnMajor.Get(row, col); }
+    /// Fetches the element at the given coordinates, which must be in range.
+    const T & GetUnchecked(size_t row, size_t col) const { return m_columnMajor.GetUnchecked(row, col); }
+    /// Writes one element to both copies.
+    void Set(size_t row, size_t col, const T & value) {
+        m_columnMajor.Get(row, col) = value;
+        m_rowMajor.GetUnchecked(row, col) = value;
+    }
+    /**
+     * For bulk changes: update(m) is called on the column-major copy, which it may modify
+     * or even resize however it likes, and the row-major copy is rebuilt from it afterwards.
+     */
+    template <class Update>
+    void Modify(Update update) {
+        update(m_columnMajor);
+        m_rowMajor = Matrix<T, RowMajor>(m_columnMajor.View());
+    }
+
+    size_t Rows() const { return m_columnMajor.Rows(); }
+    size_t Columns() const { return m_columnMajor.Columns(); }
+    const Matrix<T, ColumnMajor> & ColumnMajorMatrix() const { return m_columnMajor; }
+    const Matrix<T, RowMajor> & RowMajorMatrix() const { return m_rowMajor; }
+    /// The view to use as the left operand of a product, with contiguous rows.
+    MatrixView<const T> LeftView() const { return m_rowMajor.View(); }
+    /// The view to use as the right operand of a product, with contiguous columns.
+    MatrixView<const T> RightView() const { return m_columnMajor.View(); }
+    /// Returns a view of the transpose. Its rows are the contiguous columns of the column-major copy.
+    MatrixView<const T> TransposeView() const { return m_columnMajor.TransposeView(); }
+
+private:
+    Matrix<T, ColumnMajor> m_columnMajor;
+    Matrix<T, RowMajor> m_rowMajor;
+};
+
+template <class T>
+Matrix<T> operator*(const DualMatrix<T> & lhs, const DualMatrix<T> & rhs) {
+    return Multiply(lhs.LeftView(), rhs.RightView());
+}
+
+template <class T, class Order>
+Matrix<T, Order> operator*(const DualMatrix<T> & lhs, const Matrix<T, Order> & rhs) {
+    return Multiply<Order>(lhs.LeftView(), rhs.View());
+}
+
+template <class T, class Order>
+Matrix<T, Order> operator*(const Matrix<T, Order> & lhs, const DualMatrix<T> & rhs) {
+    return Multiply<Order>(lhs.View(), rhs.RightView());
+}
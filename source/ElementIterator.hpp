@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+/**
+ * Random access iterator over the elements of a set of equally spaced, equally long lines:
+ * element k is element k % lineLength of line k / lineLength. The lines of a matrix are its
+ * columns (rows, if row-major), so padding between them is skipped; a one-line set is a
+ * plain strided range, such as a row of a column-major matrix.
+ */
+template <class T>
+class ElementIterator
+{
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef typename std::remove_const<T>::type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T * pointer;
+    typedef T & reference;
+
+    ElementIterator() = default;
+    /// Starts at the first element of the line at line, offset elements along it.
+    ElementIterator(T * line, size_t offset, size_t lineLength, size_t elementStride, size_t lineStride)
+    : m_current(line + offset * elementStride), m_line(line), m_offset(offset), m_lineLength(lineLength),
+      m_elementStride(elementStride), m_lineStride(lineStride) {}
+    /// Iterators over mutable elements convert implicitly to read-only ones.
+    template <class U, class = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    ElementIterator(const ElementIterator<U> & other)
+    : m_current(&*other), m_line(other.Line()), m_offset(other.Offset()), m_lineLength(other.LineLength()),
+      m_elementStride(other.ElementStride()), m_lineStride(other.LineStride()) {}
+
+    reference operator*() const { return *m_current; }
+    pointer operator->() const { return m_current; }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    ElementIterator & operator++() {
+        m_current += m_elementStride;
+        if(++m_offset == m_lineLength) {
+            m_offset = 0;
+            m_line += m_lineStride;
+            m_current = m_line;
+        }
+        return *this;
+    }
+    ElementIterator & operator--() {
+        if(m_offset == 0) {
+            m_offset = m_lineLength;
+            m_line -= m_lineStride;
+        }
+        --m_offset;
+        m_current = m_line + m_offset * m_elementStride;
+        return *this;
+    }
+    ElementIterator operator++(int) { ElementIterator old(*this); ++*this; return old; }
+    ElementIterator operator--(int) { ElementIterator old(*this); --*this; return old; }
+
+    ElementIterator & operator+=(difference_type n) {
+        //Floor division, so stepping backwards lands on an offset inside the line.
+        const difference_type length = difference_type(m_lineLength);
+        const difference_type position = difference_type(m_offset) + n;
+        difference_type lines = position / length;
+        difference_type offset = position % length;
+        if(offset < 0) {
+            offset += length;
+            lines--;
+        }
+        m_line += lines * difference_type(m_lineStride);
+        m_offset = size_t(offset);
+        m_current = m_line + m_offset * m_elementStride;
+        return *this;
+    }
+    ElementIterator & operator-=(difference_type n) { return *this += -n; }
+    ElementIterator operator+(difference_type n) const { ElementIterator result(*this); return result += n; }
+    ElementIterator operator-(difference_type n) const { ElementIterator result(*this); return result -= n; }
+    friend ElementIterator operator+(difference_type n, const ElementIterator & it) { return it + n; }
+    difference_type operator-(const ElementIterator & other) const {
+        return LineIndex(other) * difference_type(m_lineLength) + difference_type(m_offset) - difference_type(other.m_offset);
+    }
+
+    //Positions are compared by line and offset, not address: when the elements of a line run
+    //further apart than the lines, as in a transposed view, the start of the line after the
+    //last is the address of an element.
+    bool operator==(const ElementIterator & other) const { return m_line == other.m_line && m_offset == other.m_offset; }
+    bool operator!=(const ElementIterator & other) const { return !(*this == other); }
+    bool operator<(const ElementIterator & other) const { return *this - other < 0; }
+    bool operator>(const ElementIterator & other) const { return other < *this; }
+    bool operator<=(const ElementIterator & other) const { return !(other < *this); }
+    bool operator>=(const ElementIterator & other) const { return !(*this < other); }
+
+    T * Line() const { return m_line; }
+    size_t Offset() const { return m_offset; }
+    size_t LineLength() const { return m_lineLength; }
+    size_t ElementStride() const { return m_elementStride; }
+    size_t LineStride() const { return m_lineStride; }
+
+private:
+    /// Number of lines from other's line to this one.
+    difference_type LineIndex(const ElementIterator & other) const {
+        return m_line == other.m_line ? 0 : (m_line - other.m_line) / difference_type(m_lineStride);
+    }
+
+    /// The element pointed to, always m_line + m_offset * m_elementStride.
+    T * m_current = nullptr;
+    T * m_line = nullptr;
+    size_t m_offset = 0;
+    size_t m_lineLength = 1;
+    size_t m_elementStride = 1;
+    size_t m_lineStride = 0;
+};
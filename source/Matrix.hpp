@@ -1,274 +1,784 @@
 #pragma once
 
 #include <stdexcept>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <vector>
 #include <type_traits>
+#include <functional>
+#include <utility>
+#include <atomic>
+#include <memory>
 #ifdef USE_INTRINSICS
 #include "xmmintrin.h"
 #include "pmmintrin.h"
 #include "emmintrin.h"
 #include "smmintrin.h"
 #endif
+#include "AlignedMemory.hpp"
+#include "StorageOrder.hpp"
+#include "BoundsCheck.hpp"
+#include "MemoryResource.hpp"
+#include "MemoryKernels.hpp"
+#include "TransposeKernels.hpp"
+#include "MatrixView.hpp"
+#include "MatrixExpression.hpp"
+#include "MultiplyKernels.hpp"
 
-template <class T>
+/// Selects the constructors that leave the elements uninitialized, for matrices
+/// that are about to be overwritten completely.
+struct UninitializedTag {};
+const UninitializedTag Uninitialized = UninitializedTag();
+
+template <class T, class Order>
 class Matrix
 {
 public:
-    Matrix(size_t numRows = 4, size_t numCols = 4, T defaultValue = 0);
+    typedef T value_type;
+    typedef ElementIterator<T> iterator;
+    typedef ElementIterator<const T> const_iterator;
+
+    /// Storage comes from resource, or from MatrixKernels::DefaultResource() when it is null.
+    Matrix(size_t numRows = 4, size_t numCols = 4, T defaultValue = 0, MatrixKernels::MemoryResource * resource = nullptr);
+    /// Allocates without touching the memory, so the first writes to each page come from
+    /// whichever threads fill it in (the parallel kernels, on NUMA machines).
+    Matrix(size_t numRows, size_t numCols, UninitializedTag, MatrixKernels::MemoryResource * resource = nullptr);
+    /**
+     * Wraps numRows x numCols elements that already live at data, consecutive columns (rows,
+     * if row-major) leadingDimension elements apart, without copying them. Without a deleter
+     * the memory stays the caller's and has to outlive the matrix; with one, the matrix takes
+     * ownership and calls deleter(data) once it is done with it. Either way, a Resize or
+     * reshuffle that needs more room moves the elements to storage from resource. Nothing
+     * past the end of the last line is touched, so a buffer of leadingDimension * (lines - 1)
+     * + line length elements is enough, and copies get padded storage of their own.
+     * For foreign memory that must not be written, or with other strides, use a MatrixView.
+     */
+    Matrix(T * data, size_t numRows, size_t numCols, size_t leadingDimension, std::function<void(T *)> deleter = nullptr,
+           MatrixKernels::MemoryResource * resource = nullptr);
+    /// The copy allocates from the calling thread's default resource (see MemoryResource.hpp),
+    /// unless other is copy-on-write, in which case the two share other's buffer.
     Matrix(const Matrix & other);
+    /// Takes over the storage of other, which is left as an empty 0x0 matrix.
+    Matrix(Matrix && other) noexcept;
+    /// Creates a matrix holding a copy of the viewed elements.
+    template <class U, class = typename std::enable_if<std::is_same<typename std::remove_const<U>::type, T>::value>::type>
+    explicit Matrix(const MatrixView<U> & view, MatrixKernels::MemoryResource * resource = nullptr);
+    /// Evaluates an elementwise expression, such as A + B * 2 - C, straight into a new matrix.
+    template <class E>
+    Matrix(const MatrixExpression<E> & expression, MatrixKernels::MemoryResource * resource = nullptr);
 	~Matrix();
+
+    /// Copies other into this matrix, reusing the current buffer when it is big enough.
+    Matrix & operator=(const Matrix & other);
+    /// Takes over the storage of other, which is left as an empty 0x0 matrix.
+    Matrix & operator=(Matrix && other) noexcept;
+    /// Evaluates an elementwise expression into this matrix in a single pass, reusing the
+    /// current buffer when it is big enough. The expression may read this matrix.
+    template <class E>
+    Matrix & operator=(const MatrixExpression<E> & expression);
+    /// Elementwise updates, fused into one pass like any other expression.
+    template <class X>
+    Matrix & operator+=(const X & rhs) { return *this = *this + rhs; }
+    template <class X>
+    Matrix & operator-=(const X & rhs) { return *this = *this - rhs; }
+    Matrix & operator*=(T scalar) { return *this = *this * scalar; }
+    Matrix & operator/=(T scalar) { return *this = *this / scalar; }
+    /// Exchanges the contents of two matrices without copying any elements.
+    void Swap(Matrix & other) noexcept;
 	
-    /// Fetches the element at the given coordinates
-    const T & operator()(size_t row, size_t col) const { return Get(row, col); }
-    /// Fetches the element at the given coordinates
-    T & operator()(size_t row, size_t col) { return Get(row, col); }
+    /// Fetches the element at the given coordinates, checked as BoundsChecking<T> says.
+    const T & operator()(size_t row, size_t col) const {
+        if(BoundsChecking<T>::value) MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+        return GetUnchecked(row, col);
+    }
+    /// Fetches the element at the given coordinates, checked as BoundsChecking<T> says.
+    T & operator()(size_t row, size_t col) {
+        if(BoundsChecking<T>::value) MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+        return GetUnchecked(row, col);
+    }
 	/// Fetches the element at the given coordinates
 	const T & Get(size_t row, size_t col) const;
 	/// Fetches the element at the given coordinates
 	T & Get(size_t row, size_t col);
+    /// Fetches the element at the given coordinates, which must be in range.
+    const T & GetUnchecked(size_t row, size_t col) const { return m_data[Index(row, col)]; }
+    /// Fetches the element at the given coordinates, which must be in range.
+    /// For tight loops over a copy-on-write matrix, write through View() instead,
+    /// which detaches once rather than checking on every element.
+    T & GetUnchecked(size_t row, size_t col) {
+        Detach();
+        return m_data[Index(row, col)];
+    }
     
     size_t Rows() const { return m_rows; }
     size_t Columns() const { return m_columns; }
-    Matrix operator*(const Matrix & rhs);
+    /// Distance, in elements, between the starts of consecutive columns (rows, if row-major).
+    size_t LeadingDimension() const { return m_ld; }
+    /// True when there is no padding between columns (rows, if row-major).
+    bool IsContiguous() const { return m_ld == LineLength(); }
+    /// Number of elements the current buffer can hold, padding included.
+    size_t Capacity() const { return m_capacity; }
+    /// The resource the buffer is allocated from.
+    MatrixKernels::MemoryResource * Resource() const { return m_resource; }
+    /// True when the elements live in the small buffer inside this object.
+    bool IsInline() const { return m_data == InlineData(); }
+    /// True when the elements live in memory handed to the constructor by the caller.
+    bool IsExternal() const { return m_external; }
+    /**
+     * Opts this matrix into copy-on-write. Copies made from it share its buffer, and are
+     * copy-on-write themselves, until one of them is written through a mutable accessor
+     * (operator(), Get, View, Block, ...) and takes a private copy. Copying is O(1) until then.
+     * The owner count is atomic, so copies may be made and dropped on any thread, but as
+     * with any matrix, one object must not be used from two threads while one writes to it.
+     * Matrices in the inline small buffer copy so cheaply that they never share, and external
+     * storage is never shared either; copies of such matrices are ordinary deep copies.
+     */
+    void EnableCopyOnWrite();
+    bool IsCopyOnWrite() const { return m_copyOnWrite; }
+    /// True while another matrix shares this matrix's buffer.
+    bool IsShared() const { return m_references && m_references->load(std::memory_order_acquire) > 1; }
+    /// Changes the dimensions. The buffer is only reallocated if it is too small,
+    /// and the element values are unspecified afterwards.
+    void Resize(size_t numRows, size_t numCols);
+    /// Reinterprets the elements, taken in storage order, as a numRows x numCols matrix.
+    /// The element count must stay the same. Nothing is copied if the matrix is contiguous.
+    void Reshape(size_t numRows, size_t numCols);
+    /// Returns a view onto the elements of this matrix.
+    MatrixView<T> View() {
+        Detach();
+        return MatrixView<T>(m_data, m_rows, m_columns, Order::RowStride(m_ld), Order::ColumnStride(m_ld));
+    }
+    /// Returns a view onto the elements of this matrix.
+    MatrixView<const T> View() const {
+        return MatrixView<const T>(m_data, m_rows, m_columns, Order::RowStride(m_ld), Order::ColumnStride(m_ld));
+    }
+    /// Views of part of this matrix. Nothing is copied; see MatrixView::Block and friends.
+    MatrixView<T> Block(size_t row, size_t col, size_t numRows, size_t numCols) { return View().Block(row, col, numRows, numCols); }
+    MatrixView<const T> Block(size_t row, size_t col, size_t numRows, size_t numCols) const { return View().Block(row, col, numRows, numCols); }
+    MatrixView<T> RowRange(size_t first, size_t count) { return View().RowRange(first, count); }
+    MatrixView<const T> RowRange(size_t first, size_t count) const { return View().RowRange(first, count); }
+    MatrixView<T> ColumnRange(size_t first, size_t count) { return View().ColumnRange(first, count); }
+    MatrixView<const T> ColumnRange(size_t first, size_t count) const { return View().ColumnRange(first, count); }
+    MatrixView<T> Row(size_t row) { return View().Row(row); }
+    MatrixView<const T> Row(size_t row) const { return View().Row(row); }
+    MatrixView<T> Column(size_t col) { return View().Column(col); }
+    MatrixView<const T> Column(size_t col) const { return View().Column(col); }
+    MatrixView<T> Slice(size_t row, size_t col, size_t numRows, size_t numCols, size_t rowStep, size_t colStep) {
+        return View().Slice(row, col, numRows, numCols, rowStep, colStep);
+    }
+    MatrixView<const T> Slice(size_t row, size_t col, size_t numRows, size_t numCols, size_t rowStep, size_t colStep) const {
+        return View().Slice(row, col, numRows, numCols, rowStep, colStep);
+    }
+    /// Pointer to the first element. Lines are LeadingDimension() elements apart, so the
+    /// elements are data()[0, size()) only when IsContiguous().
+    T * data() { Detach(); return m_data; }
+    const T * data() const { return m_data; }
+    /// Number of elements, padding excluded.
+    size_t size() const { return m_rows * m_columns; }
+    /// Iterates over the elements in storage order (down each column, or along each row
+    /// if row-major), skipping the padding between lines.
+    iterator begin() { Detach(); return iterator(m_data, 0, LineLength(), 1, m_ld); }
+    iterator end() { Detach(); return iterator(m_data + LineCount() * m_ld, 0, LineLength(), 1, m_ld); }
+    const_iterator begin() const { return const_iterator(m_data, 0, LineLength(), 1, m_ld); }
+    const_iterator end() const { return const_iterator(m_data + LineCount() * m_ld, 0, LineLength(), 1, m_ld); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+    Matrix operator*(const Matrix & rhs) const;
+    /// Sets this matrix to lhs * rhs, reusing the current buffer when it is big enough.
+    void AssignProduct(const MatrixView<const T> & lhs, const MatrixView<const T> & rhs);
     /// Returns the transpose of this matrix
     Matrix Transpose() const;   
+    /// Writes the transpose of this matrix into result, reusing its buffer when it is big enough.
+    void TransposeInto(Matrix & result) const;
+    /// Returns a view of the transpose of this matrix. Nothing is copied until it is materialized.
+    MatrixView<const T> TransposeView() const { return View().Transpose(); }
+    /// Transposes this matrix in its own storage, swapping the row and column counts.
+    void TransposeInPlace();
 private:
 	/// Converts the 2D element coord to a 1D index
 	size_t Index(const size_t & x, const size_t & y) const;
-    /// Returns the vector of pointers to elements in the row at the given index.
-    std::vector<T*> GetRow(size_t row);
-    /// Returns a pointer to the first element in a column.
-    T* GetColumn(size_t col);
-    const T* GetColumn(size_t col) const;
+    /// Returns a pointer to the first element in a column (row, if row-major).
+    T* GetLine(size_t line);
+    const T* GetLine(size_t line) const;
+    /// Length of a contiguous column (row, if row-major).
+    size_t LineLength() const { return Order::LineLength(m_rows, m_columns); }
+    /// Number of columns (rows, if row-major).
+    size_t LineCount() const { return Order::LineCount(m_rows, m_columns); }
+    /// Elements from the start of the first line to the end of the last, leaving out the padding after it.
+    size_t UsedLength() const { return m_ld * (LineCount() - 1) + LineLength(); }
+    /// Replaces the buffer with a new, uninitialized one of count elements.
+    void Allocate(size_t count);
+    /// Returns the buffer to the resource, or drops this matrix's share of it,
+    /// leaving no storage behind.
+    void Release();
+    /// Starts sharing other's copy-on-write buffer. This matrix must not hold any storage.
+    void ShareFrom(const Matrix & other);
+    /// Takes a private copy of the buffer if another matrix shares it. Called before any write.
+    void Detach();
+    /// Takes over the elements of other, which is left as an empty 0x0 matrix.
+    /// This matrix must not hold any storage.
+    void MoveFrom(Matrix & other);
+    T * InlineData() { return reinterpret_cast<T *>(m_inline); }
+    const T * InlineData() const { return reinterpret_cast<const T *>(m_inline); }
+    static size_t InlineCapacity() { return MatrixKernels::kSmallBufferBytes / sizeof(T); }
+    /// Sets the dimensions, keeping the current buffer if it has room.
+    /// Element values are unspecified afterwards.
+    void SetShape(size_t numRows, size_t numCols);
+    /// Removes any padding between the lines, leaving m_ld == LineLength().
+    void PackLines();
+    /// Spreads packed lines out to the preferred leading dimension if the buffer has room.
+    void PadLines();
+    /// True if the view's address range meets this matrix's buffer, which reshaping may rewrite anywhere.
+    bool Overlaps(const MatrixView<const T> & view) const;
 
     /// The # of rows in this matrix.
-    const size_t m_rows;
+    size_t m_rows;
 	/// The # of columns in this matrix.
-	const size_t m_columns;
+	size_t m_columns;
+    /**
+     * The distance between the starts of consecutive columns (>= m_rows), or rows for
+     * row-major matrices. Lines are padded to whole SIMD registers, plus a cache line
+     * when the stride would otherwise alias in the cache. See AlignedMemory.hpp.
+     */
+    size_t m_ld;
 
 	/**
 	 * The array holding the elements.
 	 * 1D array is more efficient than a 2D array with 
-	 * separately allocated lines.
+	 * separately allocated lines. Aligned to a cache line,
+	 * or points at m_inline for small matrices.
 	 */
 	T * m_data = nullptr;
+    /// The # of elements m_data has room for.
+    size_t m_capacity = 0;
+    /// Where m_data came from, and where it goes back to.
+    MatrixKernels::MemoryResource * m_resource = MatrixKernels::DefaultResource();
+    /// Number of matrices sharing m_data, for copy-on-write heap buffers. Null otherwise.
+    std::atomic<size_t> * m_references = nullptr;
+    /// Whether copies of this matrix share its buffer. See EnableCopyOnWrite().
+    bool m_copyOnWrite = false;
+    /// Whether m_data was supplied by the caller rather than allocated here.
+    bool m_external = false;
+    /// Frees external storage. Empty when the caller kept ownership.
+    std::function<void(T *)> m_deleter;
+    /// Storage for matrices of up to kSmallBufferBytes, e.g. the many 2x2 to 6x6 blocks
+    /// of a filter, which would otherwise each cost an allocation.
+    alignas(16) unsigned char m_inline[MatrixKernels::kSmallBufferBytes];
+
+    static_assert(std::is_trivially_copyable<T>::value, "Matrix elements are moved around as raw memory");
 };
 
-template <class T>
-Matrix<T>::Matrix(size_t numRows, size_t numCols, T defaultValue): m_rows(numRows), m_columns(numCols) {
+template <class T, class Order>
+Matrix<T, Order>::Matrix(size_t numRows, size_t numCols, T defaultValue, MatrixKernels::MemoryResource * resource)
+: m_rows(numRows), m_columns(numCols), m_resource(resource ? resource : MatrixKernels::DefaultResource()) {
     if(numRows * numCols == 0) throw std::invalid_argument("Error. Cannot create matrix with 0 dimension(s)");
     
-    m_data = new T[numRows * numCols];
-	std::fill(m_data, m_data + (numRows * numCols), defaultValue);
+    m_ld = MatrixKernels::LeadingDimension<T>(LineLength(), LineCount());
+    Allocate(m_ld * LineCount());
+    //The padding is filled too, so the whole buffer can be written in one pass.
+	MatrixKernels::Fill(m_data, m_ld * LineCount(), defaultValue);
+}
+
+template <class T, class Order>
+Matrix<T, Order>::Matrix(size_t numRows, size_t numCols, UninitializedTag, MatrixKernels::MemoryResource * resource)
+: m_rows(numRows), m_columns(numCols), m_resource(resource ? resource : MatrixKernels::DefaultResource()) {
+    if(numRows * numCols == 0) throw std::invalid_argument("Error. Cannot create matrix with 0 dimension(s)");
+
+    m_ld = MatrixKernels::LeadingDimension<T>(LineLength(), LineCount());
+    Allocate(m_ld * LineCount());
+}
+
+template <class T, class Order>
+Matrix<T, Order>::Matrix(T * data, size_t numRows, size_t numCols, size_t leadingDimension, std::function<void(T *)> deleter,
+                         MatrixKernels::MemoryResource * resource)
+: m_rows(numRows), m_columns(numCols), m_ld(leadingDimension), m_resource(resource ? resource : MatrixKernels::DefaultResource()),
+  m_external(true), m_deleter(std::move(deleter)) {
+    if(numRows * numCols == 0) throw std::invalid_argument("Error. Cannot create matrix with 0 dimension(s)");
+    if(!data) throw std::invalid_argument("Invalid argument. External storage must not be null");
+    if(leadingDimension < LineLength())
+        throw std::invalid_argument("Invalid argument. The leading dimension is shorter than a line of the matrix");
+
+    m_data = data;
+    //The last line need not be followed by padding, as with BLAS-style ld * (n - 1) + m buffers.
+    m_capacity = UsedLength();
+}
+
+template <class T, class Order>
+Matrix<T, Order>::Matrix(const Matrix<T, Order> & other)
+: m_rows(other.m_rows), m_columns(other.m_columns), m_ld(other.m_ld), m_copyOnWrite(other.m_copyOnWrite) {
+    if(other.m_references) {
+        ShareFrom(other);
+        return;
+    }
+    if(other.m_external) {
+        //Caller memory may have any leading dimension, so copy the lines into padded storage of our own.
+        m_ld = MatrixKernels::LeadingDimension<T>(LineLength(), LineCount());
+        Allocate(m_ld * LineCount());
+        MatrixKernels::CopyToColumnMajor(Order::AsColumnMajor(other.View()), m_data, m_ld);
+        return;
+    }
+    Allocate(m_ld * LineCount());
+    MatrixKernels::Copy(other.m_data, m_data, UsedLength());
+}
+
+template <class T, class Order>
+Matrix<T, Order>::Matrix(Matrix<T, Order> && other) noexcept: m_rows(0), m_columns(0), m_ld(0) {
+    MoveFrom(other);
+}
+
+template <class T, class Order>
+template <class U, class>
+Matrix<T, Order>::Matrix(const MatrixView<U> & view, MatrixKernels::MemoryResource * resource)
+: m_rows(view.Rows()), m_columns(view.Columns()), m_resource(resource ? resource : MatrixKernels::DefaultResource()) {
+    m_ld = MatrixKernels::LeadingDimension<T>(LineLength(), LineCount());
+    Allocate(m_ld * LineCount());
+    MatrixKernels::CopyToColumnMajor(Order::AsColumnMajor(MatrixView<const T>(view)), m_data, m_ld);
+}
+
+template <class T, class Order>
+template <class E>
+Matrix<T, Order>::Matrix(const MatrixExpression<E> & expression, MatrixKernels::MemoryResource * resource)
+: m_rows(expression.Rows()), m_columns(expression.Columns()), m_resource(resource ? resource : MatrixKernels::DefaultResource()) {
+    static_assert(std::is_same<typename E::ValueType, T>::value, "The expression must have the element type of the matrix");
+    m_ld = MatrixKernels::LeadingDimension<T>(LineLength(), LineCount());
+    Allocate(m_ld * LineCount());
+    MatrixKernels::Evaluate(expression.Self(), View());
 }
 
 template <class T>
-Matrix<T>::Matrix(const Matrix<T> & other): m_rows(other.m_rows), m_columns(other.m_columns) {
-    m_data = new T[m_rows * m_columns];
-    std::copy(other.m_data, other.m_data + (m_rows * m_columns), m_data);
+Matrix<typename MatrixView<T>::ValueType> MatrixView<T>::Materialize() const {
+    return Matrix<ValueType>(*this);
 }
 
 template <class T>
-Matrix<T>::~Matrix() {
-    delete[] m_data;
+void MatrixView<T>::Assign(const MatrixView<const ValueType> & src) const {
+    static_assert(!std::is_const<T>::value, "Cannot assign through a read-only view");
+    if(src.Rows() != m_rows || src.Columns() != m_columns)
+        throw std::invalid_argument("Invalid argument. Source and destination views must have the same dimensions");
+
+    if(MatrixKernels::Overlaps(src, MatrixView<const ValueType>(*this))) {
+        const Matrix<ValueType> copy(src);
+        MatrixKernels::Copy(copy.View(), *this);
+        return;
+    }
+    MatrixKernels::Copy(src, *this);
+}
+
+template <class T, class Order>
+Matrix<T, Order>::~Matrix() {
+    Release();
+}
+
+template <class T, class Order>
+Matrix<T, Order> & Matrix<T, Order>::operator=(const Matrix<T, Order> & other) {
+    if(this == &other)
+        return *this;
+    if(other.m_references) {
+        Release();
+        m_rows = other.m_rows;
+        m_columns = other.m_columns;
+        m_ld = other.m_ld;
+        m_copyOnWrite = true;
+        ShareFrom(other);
+        return *this;
+    }
+    //A shared buffer is about to be overwritten, so let the other owners keep it.
+    if(IsShared())
+        Release();
+
+    const size_t count = other.m_ld * other.LineCount();
+    if(other.m_external && other.m_rows * other.m_columns > m_capacity) {
+        //Caller memory may have any leading dimension, so copy the lines into padded storage.
+        const size_t ld = MatrixKernels::LeadingDimension<T>(other.LineLength(), other.LineCount());
+        Allocate(ld * other.LineCount());
+        m_ld = ld;
+        MatrixKernels::CopyToColumnMajor(Order::AsColumnMajor(other.View()), m_data, m_ld);
+    } else if(!other.m_external && (count <= m_capacity || other.m_rows * other.m_columns > m_capacity)) {
+        if(count > m_capacity)
+            Allocate(count);
+        m_ld = other.m_ld;
+        MatrixKernels::Copy(other.m_data, m_data, other.UsedLength());
+    } else {
+        //Only the packed layout fits in the current buffer.
+        m_ld = other.LineLength();
+        MatrixKernels::CopyToColumnMajor(Order::AsColumnMajor(other.View()), m_data, m_ld);
+    }
+    m_rows = other.m_rows;
+    m_columns = other.m_columns;
+    return *this;
+}
+
+template <class T, class Order>
+template <class E>
+Matrix<T, Order> & Matrix<T, Order>::operator=(const MatrixExpression<E> & expression) {
+    static_assert(std::is_same<typename E::ValueType, T>::value, "The expression must have the element type of the matrix");
+    const E & expr = expression.Self();
+    if(expr.Rows() == m_rows && expr.Columns() == m_columns) {
+        //Same shape: overwrite in place, which handles A = A + B without a temporary.
+        View().Assign(expr);
+        return *this;
+    }
+    //Reshaping moves elements around the buffer, so an expression reading it goes through a temporary.
+    if(m_capacity && expr.Reads(MatrixView<const T>(m_data, m_capacity, 1, 1, m_capacity)))
+        return *this = Matrix(expr, m_resource);
+
+    SetShape(expr.Rows(), expr.Columns());
+    MatrixKernels::Evaluate(expr, View());
+    return *this;
+}
+
+template <class T, class Order>
+Matrix<T, Order> & Matrix<T, Order>::operator=(Matrix<T, Order> && other) noexcept {
+    if(this != &other) {
+        Release();
+        MoveFrom(other);
+    }
+    return *this;
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::MoveFrom(Matrix<T, Order> & other) {
+    m_rows = other.m_rows;
+    m_columns = other.m_columns;
+    m_ld = other.m_ld;
+    m_resource = other.m_resource;
+    if(other.IsInline()) {
+        //Inline elements can't change hands, so they are copied. There are only a few of them.
+        std::copy(other.m_data, other.m_data + m_ld * LineCount(), InlineData());
+        m_data = InlineData();
+    } else {
+        m_data = other.m_data;
+    }
+    m_capacity = other.m_capacity;
+    m_references = other.m_references;
+    m_copyOnWrite = other.m_copyOnWrite;
+    m_external = other.m_external;
+    m_deleter = std::move(other.m_deleter);
+
+    other.m_rows = other.m_columns = other.m_ld = other.m_capacity = 0;
+    other.m_data = nullptr;
+    other.m_references = nullptr;
+    other.m_external = false;
+    other.m_deleter = nullptr;
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::Swap(Matrix<T, Order> & other) noexcept {
+    if(IsInline() || other.IsInline()) {
+        Matrix<T, Order> temp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(temp);
+        return;
+    }
+    std::swap(m_rows, other.m_rows);
+    std::swap(m_columns, other.m_columns);
+    std::swap(m_ld, other.m_ld);
+    std::swap(m_data, other.m_data);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_resource, other.m_resource);
+    std::swap(m_references, other.m_references);
+    std::swap(m_copyOnWrite, other.m_copyOnWrite);
+    std::swap(m_external, other.m_external);
+    std::swap(m_deleter, other.m_deleter);
+}
+
+template <class T, class Order>
+void swap(Matrix<T, Order> & a, Matrix<T, Order> & b) noexcept {
+    a.Swap(b);
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::Allocate(size_t count) {
+    if(count <= InlineCapacity()) {
+        Release();
+        m_data = InlineData();
+        m_capacity = InlineCapacity();
+        return;
+    }
+    std::unique_ptr<std::atomic<size_t>> references(m_copyOnWrite ? new std::atomic<size_t>(1) : nullptr);
+    T * data = static_cast<T *>(m_resource->Allocate(count * sizeof(T)));
+    Release();
+    m_data = data;
+    m_capacity = count;
+    m_references = references.release();
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::Release() {
+    //Only the last owner of a shared buffer frees it.
+    const bool lastOwner = !m_references || m_references->fetch_sub(1, std::memory_order_acq_rel) == 1;
+    if(m_external) {
+        if(m_deleter)
+            m_deleter(m_data);
+    } else if(lastOwner) {
+        if(m_data && !IsInline())
+            m_resource->Deallocate(m_data, m_capacity * sizeof(T));
+        delete m_references;
+    }
     m_data = nullptr;
+    m_capacity = 0;
+    m_references = nullptr;
+    m_external = false;
+    m_deleter = nullptr;
 }
 
-template <class T>
-size_t Matrix<T>::Index(const size_t & row, const size_t & col) const {
-    return col * m_rows + row; // Matrix is stored in COLUMN major
+template <class T, class Order>
+void Matrix<T, Order>::ShareFrom(const Matrix<T, Order> & other) {
+    other.m_references->fetch_add(1, std::memory_order_relaxed);
+    m_data = other.m_data;
+    m_capacity = other.m_capacity;
+    m_resource = other.m_resource;
+    m_references = other.m_references;
 }
 
-template <class T>
-const T & Matrix<T>::Get(size_t row, size_t col) const {
-	if(row >= m_rows || col >= m_columns)
-        throw std::invalid_argument( "Invalid element coordinate" );
-    return m_data[Index(row, col)];
+template <class T, class Order>
+void Matrix<T, Order>::Detach() {
+    if(!IsShared())
+        return;
+
+    //Copy before letting go, since the other owners may free the buffer as soon as we do.
+    const size_t count = m_ld * LineCount();
+    std::unique_ptr<std::atomic<size_t>> references(new std::atomic<size_t>(1));
+    T * data = static_cast<T *>(m_resource->Allocate(count * sizeof(T)));
+    MatrixKernels::Copy(m_data, data, UsedLength());
+    Release();
+    m_data = data;
+    m_capacity = count;
+    m_references = references.release();
 }
 
-template <class T>
-T & Matrix<T>::Get(size_t row, size_t col) {
-    if(row >= m_rows || col >= m_columns)
-        throw std::invalid_argument( "Invalid element coordinate" );
-    return m_data[Index(row, col)];
+template <class T, class Order>
+void Matrix<T, Order>::EnableCopyOnWrite() {
+    m_copyOnWrite = true;
+    if(!m_references && m_data && !IsInline() && !m_external)
+        m_references = new std::atomic<size_t>(1);
 }
 
-template <class T>
-std::vector<T*> Matrix<T>::GetRow(size_t rowIndex) {
-    // This method is called only by fns that error check, so no need to check rowIndex
-    std::vector<T*> row;
-    row.reserve(m_columns);
-    for(size_t i = 0; i < m_columns; i++) {
-        auto ptr = &Get(rowIndex, i);
-        row.push_back(ptr);
+template <class T, class Order>
+void Matrix<T, Order>::SetShape(size_t numRows, size_t numCols) {
+    if(numRows * numCols == 0) throw std::invalid_argument("Error. Cannot create matrix with 0 dimension(s)");
+
+    const size_t lineLength = Order::LineLength(numRows, numCols);
+    const size_t lineCount = Order::LineCount(numRows, numCols);
+    size_t ld = MatrixKernels::LeadingDimension<T>(lineLength, lineCount);
+    //The values are unspecified afterwards, so a shared buffer is simply left to the other owners.
+    if(IsShared())
+        Release();
+    //Give up the padding before giving up the buffer.
+    if(ld * lineCount > m_capacity && lineLength * lineCount <= m_capacity)
+        ld = lineLength;
+    if(ld * lineCount > m_capacity)
+        Allocate(ld * lineCount);
+
+    m_rows = numRows;
+    m_columns = numCols;
+    m_ld = ld;
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::PackLines() {
+    MatrixKernels::ChangeLeadingDimension(m_data, LineLength(), LineCount(), m_ld, LineLength());
+    m_ld = LineLength();
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::PadLines() {
+    const size_t ld = MatrixKernels::LeadingDimension<T>(LineLength(), LineCount());
+    if(ld * LineCount() <= m_capacity) {
+        MatrixKernels::ChangeLeadingDimension(m_data, LineLength(), LineCount(), m_ld, ld);
+        m_ld = ld;
     }
-    
-    return row;
 }
 
-// Since Matrix is stored in column major, just return a pointer to the first element in the column.
-template <class T>
-T* Matrix<T>::GetColumn(size_t colIndex) {
-    // This method is called only by fns that error check, so no need to check colIndex
-    auto ptr = m_data + colIndex * m_rows;
-    return ptr;
+template <class T, class Order>
+bool Matrix<T, Order>::Overlaps(const MatrixView<const T> & view) const {
+    return m_capacity && MatrixKernels::Overlaps(view, MatrixView<const T>(m_data, m_capacity, 1, 1, m_capacity));
 }
 
-// Since Matrix is stored in column major, just return a pointer to the first element in the column.
-template <class T>
-const T* Matrix<T>::GetColumn(size_t colIndex) const {
-    // This method is called only by fns that error check, so no need to check colIndex
-    auto ptr = m_data + colIndex * m_rows;
+template <class T, class Order>
+void Matrix<T, Order>::Resize(size_t numRows, size_t numCols) {
+    SetShape(numRows, numCols);
+}
+
+template <class T, class Order>
+void Matrix<T, Order>::Reshape(size_t numRows, size_t numCols) {
+    if(numRows * numCols != m_rows * m_columns)
+        throw std::invalid_argument("Invalid argument. Reshape must keep the number of elements");
+
+    Detach();
+    //Packed lines are already in storage order, so only the dimensions change. Padding
+    //is only worth restoring when the elements have to be moved to squeeze it out anyway.
+    const bool repack = !IsContiguous();
+    if(repack)
+        PackLines();
+    m_rows = numRows;
+    m_columns = numCols;
+    m_ld = LineLength();
+    if(repack)
+        PadLines();
+}
+
+template <class T, class Order>
+size_t Matrix<T, Order>::Index(const size_t & row, const size_t & col) const {
+    return Order::Index(row, col, m_ld);
+}
+
+template <class T, class Order>
+const T & Matrix<T, Order>::Get(size_t row, size_t col) const {
+    MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+    return GetUnchecked(row, col);
+}
+
+template <class T, class Order>
+T & Matrix<T, Order>::Get(size_t row, size_t col) {
+    MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+    return GetUnchecked(row, col);
+}
+
+// Lines are contiguous, so just return a pointer to the first element in the line.
+template <class T, class Order>
+T* Matrix<T, Order>::GetLine(size_t lineIndex) {
+    // This method is called only by fns that error check, so no need to check lineIndex
+    auto ptr = m_data + lineIndex * m_ld;
     return ptr;
 }
 
-#ifdef USE_INTRINSICS //Version of the fn that use SSE2 intrinsics.
+// Lines are contiguous, so just return a pointer to the first element in the line.
+template <class T, class Order>
+const T* Matrix<T, Order>::GetLine(size_t lineIndex) const {
+    // This method is called only by fns that error check, so no need to check lineIndex
+    auto ptr = m_data + lineIndex * m_ld;
+    return ptr;
+}
 
-template <class T>
-Matrix<T> Matrix<T>::operator*(const Matrix<T> & rhs) {
+// The operands can be any mix of matrices and views, e.g. A.TransposeView() * B
+// multiplies by the transpose of A without ever building it. Order picks the storage
+// order of the result.
+template <class Order = ColumnMajor, class T>
+Matrix<T, Order> Multiply(const MatrixView<const T> & lhs, const MatrixView<const T> & rhs) {
     //My # of columns (width) must equal # of rows (height) in other matrix.
-    if(m_columns != rhs.m_rows)
+    if(lhs.Columns() != rhs.Rows())
         throw std::invalid_argument("Invalid argument. Width (columns) of first matrix must match height (rows) of second matrix");
-    
+
     //Note that the length of each row is num columns and vice versa.
-    Matrix<T> result(m_rows, rhs.m_columns);
-
-   #pragma omp parallel for
-    for (size_t i = 0; i < m_rows; i++) {
-        T * rowData = new T[m_columns];
-        
-        for (size_t j = 0; j < rhs.m_columns; j++) {
-            std::vector<T*> rowA = GetRow(i);
-            //Copy the row elements into a contiguous array.
-            for(size_t h = 0; h < m_columns; h++) {
-                auto elemPtr = rowA.at(h);
-                rowData[h] = *elemPtr;
-            }
-            //Get the column data.           
-            const T* colB = rhs.GetColumn(j);
-            
-            T res = 0;
-            size_t k = 0;
-            
-            //Need to handle each type separately for SIMD.
-            if(std::is_same<float, T>::value) {
-                //Process using SIMD
-                for(; k + 3 < m_columns; k+=4) {
-                    __m128 colVec = _mm_loadu_ps((float *)(colB + k));
-                    __m128 rowVec = _mm_loadu_ps((float *)(rowData + k));
-                    __m128 prodSum = _mm_mul_ps(colVec, rowVec);
-                    //The _mm_hadd_ps only adds adjacent elements, so run twice to get
-                    //full horizontal add.
-                    //prodsum = { p3, p2, p1, p0 }
-                    prodSum = _mm_hadd_ps(prodSum, prodSum);
-                    //prodSum = { p3 + p2, p1 + p0, p3 + p2, p1 + p0 }
-                    prodSum = _mm_hadd_ps(prodSum, prodSum);
-                    //prodSum = { p3 + p2 + p1 + p0, p3 + p2 + p1 + p0, p3 + p2 + p1 + p0, p3 + p2 + p1 + p0 }
-                    //Other sums are superfluous but don't incur penalty.
-                    float temp;
-                    _mm_store_ss(&temp, prodSum);
-                    res += temp;
-                    
-                }
-            } else if(std::is_same<double, T>::value) {
-                for(; k + 1 < m_columns; k+=2) {
-                    __m128d colVec = _mm_loadu_pd((double *)(colB + k));
-                    __m128d rowVec = _mm_loadu_pd((double *)(rowData + k));
-                    __m128d prodSum = _mm_mul_pd(colVec, rowVec);
-                    prodSum = _mm_hadd_pd(prodSum, prodSum);
-                    double temp;
-                    _mm_store_sd(&temp, prodSum);
-                    res += temp;
-                    
-                }
-            }
-            //Unfortunately, Intel SSE intrinsics for integer multiplication & addition
-            //are not as robust as floating point. Given time, I believe there is a way
-            //to write an vector SIMD implementation for integer matrices that is faster
-            //than scalar arithmetic, but it isn't trivial, so I've tabled that for later.
-            /*
-            else if(std::is_same<int, T>::value) {
-                for (; k + 3 < m_columns; k+=4) {
-                    __m128i colVec = _mm_load_si128((__m128i*)colB + k);
-                    __m128i rowVec = _mm_load_si128((__m128i*)rowData + k);
-                    __m128i product = _mm_mullo_epi32(colVec, rowVec);
-                    //Unfortunately, there is not horizontal add fn for ints, so
-                    //need to extract and sum scalar wise
-                    int tempVec[4];
-                    _mm_storeu_si128((__m128i*)&tempVec, product);
-                    for(size_t m = 0; m < 4; m++)
-                        res += tempVec[m];
-                }
-            }
-            */
-            
-            //Process the remainder values using standard scalar arithmetic.
-            for(; k < m_columns; k++)
-                res += (rowData[k] * colB[k]);
-            
-            result(i, j) = res;
-            rowA.clear();
-        }
-        delete[] rowData;
-    }
-    
+    Matrix<T, Order> result(lhs.Rows(), rhs.Columns(), Uninitialized);
+    MatrixKernels::Multiply(lhs, rhs, result.View());
     return result;
 }
 
-#else
-
-template <class T>
-Matrix<T> Matrix<T>::operator*(const Matrix<T> & rhs) {
-    //My # of columns (width) must equal # of rows (height) in other matrix.
-    if(m_columns != rhs.m_rows)
+// Writes the product into an existing view, such as a block of a larger matrix, without
+// allocating. The result may overlap the operands, in which case it goes through a temporary.
+template <class U, class V, class T>
+void Multiply(const MatrixView<U> & lhs, const MatrixView<V> & rhs, const MatrixView<T> & result) {
+    static_assert(!std::is_const<T>::value, "Cannot write a product through a read-only view");
+    const MatrixView<const T> a(lhs), b(rhs);
+    if(a.Columns() != b.Rows())
         throw std::invalid_argument("Invalid argument. Width (columns) of first matrix must match height (rows) of second matrix");
-    
-    //Note that the length of each row is num columns and vice versa.
-    //LHS = A, RHS = B
-    Matrix<T> result(m_rows, rhs.m_columns);
-    #pragma omp parallel for
-    for (size_t i = 0; i < m_rows; i++) {
-        for (size_t j = 0; j < rhs.m_columns; j++) {
-            auto rowA = GetRow(i);
-            const T* colB = rhs.GetColumn(j);
-            
-            T res = 0;
-            for(size_t k = 0; k < m_columns; k++) {
-                res += ( *(rowA.at(k)) * colB[k]);
-            }
-            result(i, j) = res;
-        }
+    if(result.Rows() != a.Rows() || result.Columns() != b.Columns())
+        throw std::invalid_argument("Invalid argument. The result must have the rows of the first matrix and the columns of the second");
+
+    const MatrixView<const T> out(result);
+    if(MatrixKernels::Overlaps(a, out) || MatrixKernels::Overlaps(b, out)) {
+        result.Assign(Multiply(a, b).View());
+        return;
     }
-    
-    return result;
+    MatrixKernels::Multiply(a, b, result);
 }
 
-#endif
+template <class T, class Order>
+Matrix<T, Order> Matrix<T, Order>::operator*(const Matrix<T, Order> & rhs) const {
+    return Multiply<Order>(View(), rhs.View());
+}
 
-template <class T>
-Matrix<T> Matrix<T>::Transpose() const {
-    Matrix<T> transpose(m_columns, m_rows);
-
-    #pragma omp parallel for
-    for (int i = 0; i < m_rows; i++)
-    {
-        for (int j = 0; j < m_columns; j++)
-        {
-            transpose(j,i) = Get(i, j);   
-        }
+template <class T, class Order>
+void Matrix<T, Order>::AssignProduct(const MatrixView<const T> & lhs, const MatrixView<const T> & rhs) {
+    //Writing the product over one of its own operands would corrupt it, so go through a temporary.
+    if(Overlaps(lhs) || Overlaps(rhs)) {
+        *this = Multiply<Order>(lhs, rhs);
+        return;
     }
+    if(lhs.Columns() != rhs.Rows())
+        throw std::invalid_argument("Invalid argument. Width (columns) of first matrix must match height (rows) of second matrix");
+
+    SetShape(lhs.Rows(), rhs.Columns());
+    MatrixKernels::Multiply(lhs, rhs, View());
+}
+
+template <class U, class V>
+Matrix<typename std::remove_const<U>::type> operator*(const MatrixView<U> & lhs, const MatrixView<V> & rhs) {
+    typedef typename std::remove_const<U>::type T;
+    return Multiply(MatrixView<const T>(lhs), MatrixView<const T>(rhs));
+}
 
+template <class T, class Order, class U>
+Matrix<T, Order> operator*(const Matrix<T, Order> & lhs, const MatrixView<U> & rhs) {
+    return Multiply<Order>(lhs.View(), MatrixView<const T>(rhs));
+}
+
+template <class T, class Order, class U>
+Matrix<T, Order> operator*(const MatrixView<U> & lhs, const Matrix<T, Order> & rhs) {
+    return Multiply<Order>(MatrixView<const T>(lhs), rhs.View());
+}
+
+// Mixed storage orders; the result takes the order of the left operand.
+template <class T, class LhsOrder, class RhsOrder>
+Matrix<T, LhsOrder> operator*(const Matrix<T, LhsOrder> & lhs, const Matrix<T, RhsOrder> & rhs) {
+    return Multiply<LhsOrder>(lhs.View(), rhs.View());
+}
+
+// Blocked, cache-oblivious transpose with SIMD micro kernels. See TransposeKernels.hpp.
+template <class T, class Order>
+Matrix<T, Order> Matrix<T, Order>::Transpose() const {
+    Matrix<T, Order> transpose(m_columns, m_rows, Uninitialized);
+    MatrixKernels::Transpose(m_data, m_ld, transpose.m_data, transpose.m_ld, LineLength(), LineCount());
     return transpose;
 }
 
-template <class T>
-std::ostream & operator<<(std::ostream & out, const Matrix<T> & m) {
+template <class T, class Order>
+void Matrix<T, Order>::TransposeInto(Matrix<T, Order> & result) const {
+    if(&result == this) {
+        result.TransposeInPlace();
+        return;
+    }
+    result.SetShape(m_columns, m_rows);
+    MatrixKernels::Transpose(m_data, m_ld, result.m_data, result.m_ld, LineLength(), LineCount());
+}
+
+// Writes the transpose of src into result, which may be a block of a larger matrix.
+// Runs the blocked transpose kernel whenever the two layouts differ.
+template <class U, class T>
+void Transpose(const MatrixView<U> & src, const MatrixView<T> & result) {
+    result.Assign(MatrixView<const T>(src).Transpose());
+}
+
+// Square matrices swap mirrored blocks; rectangular ones use a three pass in-place shuffle.
+// Neither allocates more than a few columns of scratch per thread. See TransposeKernels.hpp.
+template <class T, class Order>
+void Matrix<T, Order>::TransposeInPlace() {
+    Detach();
+    if(m_rows == m_columns) {
+        MatrixKernels::TransposeInPlaceSquare(m_data, m_ld, m_rows);
+        return;
+    }
+
+    //The rectangular shuffle needs packed lines. Squeeze out the padding first,
+    //then pad the new lines again if the buffer has room for it.
+    PackLines();
+    if(m_rows > 1 && m_columns > 1) // A single row or column only needs new dimensions.
+        MatrixKernels::TransposeInPlaceRectangular(m_data, LineLength(), LineCount());
+
+    std::swap(m_rows, m_columns);
+    m_ld = LineLength();
+    PadLines();
+}
+
+template <class T, class Order>
+std::ostream & operator<<(std::ostream & out, const Matrix<T, Order> & m) {
     for (size_t i = 0; i < m.Rows(); i++) {
         for(size_t j = 0; j < m.Columns(); j++) {
-            out << m(i, j) << ' ';
+            out << m.GetUnchecked(i, j) << ' ';
         }
         out << std::endl;
     }
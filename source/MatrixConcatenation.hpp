@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+#include "Matrix.hpp"
+
+/**
+ * Joining matrices side by side or one above the other, and splitting them back up.
+ *
+ * HorizontalStack and VerticalStack take matrices, views or a list of views and return a
+ * new column-major matrix; SplitColumns and SplitRows return a new matrix for each run of
+ * columns (rows). Every part is copied with MatrixKernels::Copy, which moves an unbroken
+ * run, such as a column-major matrix without padding going into a run of whole columns,
+ * with a single parallel memcpy, copies contiguous columns one at a time, and goes through
+ * the tiled transpose or parallel blocked copies when the layouts differ.
+ *
+ * None of this is needed for a zero-copy split: ColumnRange and RowRange already view any
+ * run of columns or rows in place. Likewise MatrixView::Reshape reinterprets evenly spaced
+ * elements without copying them, and Matrix::Reshape only moves elements when there is
+ * padding between the lines to squeeze out.
+ */
+
+namespace MatrixKernels {
+
+/// Throws unless counts add up to total.
+inline void CheckSplit(const std::vector<size_t> & counts, size_t total) {
+    size_t sum = 0;
+    for(size_t count : counts) {
+        if(count == 0)
+            throw std::invalid_argument("Invalid argument. Cannot split off an empty part");
+        sum += count;
+    }
+    if(sum != total)
+        throw std::invalid_argument("Invalid argument. The parts must add up to the whole matrix");
+}
+
+} // namespace MatrixKernels
+
+/// The matrix made of parts side by side, which must all have the same number of rows.
+template <class T>
+Matrix<T> HorizontalStack(const std::vector<MatrixView<const T>> & parts) {
+    if(parts.empty())
+        throw std::invalid_argument("Invalid argument. Nothing to stack");
+    size_t columns = 0;
+    for(const MatrixView<const T> & part : parts) {
+        if(part.Rows() != parts[0].Rows())
+            throw std::invalid_argument("Invalid argument. Stacked side by side, every part must have the same number of rows");
+        columns += part.Columns();
+    }
+    Matrix<T> result(parts[0].Rows(), columns, Uninitialized);
+    size_t column = 0;
+    for(const MatrixView<const T> & part : parts) {
+        MatrixKernels::Copy(part, result.ColumnRange(column, part.Columns()));
+        column += part.Columns();
+    }
+    return result;
+}
+
+/// The matrix made of parts one above the other, which must all have the same number of columns.
+template <class T>
+Matrix<T> VerticalStack(const std::vector<MatrixView<const T>> & parts) {
+    if(parts.empty())
+        throw std::invalid_argument("Invalid argument. Nothing to stack");
+    size_t rows = 0;
+    for(const MatrixView<const T> & part : parts) {
+        if(part.Columns() != parts[0].Columns())
+            throw std::invalid_argument("Invalid argument. Stacked one above the other, every part must have the same number of columns");
+        rows += part.Rows();
+    }
+    Matrix<T> result(rows, parts[0].Columns(), Uninitialized);
+    size_t row = 0;
+    for(const MatrixView<const T> & part : parts) {
+        MatrixKernels::Copy(part, result.RowRange(row, part.Rows()));
+        row += part.Rows();
+    }
+    return result;
+}
+
+/// left and right, matrices or views, side by side.
+template <class X, class Y, class T = typename decltype(ConstView(std::declval<X>()))::ValueType>
+Matrix<T> HorizontalStack(const X & left, const Y & right) {
+    return HorizontalStack(std::vector<MatrixView<const T>>{ConstView(left), ConstView(right)});
+}
+
+/// top above bottom, matrices or views.
+template <class X, class Y, class T = typename decltype(ConstView(std::declval<X>()))::ValueType>
+Matrix<T> VerticalStack(const X & top, const Y & bottom) {
+    return VerticalStack(std::vector<MatrixView<const T>>{ConstView(top), ConstView(bottom)});
+}
+
+/// Copies of consecutive runs of columns, counts[k] columns in the k-th. The counts must add up to Columns().
+template <class X, class T = typename decltype(ConstView(std::declval<X>()))::ValueType>
+std::vector<Matrix<T>> SplitColumns(const X & source, const std::vector<size_t> & counts) {
+    const MatrixView<const T> whole = ConstView(source);
+    MatrixKernels::CheckSplit(counts, whole.Columns());
+    std::vector<Matrix<T>> parts;
+    parts.reserve(counts.size());
+    size_t column = 0;
+    for(size_t count : counts) {
+        parts.emplace_back(whole.Rows(), count, Uninitialized);
+        MatrixKernels::Copy(whole.ColumnRange(column, count), parts.back().View());
+        column += count;
+    }
+    return parts;
+}
+
+/// Copies of consecutive runs of rows, counts[k] rows in the k-th. The counts must add up to Rows().
+template <class X, class T = typename decltype(ConstView(std::declval<X>()))::ValueType>
+std::vector<Matrix<T>> SplitRows(const X & source, const std::vector<size_t> & counts) {
+    const MatrixView<const T> whole = ConstView(source);
+    MatrixKernels::CheckSplit(counts, whole.Rows());
+    std::vector<Matrix<T>> parts;
+    parts.reserve(counts.size());
+    size_t row = 0;
+    for(size_t count : counts) {
+        parts.emplace_back(count, whole.Columns(), Uninitialized);
+        MatrixKernels::Copy(whole.RowRange(row, count), parts.back().View());
+        row += count;
+    }
+    return parts;
+}
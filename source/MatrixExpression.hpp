@@ -0,0 +1,942 @@
+#pragma once
+
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include "MemoryKernels.hpp"
+#include "MatrixView.hpp"
+
+#ifdef USE_INTRINSICS
+#include "xmmintrin.h"
+#include "emmintrin.h"
+#if defined(__AVX__) || defined(__FMA__)
+#include "immintrin.h"
+#endif
+#endif
+
+/**
+ * Expression templates for elementwise arithmetic.
+ *
+ * A + B, A - B, -A, A * s, A / B, Hadamard(A, B), Min, Max, Abs, Clamp, MultiplyAdd, Map,
+ * Cast and the rest below, on matrices, views, scalars and other expressions, don't compute
+ * anything; they build a small tree of nodes that is evaluated when it is assigned to a
+ * Matrix or a MatrixView. The whole tree is then computed in a single pass over the
+ * destination, one SIMD register of each operand at a time, with no temporaries:
+ * D = A + B * 2 - C reads A, B and C once and writes D once.
+ *
+ * BroadcastRow and BroadcastColumn repeat a vector across a matrix without copying it, so
+ * A + BroadcastRow(bias, A.Rows()) adds a bias row to every row of A, and
+ * Hadamard(A, BroadcastRow(scales, A.Rows())) scales each column of A.
+ *
+ * A matrix product inside an expression, e.g. A * B + C, is computed by the GEMM kernels
+ * into a matrix first; an expression used as an operand of a product is materialized first.
+ *
+ * Like any expression template, an expression refers to its operands and must not outlive
+ * them; assign it to a matrix rather than keeping it in an auto variable.
+ */
+
+namespace MatrixKernels {
+
+/// |a|; the identity for unsigned types.
+template <class T>
+T AbsoluteValue(T a, std::true_type) { return a < T(0) ? T(-a) : a; }
+template <class T>
+T AbsoluteValue(T a, std::false_type) { return a; }
+
+/// a * b + c, rounded once for floating point types when the build has FMA instructions,
+/// so that the scalar tails match the packets.
+template <class T>
+T MultiplyAddValue(T a, T b, T c, std::true_type) {
+#ifdef __FMA__
+    return std::fma(a, b, c);
+#else
+    return a * b + c;
+#endif
+}
+template <class T>
+T MultiplyAddValue(T a, T b, T c, std::false_type) { return T(a * b + c); }
+
+/// One element at a time. The tails of every loop, and strided operands, use this.
+template <class T>
+struct ScalarPacket
+{
+    typedef T Element;
+    typedef T Type;
+    static const size_t Width = 1;
+    static Type Load(const T * p) { return *p; }
+    static void Store(T * p, Type v) { *p = v; }
+    static Type Set(T v) { return v; }
+    static Type Add(Type a, Type b) { return Type(a + b); }
+    static Type Subtract(Type a, Type b) { return Type(a - b); }
+    static Type Multiply(Type a, Type b) { return Type(a * b); }
+    static Type Divide(Type a, Type b) { return Type(a / b); }
+    static Type Negate(Type a) { return Type(-a); }
+    static Type Min(Type a, Type b) { return b < a ? b : a; }
+    static Type Max(Type a, Type b) { return a < b ? b : a; }
+    static Type Abs(Type a) { return AbsoluteValue(a, std::is_signed<T>()); }
+    static Type MultiplyAdd(Type a, Type b, Type c) { return MultiplyAddValue(a, b, c, std::is_floating_point<T>()); }
+    // Used by the functions in MatrixMath.hpp, for floating point T.
+    typedef bool Mask;
+    static Mask LessThan(Type a, Type b) { return a < b; }
+    static Mask Equal(Type a, Type b) { return a == b; }
+    static Type Select(Mask m, Type a, Type b) { return m ? a : b; }
+    static Type Sqrt(Type a) { return std::sqrt(a); }
+    static Type Round(Type a) { return std::nearbyint(a); }
+    /// 2^n for integral n in the exponent range.
+    static Type Pow2(Type n) { return n == n ? std::ldexp(Type(1), int(n)) : n; }
+    /// The mantissa of positive, normal x, in [0.5, 1), with x = mantissa * 2^exponent.
+    static Type Frexp(Type x, Type & exponent) {
+        int e = 0;
+        const Type mantissa = std::frexp(x, &e);
+        exponent = Type(e);
+        return mantissa;
+    }
+    // Used by the scans in MatrixScans.hpp: running sums across the lanes of a register.
+    static Type PrefixSum(Type a) { return a; }
+    static Type BroadcastLast(Type a) { return a; }
+    /// a moved up a lane, with first in lane 0.
+    static Type ShiftUp(Type first, Type) { return first; }
+};
+
+/// Bytes in the widest register the build targets.
+#ifdef __AVX__
+const size_t kPacketBytes = 32;
+#else
+const size_t kPacketBytes = 16;
+#endif
+
+/// A register's worth of elements as a plain array. Each operation is a fixed-length loop
+/// that the compiler turns into SIMD instructions, which covers the types without
+/// intrinsics here, such as the integer types.
+template <class T, size_t N = kPacketBytes / sizeof(T)>
+struct LanePacket
+{
+    typedef T Element;
+    struct Type { T lane[N]; };
+    static const size_t Width = N;
+    static Type Load(const T * p) { Type r; for(size_t k = 0; k < N; k++) r.lane[k] = p[k]; return r; }
+    static void Store(T * p, Type v) { for(size_t k = 0; k < N; k++) p[k] = v.lane[k]; }
+    static Type Set(T v) { Type r; for(size_t k = 0; k < N; k++) r.lane[k] = v; return r; }
+    static Type Add(Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = T(a.lane[k] + b.lane[k]); return a; }
+    static Type Subtract(Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = T(a.lane[k] - b.lane[k]); return a; }
+    static Type Multiply(Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = T(a.lane[k] * b.lane[k]); return a; }
+    static Type Divide(Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = T(a.lane[k] / b.lane[k]); return a; }
+    static Type Negate(Type a) { for(size_t k = 0; k < N; k++) a.lane[k] = T(-a.lane[k]); return a; }
+    static Type Min(Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = ScalarPacket<T>::Min(a.lane[k], b.lane[k]); return a; }
+    static Type Max(Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = ScalarPacket<T>::Max(a.lane[k], b.lane[k]); return a; }
+    static Type Abs(Type a) { for(size_t k = 0; k < N; k++) a.lane[k] = ScalarPacket<T>::Abs(a.lane[k]); return a; }
+    static Type MultiplyAdd(Type a, Type b, Type c) {
+        for(size_t k = 0; k < N; k++) a.lane[k] = ScalarPacket<T>::MultiplyAdd(a.lane[k], b.lane[k], c.lane[k]);
+        return a;
+    }
+    // Used by the functions in MatrixMath.hpp, lane by lane.
+    struct Mask { bool lane[N]; };
+    static Mask LessThan(Type a, Type b) { Mask r; for(size_t k = 0; k < N; k++) r.lane[k] = a.lane[k] < b.lane[k]; return r; }
+    static Mask Equal(Type a, Type b) { Mask r; for(size_t k = 0; k < N; k++) r.lane[k] = a.lane[k] == b.lane[k]; return r; }
+    static Type Select(Mask m, Type a, Type b) { for(size_t k = 0; k < N; k++) a.lane[k] = m.lane[k] ? a.lane[k] : b.lane[k]; return a; }
+    static Type Sqrt(Type a) { for(size_t k = 0; k < N; k++) a.lane[k] = ScalarPacket<T>::Sqrt(a.lane[k]); return a; }
+    static Type Round(Type a) { for(size_t k = 0; k < N; k++) a.lane[k] = ScalarPacket<T>::Round(a.lane[k]); return a; }
+    static Type Pow2(Type n) { for(size_t k = 0; k < N; k++) n.lane[k] = ScalarPacket<T>::Pow2(n.lane[k]); return n; }
+    static Type Frexp(Type x, Type & exponent) {
+        for(size_t k = 0; k < N; k++) x.lane[k] = ScalarPacket<T>::Frexp(x.lane[k], exponent.lane[k]);
+        return x;
+    }
+    // Used by the scans in MatrixScans.hpp.
+    static Type PrefixSum(Type a) { for(size_t k = 1; k < N; k++) a.lane[k] = T(a.lane[k - 1] + a.lane[k]); return a; }
+    static Type BroadcastLast(Type a) { return Set(a.lane[N - 1]); }
+    static Type ShiftUp(Type first, Type a) {
+        for(size_t k = N - 1; k > 0; k--) a.lane[k] = a.lane[k - 1];
+        a.lane[0] = first.lane[0];
+        return a;
+    }
+};
+
+/// The widest register the build has for T. Loads and stores are unaligned.
+template <class T>
+struct Packet : LanePacket<T> {};
+
+#ifdef USE_INTRINSICS
+#ifdef __AVX__
+
+/// Joins two 128-bit halves. The integer steps of the AVX math primitives work on halves,
+/// as 256-bit integer instructions need AVX2.
+inline __m256i CombineHalves(__m128i low, __m128i high) {
+    return _mm256_insertf128_si256(_mm256_castsi128_si256(low), high, 1);
+}
+
+template <>
+struct Packet<float>
+{
+    typedef float Element;
+    typedef __m256 Type;
+    static const size_t Width = 8;
+    static Type Load(const float * p) { return _mm256_loadu_ps(p); }
+    static void Store(float * p, Type v) { _mm256_storeu_ps(p, v); }
+    static Type Set(float v) { return _mm256_set1_ps(v); }
+    static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+    static Type Subtract(Type a, Type b) { return _mm256_sub_ps(a, b); }
+    static Type Multiply(Type a, Type b) { return _mm256_mul_ps(a, b); }
+    static Type Divide(Type a, Type b) { return _mm256_div_ps(a, b); }
+    static Type Negate(Type a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+    static Type Min(Type a, Type b) { return _mm256_min_ps(b, a); }
+    static Type Max(Type a, Type b) { return _mm256_max_ps(b, a); }
+    static Type Abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+#ifdef __FMA__
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm256_fmadd_ps(a, b, c); }
+#else
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+    // Used by the functions in MatrixMath.hpp.
+    typedef __m256 Mask;
+    static Mask LessThan(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Mask Equal(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static Type Select(Mask m, Type a, Type b) { return _mm256_blendv_ps(b, a, m); }
+    static Type Sqrt(Type a) { return _mm256_sqrt_ps(a); }
+    static Type Round(Type a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Type Pow2(Type n) {
+        const __m256i integral = _mm256_cvtps_epi32(n);
+        const __m128i bias = _mm_set1_epi32(127);
+        return _mm256_castsi256_ps(CombineHalves(_mm_slli_epi32(_mm_add_epi32(_mm256_castsi256_si128(integral), bias), 23),
+                                                 _mm_slli_epi32(_mm_add_epi32(_mm256_extractf128_si256(integral, 1), bias), 23)));
+    }
+    static Type Frexp(Type x, Type & exponent) {
+        const __m256i bits = _mm256_castps_si256(x);
+        const __m128i mask = _mm_set1_epi32(0xff), bias = _mm_set1_epi32(126);
+        const __m128i low = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(_mm256_castsi256_si128(bits), 23), mask), bias);
+        const __m128i high = _mm_sub_epi32(_mm_and_si128(_mm_srli_epi32(_mm256_extractf128_si256(bits, 1), 23), mask), bias);
+        exponent = _mm256_cvtepi32_ps(CombineHalves(low, high));
+        return _mm256_or_ps(_mm256_and_ps(x, _mm256_castsi256_ps(_mm256_set1_epi32(0x807fffff))), _mm256_set1_ps(0.5f));
+    }
+    // Used by the scans in MatrixScans.hpp. Shuffles only cross the 128-bit halves through
+    // permute2f128, so each half is scanned on its own before the low half's total is added.
+    static Type PrefixSum(Type a) {
+        const Type zero = _mm256_setzero_ps();
+        a = _mm256_add_ps(a, _mm256_blend_ps(_mm256_permute_ps(a, _MM_SHUFFLE(2, 1, 0, 3)), zero, 0x11));
+        a = _mm256_add_ps(a, _mm256_blend_ps(_mm256_permute_ps(a, _MM_SHUFFLE(1, 0, 3, 2)), zero, 0x33));
+        const Type lowTotal = _mm256_permute_ps(a, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_add_ps(a, _mm256_permute2f128_ps(lowTotal, lowTotal, 0x08));
+    }
+    static Type BroadcastLast(Type a) {
+        const Type last = _mm256_permute_ps(a, _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm256_permute2f128_ps(last, last, 0x11);
+    }
+    static Type ShiftUp(Type first, Type a) {
+        const Type rotated = _mm256_permute_ps(a, _MM_SHUFFLE(2, 1, 0, 3));
+        return _mm256_blend_ps(rotated, _mm256_permute2f128_ps(rotated, first, 0x02), 0x11);
+    }
+};
+
+template <>
+struct Packet<double>
+{
+    typedef double Element;
+    typedef __m256d Type;
+    static const size_t Width = 4;
+    static Type Load(const double * p) { return _mm256_loadu_pd(p); }
+    static void Store(double * p, Type v) { _mm256_storeu_pd(p, v); }
+    static Type Set(double v) { return _mm256_set1_pd(v); }
+    static Type Add(Type a, Type b) { return _mm256_add_pd(a, b); }
+    static Type Subtract(Type a, Type b) { return _mm256_sub_pd(a, b); }
+    static Type Multiply(Type a, Type b) { return _mm256_mul_pd(a, b); }
+    static Type Divide(Type a, Type b) { return _mm256_div_pd(a, b); }
+    static Type Negate(Type a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    static Type Min(Type a, Type b) { return _mm256_min_pd(b, a); }
+    static Type Max(Type a, Type b) { return _mm256_max_pd(b, a); }
+    static Type Abs(Type a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+#ifdef __FMA__
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+    // Used by the functions in MatrixMath.hpp.
+    typedef __m256d Mask;
+    static Mask LessThan(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask Equal(Type a, Type b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static Type Select(Mask m, Type a, Type b) { return _mm256_blendv_pd(b, a, m); }
+    static Type Sqrt(Type a) { return _mm256_sqrt_pd(a); }
+    static Type Round(Type a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    static Type Pow2(Type n) {
+        const __m128i biased = _mm_add_epi32(_mm256_cvtpd_epi32(n), _mm_set1_epi32(1023));
+        const __m128i zero = _mm_setzero_si128();
+        return _mm256_castsi256_pd(CombineHalves(_mm_slli_epi64(_mm_unpacklo_epi32(biased, zero), 52),
+                                                 _mm_slli_epi64(_mm_unpackhi_epi32(biased, zero), 52)));
+    }
+    static Type Frexp(Type x, Type & exponent) {
+        const __m256i bits = _mm256_castpd_si256(x);
+        const __m128i mask = _mm_set1_epi64x(0x7ff);
+        const __m128i low = _mm_and_si128(_mm_srli_epi64(_mm256_castsi256_si128(bits), 52), mask);
+        const __m128i high = _mm_and_si128(_mm_srli_epi64(_mm256_extractf128_si256(bits, 1), 52), mask);
+        const __m128i biased = _mm_unpacklo_epi64(_mm_shuffle_epi32(low, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_epi32(high, _MM_SHUFFLE(2, 0, 2, 0)));
+        exponent = _mm256_sub_pd(_mm256_cvtepi32_pd(biased), _mm256_set1_pd(1022));
+        return _mm256_or_pd(_mm256_and_pd(x, _mm256_castsi256_pd(_mm256_set1_epi64x(0x800fffffffffffffLL))), _mm256_set1_pd(0.5));
+    }
+    // Used by the scans in MatrixScans.hpp.
+    static Type PrefixSum(Type a) {
+        a = _mm256_add_pd(a, _mm256_blend_pd(_mm256_permute_pd(a, 0x5), _mm256_setzero_pd(), 0x5));
+        const Type lowTotal = _mm256_permute_pd(a, 0xf);
+        return _mm256_add_pd(a, _mm256_permute2f128_pd(lowTotal, lowTotal, 0x08));
+    }
+    static Type BroadcastLast(Type a) {
+        const Type last = _mm256_permute_pd(a, 0xf);
+        return _mm256_permute2f128_pd(last, last, 0x11);
+    }
+    static Type ShiftUp(Type first, Type a) {
+        const Type swapped = _mm256_permute_pd(a, 0x5);
+        return _mm256_blend_pd(swapped, _mm256_permute2f128_pd(swapped, first, 0x02), 0x5);
+    }
+};
+
+#else
+
+template <>
+struct Packet<float>
+{
+    typedef float Element;
+    typedef __m128 Type;
+    static const size_t Width = 4;
+    static Type Load(const float * p) { return _mm_loadu_ps(p); }
+    static void Store(float * p, Type v) { _mm_storeu_ps(p, v); }
+    static Type Set(float v) { return _mm_set1_ps(v); }
+    static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+    static Type Subtract(Type a, Type b) { return _mm_sub_ps(a, b); }
+    static Type Multiply(Type a, Type b) { return _mm_mul_ps(a, b); }
+    static Type Divide(Type a, Type b) { return _mm_div_ps(a, b); }
+    static Type Negate(Type a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+    static Type Min(Type a, Type b) { return _mm_min_ps(b, a); }
+    static Type Max(Type a, Type b) { return _mm_max_ps(b, a); }
+    static Type Abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+#ifdef __FMA__
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm_fmadd_ps(a, b, c); }
+#else
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+#endif
+    // Used by the functions in MatrixMath.hpp.
+    typedef __m128 Mask;
+    static Mask LessThan(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+    static Mask Equal(Type a, Type b) { return _mm_cmpeq_ps(a, b); }
+    static Type Select(Mask m, Type a, Type b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+    static Type Sqrt(Type a) { return _mm_sqrt_ps(a); }
+    static Type Round(Type a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+    static Type Pow2(Type n) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23)); }
+    static Type Frexp(Type x, Type & exponent) {
+        const __m128i biased = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(x), 23), _mm_set1_epi32(0xff));
+        exponent = _mm_cvtepi32_ps(_mm_sub_epi32(biased, _mm_set1_epi32(126)));
+        return _mm_or_ps(_mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32(0x807fffff))), _mm_set1_ps(0.5f));
+    }
+    // Used by the scans in MatrixScans.hpp.
+    static Type PrefixSum(Type a) {
+        a = _mm_add_ps(a, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(a), 4)));
+        return _mm_add_ps(a, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(a), 8)));
+    }
+    static Type BroadcastLast(Type a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)); }
+    static Type ShiftUp(Type first, Type a) { return _mm_move_ss(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 1, 0, 3)), first); }
+};
+
+template <>
+struct Packet<double>
+{
+    typedef double Element;
+    typedef __m128d Type;
+    static const size_t Width = 2;
+    static Type Load(const double * p) { return _mm_loadu_pd(p); }
+    static void Store(double * p, Type v) { _mm_storeu_pd(p, v); }
+    static Type Set(double v) { return _mm_set1_pd(v); }
+    static Type Add(Type a, Type b) { return _mm_add_pd(a, b); }
+    static Type Subtract(Type a, Type b) { return _mm_sub_pd(a, b); }
+    static Type Multiply(Type a, Type b) { return _mm_mul_pd(a, b); }
+    static Type Divide(Type a, Type b) { return _mm_div_pd(a, b); }
+    static Type Negate(Type a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    static Type Min(Type a, Type b) { return _mm_min_pd(b, a); }
+    static Type Max(Type a, Type b) { return _mm_max_pd(b, a); }
+    static Type Abs(Type a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+#ifdef __FMA__
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm_fmadd_pd(a, b, c); }
+#else
+    static Type MultiplyAdd(Type a, Type b, Type c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+#endif
+    // Used by the functions in MatrixMath.hpp.
+    typedef __m128d Mask;
+    static Mask LessThan(Type a, Type b) { return _mm_cmplt_pd(a, b); }
+    static Mask Equal(Type a, Type b) { return _mm_cmpeq_pd(a, b); }
+    static Type Select(Mask m, Type a, Type b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+    static Type Sqrt(Type a) { return _mm_sqrt_pd(a); }
+    static Type Round(Type a) { return _mm_cvtepi32_pd(_mm_cvtpd_epi32(a)); }
+    static Type Pow2(Type n) {
+        const __m128i biased = _mm_add_epi32(_mm_cvtpd_epi32(n), _mm_set1_epi32(1023));
+        return _mm_castsi128_pd(_mm_slli_epi64(_mm_unpacklo_epi32(biased, _mm_setzero_si128()), 52));
+    }
+    static Type Frexp(Type x, Type & exponent) {
+        const __m128i biased = _mm_and_si128(_mm_srli_epi64(_mm_castpd_si128(x), 52), _mm_set1_epi64x(0x7ff));
+        exponent = _mm_sub_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(biased, _MM_SHUFFLE(2, 0, 2, 0))), _mm_set1_pd(1022));
+        return _mm_or_pd(_mm_and_pd(x, _mm_castsi128_pd(_mm_set1_epi64x(0x800fffffffffffffLL))), _mm_set1_pd(0.5));
+    }
+    // Used by the scans in MatrixScans.hpp.
+    static Type PrefixSum(Type a) { return _mm_add_pd(a, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(a), 8))); }
+    static Type BroadcastLast(Type a) { return _mm_unpackhi_pd(a, a); }
+    static Type ShiftUp(Type first, Type a) { return _mm_shuffle_pd(first, a, 0); }
+};
+
+#endif // __AVX__
+#endif // USE_INTRINSICS
+
+struct AddOp {
+    template <class P> static typename P::Type Apply(typename P::Type a, typename P::Type b) { return P::Add(a, b); }
+};
+struct SubtractOp {
+    template <class P> static typename P::Type Apply(typename P::Type a, typename P::Type b) { return P::Subtract(a, b); }
+};
+struct MultiplyOp {
+    template <class P> static typename P::Type Apply(typename P::Type a, typename P::Type b) { return P::Multiply(a, b); }
+};
+struct DivideOp {
+    template <class P> static typename P::Type Apply(typename P::Type a, typename P::Type b) { return P::Divide(a, b); }
+};
+struct MinOp {
+    template <class P> static typename P::Type Apply(typename P::Type a, typename P::Type b) { return P::Min(a, b); }
+};
+struct MaxOp {
+    template <class P> static typename P::Type Apply(typename P::Type a, typename P::Type b) { return P::Max(a, b); }
+};
+struct NegateOp {
+    template <class P> static typename P::Type Apply(typename P::Type a) { return P::Negate(a); }
+};
+struct AbsOp {
+    template <class P> static typename P::Type Apply(typename P::Type a) { return P::Abs(a); }
+};
+
+} // namespace MatrixKernels
+
+/**
+ * Base of every expression node. Each node provides Rows(), Columns(), Evaluate<P>(i, j),
+ * which returns the P::Width elements starting at (i, j) down a column, Transposed(),
+ * UnitRowStride(), which says whether the wide Evaluate may be used, and the aliasing
+ * queries Reads() and Aliases().
+ */
+template <class Derived>
+class MatrixExpression
+{
+public:
+    const Derived & Self() const { return static_cast<const Derived &>(*this); }
+    size_t Rows() const { return Self().Rows(); }
+    size_t Columns() const { return Self().Columns(); }
+};
+
+/// A matrix or view as an expression operand.
+template <class T>
+class ViewExpression : public MatrixExpression<ViewExpression<T>>
+{
+public:
+    typedef T ValueType;
+
+    explicit ViewExpression(const MatrixView<const T> & view) : m_view(view) {}
+
+    size_t Rows() const { return m_view.Rows(); }
+    size_t Columns() const { return m_view.Columns(); }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const {
+        return P::Load(m_view.Data() + i * m_view.RowStride() + j * m_view.ColumnStride());
+    }
+    ViewExpression Transposed() const { return ViewExpression(m_view.Transpose()); }
+    bool UnitRowStride() const { return m_view.RowStride() == 1; }
+    /// True if any element of dst is read.
+    bool Reads(const MatrixView<const T> & dst) const { return MatrixKernels::Overlaps(m_view, dst); }
+    /// True if writing dst element by element could change elements still to be read. Reading
+    /// exactly the element being written, as in D = D + A, is safe.
+    bool Aliases(const MatrixView<const T> & dst) const {
+        const bool sameElements = m_view.Data() == dst.Data() && m_view.RowStride() == dst.RowStride()
+                                  && m_view.ColumnStride() == dst.ColumnStride();
+        return !sameElements && Reads(dst);
+    }
+
+private:
+    MatrixView<const T> m_view;
+};
+
+/// A scalar broadcast to every element.
+template <class T>
+class ScalarExpression : public MatrixExpression<ScalarExpression<T>>
+{
+public:
+    typedef T ValueType;
+
+    ScalarExpression(T value, size_t numRows, size_t numCols) : m_value(value), m_rows(numRows), m_columns(numCols) {}
+
+    size_t Rows() const { return m_rows; }
+    size_t Columns() const { return m_columns; }
+    template <class P>
+    typename P::Type Evaluate(size_t, size_t) const { return P::Set(m_value); }
+    ScalarExpression Transposed() const { return ScalarExpression(m_value, m_columns, m_rows); }
+    bool UnitRowStride() const { return true; }
+    bool Reads(const MatrixView<const T> &) const { return false; }
+    bool Aliases(const MatrixView<const T> &) const { return false; }
+
+private:
+    T m_value;
+    size_t m_rows;
+    size_t m_columns;
+};
+
+/// A row vector repeated down every row, or a column vector repeated across every column.
+template <class T>
+class BroadcastExpression : public MatrixExpression<BroadcastExpression<T>>
+{
+public:
+    typedef T ValueType;
+
+    /// vector is 1 x numCols when isRow, numRows x 1 otherwise.
+    BroadcastExpression(const MatrixView<const T> & vector, size_t numRows, size_t numCols, bool isRow)
+    : m_vector(vector), m_rows(numRows), m_columns(numCols), m_isRow(isRow) {}
+
+    size_t Rows() const { return m_rows; }
+    size_t Columns() const { return m_columns; }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const {
+        if(m_isRow)
+            return P::Set(m_vector.Data()[j * m_vector.ColumnStride()]);
+        return P::Load(m_vector.Data() + i * m_vector.RowStride());
+    }
+    BroadcastExpression Transposed() const { return BroadcastExpression(m_vector.Transpose(), m_columns, m_rows, !m_isRow); }
+    bool UnitRowStride() const { return m_isRow || m_vector.RowStride() == 1; }
+    bool Reads(const MatrixView<const T> & dst) const { return MatrixKernels::Overlaps(m_vector, dst); }
+    //Each vector element is read for a whole row or column of dst, so any overlap aliases.
+    bool Aliases(const MatrixView<const T> & dst) const { return Reads(dst); }
+
+private:
+    MatrixView<const T> m_vector;
+    size_t m_rows;
+    size_t m_columns;
+    bool m_isRow;
+};
+
+template <class Op, class E>
+class UnaryExpression : public MatrixExpression<UnaryExpression<Op, E>>
+{
+public:
+    typedef typename E::ValueType ValueType;
+
+    explicit UnaryExpression(const E & operand) : m_operand(operand) {}
+
+    size_t Rows() const { return m_operand.Rows(); }
+    size_t Columns() const { return m_operand.Columns(); }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const { return Op::template Apply<P>(m_operand.template Evaluate<P>(i, j)); }
+    UnaryExpression Transposed() const { return UnaryExpression(m_operand.Transposed()); }
+    bool UnitRowStride() const { return m_operand.UnitRowStride(); }
+    bool Reads(const MatrixView<const ValueType> & dst) const { return m_operand.Reads(dst); }
+    bool Aliases(const MatrixView<const ValueType> & dst) const { return m_operand.Aliases(dst); }
+
+private:
+    E m_operand;
+};
+
+template <class Op, class L, class R>
+class BinaryExpression : public MatrixExpression<BinaryExpression<Op, L, R>>
+{
+public:
+    typedef typename L::ValueType ValueType;
+    static_assert(std::is_same<ValueType, typename R::ValueType>::value, "Both operands must have the same element type");
+
+    BinaryExpression(const L & lhs, const R & rhs) : m_lhs(lhs), m_rhs(rhs) {
+        if(lhs.Rows() != rhs.Rows() || lhs.Columns() != rhs.Columns())
+            throw std::invalid_argument("Invalid argument. Elementwise operands must have the same dimensions");
+    }
+
+    size_t Rows() const { return m_lhs.Rows(); }
+    size_t Columns() const { return m_lhs.Columns(); }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const {
+        return Op::template Apply<P>(m_lhs.template Evaluate<P>(i, j), m_rhs.template Evaluate<P>(i, j));
+    }
+    BinaryExpression Transposed() const { return BinaryExpression(m_lhs.Transposed(), m_rhs.Transposed()); }
+    bool UnitRowStride() const { return m_lhs.UnitRowStride() && m_rhs.UnitRowStride(); }
+    bool Reads(const MatrixView<const ValueType> & dst) const { return m_lhs.Reads(dst) || m_rhs.Reads(dst); }
+    bool Aliases(const MatrixView<const ValueType> & dst) const { return m_lhs.Aliases(dst) || m_rhs.Aliases(dst); }
+
+private:
+    L m_lhs;
+    R m_rhs;
+};
+
+/// a * b + c, with a single rounding where the build has FMA instructions.
+template <class A, class B, class C>
+class MultiplyAddExpression : public MatrixExpression<MultiplyAddExpression<A, B, C>>
+{
+public:
+    typedef typename A::ValueType ValueType;
+    static_assert(std::is_same<ValueType, typename B::ValueType>::value && std::is_same<ValueType, typename C::ValueType>::value,
+                  "All operands must have the same element type");
+
+    MultiplyAddExpression(const A & a, const B & b, const C & c) : m_a(a), m_b(b), m_c(c) {
+        if(a.Rows() != b.Rows() || a.Columns() != b.Columns() || a.Rows() != c.Rows() || a.Columns() != c.Columns())
+            throw std::invalid_argument("Invalid argument. Elementwise operands must have the same dimensions");
+    }
+
+    size_t Rows() const { return m_a.Rows(); }
+    size_t Columns() const { return m_a.Columns(); }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const {
+        return P::MultiplyAdd(m_a.template Evaluate<P>(i, j), m_b.template Evaluate<P>(i, j), m_c.template Evaluate<P>(i, j));
+    }
+    MultiplyAddExpression Transposed() const { return MultiplyAddExpression(m_a.Transposed(), m_b.Transposed(), m_c.Transposed()); }
+    bool UnitRowStride() const { return m_a.UnitRowStride() && m_b.UnitRowStride() && m_c.UnitRowStride(); }
+    bool Reads(const MatrixView<const ValueType> & dst) const { return m_a.Reads(dst) || m_b.Reads(dst) || m_c.Reads(dst); }
+    bool Aliases(const MatrixView<const ValueType> & dst) const { return m_a.Aliases(dst) || m_b.Aliases(dst) || m_c.Aliases(dst); }
+
+private:
+    A m_a;
+    B m_b;
+    C m_c;
+};
+
+/// A user function applied to every element. The operand is still evaluated a register at
+/// a time, and the function is called on each lane, which lets simple functions vectorize.
+template <class F, class E>
+class MapExpression : public MatrixExpression<MapExpression<F, E>>
+{
+public:
+    typedef typename E::ValueType ValueType;
+
+    MapExpression(const E & operand, const F & function) : m_operand(operand), m_function(function) {}
+
+    size_t Rows() const { return m_operand.Rows(); }
+    size_t Columns() const { return m_operand.Columns(); }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const {
+        ValueType lanes[P::Width];
+        P::Store(lanes, m_operand.template Evaluate<P>(i, j));
+        for(size_t k = 0; k < P::Width; k++)
+            lanes[k] = ValueType(m_function(lanes[k]));
+        return P::Load(lanes);
+    }
+    MapExpression Transposed() const { return MapExpression(m_operand.Transposed(), m_function); }
+    bool UnitRowStride() const { return m_operand.UnitRowStride(); }
+    bool Reads(const MatrixView<const ValueType> & dst) const { return m_operand.Reads(dst); }
+    bool Aliases(const MatrixView<const ValueType> & dst) const { return m_operand.Aliases(dst); }
+
+private:
+    E m_operand;
+    F m_function;
+};
+
+/// Elements converted to another type, e.g. to average integer matrices in double.
+template <class U, class E>
+class CastExpression : public MatrixExpression<CastExpression<U, E>>
+{
+public:
+    typedef U ValueType;
+    typedef typename E::ValueType SourceType;
+
+    explicit CastExpression(const E & operand) : m_operand(operand) {}
+
+    size_t Rows() const { return m_operand.Rows(); }
+    size_t Columns() const { return m_operand.Columns(); }
+    template <class P>
+    typename P::Type Evaluate(size_t i, size_t j) const { return EvaluateAs<P>(i, j, std::is_same<U, SourceType>()); }
+    CastExpression Transposed() const { return CastExpression(m_operand.Transposed()); }
+    bool UnitRowStride() const { return m_operand.UnitRowStride(); }
+    bool Reads(const MatrixView<const U> & dst) const { return ReadsSame(dst, std::is_same<U, SourceType>()); }
+    bool Aliases(const MatrixView<const U> & dst) const { return AliasesSame(dst, std::is_same<U, SourceType>()); }
+
+private:
+    template <class P>
+    typename P::Type EvaluateAs(size_t i, size_t j, std::true_type) const { return m_operand.template Evaluate<P>(i, j); }
+    template <class P>
+    typename P::Type EvaluateAs(size_t i, size_t j, std::false_type) const {
+        U lanes[P::Width];
+        for(size_t k = 0; k < P::Width; k++)
+            lanes[k] = U(m_operand.template Evaluate<MatrixKernels::ScalarPacket<SourceType>>(i + k, j));
+        return P::Load(lanes);
+    }
+    //A destination of another element type can't be the operand's storage.
+    bool ReadsSame(const MatrixView<const U> & dst, std::true_type) const { return m_operand.Reads(dst); }
+    bool ReadsSame(const MatrixView<const U> &, std::false_type) const { return false; }
+    bool AliasesSame(const MatrixView<const U> & dst, std::true_type) const { return m_operand.Aliases(dst); }
+    bool AliasesSame(const MatrixView<const U> &, std::false_type) const { return false; }
+
+    E m_operand;
+};
+
+/// How each kind of operand enters an expression. Matrices and views become ViewExpression leaves.
+template <class X, class = void>
+struct ExpressionOperand
+{
+    static const bool value = false;
+};
+
+template <class T, class Order>
+struct ExpressionOperand<Matrix<T, Order>>
+{
+    static const bool value = true;
+    typedef ViewExpression<T> Type;
+    static Type Make(const Matrix<T, Order> & m) { return Type(m.View()); }
+};
+
+template <class U>
+struct ExpressionOperand<MatrixView<U>>
+{
+    static const bool value = true;
+    typedef ViewExpression<typename std::remove_const<U>::type> Type;
+    static Type Make(const MatrixView<U> & v) { return Type(v); }
+};
+
+template <class E>
+struct ExpressionOperand<E, typename std::enable_if<std::is_base_of<MatrixExpression<E>, E>::value>::type>
+{
+    static const bool value = true;
+    typedef E Type;
+    static const E & Make(const E & e) { return e; }
+};
+
+/// True for types that are expression nodes rather than matrices or views.
+template <class X>
+struct IsMatrixExpression : std::is_base_of<MatrixExpression<X>, X> {};
+
+/// Enables an overload for two matrix, view or expression operands.
+template <class L, class R>
+using EnableIfOperands = typename std::enable_if<ExpressionOperand<L>::value && ExpressionOperand<R>::value>::type;
+/// Enables an overload for one such operand and an arithmetic scalar.
+template <class X, class S>
+using EnableIfOperandAndScalar = typename std::enable_if<ExpressionOperand<X>::value && std::is_arithmetic<S>::value>::type;
+
+/// Builds Op(lhs, rhs).
+template <class Op, class L, class R>
+BinaryExpression<Op, typename ExpressionOperand<L>::Type, typename ExpressionOperand<R>::Type> MakeBinary(const L & lhs, const R & rhs) {
+    return BinaryExpression<Op, typename ExpressionOperand<L>::Type, typename ExpressionOperand<R>::Type>(
+        ExpressionOperand<L>::Make(lhs), ExpressionOperand<R>::Make(rhs));
+}
+
+template <class Op, class E, class S>
+BinaryExpression<Op, E, S> MakeOrdered(const E & expr, const S & scalar, std::false_type) { return BinaryExpression<Op, E, S>(expr, scalar); }
+template <class Op, class E, class S>
+BinaryExpression<Op, S, E> MakeOrdered(const E & expr, const S & scalar, std::true_type) { return BinaryExpression<Op, S, E>(scalar, expr); }
+
+/// Builds Op(operand, scalar), or Op(scalar, operand) when scalarFirst, with the scalar
+/// broadcast to the shape of the operand.
+template <class Op, bool scalarFirst, class X, class S,
+          class E = typename ExpressionOperand<X>::Type, class V = ScalarExpression<typename E::ValueType>>
+typename std::conditional<scalarFirst, BinaryExpression<Op, V, E>, BinaryExpression<Op, E, V>>::type
+MakeBinaryScalar(const X & operand, S scalar) {
+    const E expr = ExpressionOperand<X>::Make(operand);
+    const V value(typename E::ValueType(scalar), expr.Rows(), expr.Columns());
+    return MakeOrdered<Op>(expr, value, std::integral_constant<bool, scalarFirst>());
+}
+
+namespace MatrixKernels {
+
+/**
+ * Computes expr into dst in one pass, walking dst along its contiguous direction. Columns
+ * run a register at a time when every operand is contiguous along them too, and in
+ * parallel once the destination is big enough that the pass is bound by memory bandwidth.
+ * dst must not alias the operands; see ViewExpression::Aliases.
+ */
+template <class E, class T>
+void Evaluate(const E & expr, const MatrixView<T> & dst) {
+    if(dst.RowStride() != 1 && dst.ColumnStride() == 1) {
+        //Row-major destination: evaluate the transposed expression into its transpose.
+        Evaluate(expr.Transposed(), dst.Transpose());
+        return;
+    }
+
+    typedef Packet<T> P;
+    typedef ScalarPacket<T> S;
+    const size_t m = dst.Rows();
+    const size_t n = dst.Columns();
+    const bool wide = P::Width > 1 && dst.RowStride() == 1 && expr.UnitRowStride();
+    auto evaluateColumn = [&](size_t j) {
+        T * out = dst.Data() + j * dst.ColumnStride();
+        size_t i = 0;
+        if(wide) {
+            for(; i + P::Width <= m; i += P::Width)
+                P::Store(out + i, expr.template Evaluate<P>(i, j));
+        }
+        for(; i < m; i++)
+            out[i * dst.RowStride()] = expr.template Evaluate<S>(i, j);
+    };
+
+    if(m * n * sizeof(T) < kParallelMemoryThreshold) {
+        for(size_t j = 0; j < n; j++)
+            evaluateColumn(j);
+        return;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(size_t j = 0; j < n; j++)
+        evaluateColumn(j);
+}
+
+} // namespace MatrixKernels
+
+template <class T>
+template <class E>
+void MatrixView<T>::Assign(const MatrixExpression<E> & expression) const {
+    static_assert(!std::is_const<T>::value, "Cannot assign through a read-only view");
+    static_assert(std::is_same<typename E::ValueType, T>::value, "The expression must have the element type of the view");
+    const E & expr = expression.Self();
+    if(expr.Rows() != m_rows || expr.Columns() != m_columns)
+        throw std::invalid_argument("Invalid argument. Source and destination views must have the same dimensions");
+
+    if(expr.Aliases(MatrixView<const T>(*this))) {
+        const Matrix<T> result(expr);
+        MatrixKernels::Copy(result.View(), *this);
+        return;
+    }
+    MatrixKernels::Evaluate(expr, *this);
+}
+
+// Elementwise operators. Each takes any mix of matrices, views and expressions, and most
+// take a scalar on either side as well.
+
+template <class L, class R, class = EnableIfOperands<L, R>>
+auto operator+(const L & lhs, const R & rhs) -> decltype(MakeBinary<MatrixKernels::AddOp>(lhs, rhs)) {
+    return MakeBinary<MatrixKernels::AddOp>(lhs, rhs);
+}
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto operator+(const X & operand, S scalar) -> decltype(MakeBinaryScalar<MatrixKernels::AddOp, false>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::AddOp, false>(operand, scalar);
+}
+template <class S, class X, class = EnableIfOperandAndScalar<X, S>>
+auto operator+(S scalar, const X & operand) -> decltype(MakeBinaryScalar<MatrixKernels::AddOp, true>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::AddOp, true>(operand, scalar);
+}
+
+template <class L, class R, class = EnableIfOperands<L, R>>
+auto operator-(const L & lhs, const R & rhs) -> decltype(MakeBinary<MatrixKernels::SubtractOp>(lhs, rhs)) {
+    return MakeBinary<MatrixKernels::SubtractOp>(lhs, rhs);
+}
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto operator-(const X & operand, S scalar) -> decltype(MakeBinaryScalar<MatrixKernels::SubtractOp, false>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::SubtractOp, false>(operand, scalar);
+}
+template <class S, class X, class = EnableIfOperandAndScalar<X, S>>
+auto operator-(S scalar, const X & operand) -> decltype(MakeBinaryScalar<MatrixKernels::SubtractOp, true>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::SubtractOp, true>(operand, scalar);
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+UnaryExpression<MatrixKernels::NegateOp, typename ExpressionOperand<X>::Type> operator-(const X & operand) {
+    return UnaryExpression<MatrixKernels::NegateOp, typename ExpressionOperand<X>::Type>(ExpressionOperand<X>::Make(operand));
+}
+
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto operator*(const X & operand, S scalar) -> decltype(MakeBinaryScalar<MatrixKernels::MultiplyOp, false>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::MultiplyOp, false>(operand, scalar);
+}
+template <class S, class X, class = EnableIfOperandAndScalar<X, S>>
+auto operator*(S scalar, const X & operand) -> decltype(MakeBinaryScalar<MatrixKernels::MultiplyOp, true>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::MultiplyOp, true>(operand, scalar);
+}
+
+/// The elementwise (Hadamard) product. Use operator* for the matrix product.
+template <class L, class R, class = EnableIfOperands<L, R>>
+auto Hadamard(const L & lhs, const R & rhs) -> decltype(MakeBinary<MatrixKernels::MultiplyOp>(lhs, rhs)) {
+    return MakeBinary<MatrixKernels::MultiplyOp>(lhs, rhs);
+}
+
+/// Elementwise division; there is no matrix division to confuse it with.
+template <class L, class R, class = EnableIfOperands<L, R>>
+auto operator/(const L & lhs, const R & rhs) -> decltype(MakeBinary<MatrixKernels::DivideOp>(lhs, rhs)) {
+    return MakeBinary<MatrixKernels::DivideOp>(lhs, rhs);
+}
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto operator/(const X & operand, S scalar) -> decltype(MakeBinaryScalar<MatrixKernels::DivideOp, false>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::DivideOp, false>(operand, scalar);
+}
+template <class S, class X, class = EnableIfOperandAndScalar<X, S>>
+auto operator/(S scalar, const X & operand) -> decltype(MakeBinaryScalar<MatrixKernels::DivideOp, true>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::DivideOp, true>(operand, scalar);
+}
+
+/// The elementwise minimum of two operands, or of an operand and a scalar.
+template <class L, class R, class = EnableIfOperands<L, R>>
+auto Min(const L & lhs, const R & rhs) -> decltype(MakeBinary<MatrixKernels::MinOp>(lhs, rhs)) {
+    return MakeBinary<MatrixKernels::MinOp>(lhs, rhs);
+}
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto Min(const X & operand, S scalar) -> decltype(MakeBinaryScalar<MatrixKernels::MinOp, false>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::MinOp, false>(operand, scalar);
+}
+
+/// The elementwise maximum of two operands, or of an operand and a scalar.
+template <class L, class R, class = EnableIfOperands<L, R>>
+auto Max(const L & lhs, const R & rhs) -> decltype(MakeBinary<MatrixKernels::MaxOp>(lhs, rhs)) {
+    return MakeBinary<MatrixKernels::MaxOp>(lhs, rhs);
+}
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto Max(const X & operand, S scalar) -> decltype(MakeBinaryScalar<MatrixKernels::MaxOp, false>(operand, scalar)) {
+    return MakeBinaryScalar<MatrixKernels::MaxOp, false>(operand, scalar);
+}
+
+/// Limits every element to [low, high].
+template <class X, class S, class = EnableIfOperandAndScalar<X, S>>
+auto Clamp(const X & operand, S low, S high) -> decltype(Min(Max(operand, low), high)) {
+    return Min(Max(operand, low), high);
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+UnaryExpression<MatrixKernels::AbsOp, typename ExpressionOperand<X>::Type> Abs(const X & operand) {
+    return UnaryExpression<MatrixKernels::AbsOp, typename ExpressionOperand<X>::Type>(ExpressionOperand<X>::Make(operand));
+}
+
+/// The elementwise a * b + c.
+template <class A, class B, class C,
+          class = typename std::enable_if<ExpressionOperand<A>::value && ExpressionOperand<B>::value && ExpressionOperand<C>::value>::type>
+MultiplyAddExpression<typename ExpressionOperand<A>::Type, typename ExpressionOperand<B>::Type, typename ExpressionOperand<C>::Type>
+MultiplyAdd(const A & a, const B & b, const C & c) {
+    return MultiplyAddExpression<typename ExpressionOperand<A>::Type, typename ExpressionOperand<B>::Type, typename ExpressionOperand<C>::Type>(
+        ExpressionOperand<A>::Make(a), ExpressionOperand<B>::Make(b), ExpressionOperand<C>::Make(c));
+}
+
+/// Converts every element to U.
+template <class U, class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+CastExpression<U, typename ExpressionOperand<X>::Type> Cast(const X & operand) {
+    return CastExpression<U, typename ExpressionOperand<X>::Type>(ExpressionOperand<X>::Make(operand));
+}
+
+/// Applies function, which takes and returns an element, to every element. Large
+/// destinations are filled by several threads, so the function must be safe to call concurrently.
+template <class X, class F, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+MapExpression<F, typename ExpressionOperand<X>::Type> Map(const X & operand, F function) {
+    return MapExpression<F, typename ExpressionOperand<X>::Type>(ExpressionOperand<X>::Make(operand), function);
+}
+
+/// Read-only views of matrices and views alike.
+template <class T, class Order>
+MatrixView<const T> ConstView(const Matrix<T, Order> & m) { return m.View(); }
+template <class U>
+MatrixView<const typename std::remove_const<U>::type> ConstView(const MatrixView<U> & v) { return v; }
+
+/// Repeats a 1 x n row vector, a matrix or view, down numRows rows.
+template <class X, class T = typename decltype(ConstView(std::declval<X>()))::ValueType>
+BroadcastExpression<T> BroadcastRow(const X & row, size_t numRows) {
+    const MatrixView<const T> vector = ConstView(row);
+    if(vector.Rows() != 1)
+        throw std::invalid_argument("Invalid argument. A broadcast row must have exactly one row");
+    return BroadcastExpression<T>(vector, numRows, vector.Columns(), true);
+}
+
+/// Repeats an m x 1 column vector, a matrix or view, across numCols columns.
+template <class X, class T = typename decltype(ConstView(std::declval<X>()))::ValueType>
+BroadcastExpression<T> BroadcastColumn(const X & column, size_t numCols) {
+    const MatrixView<const T> vector = ConstView(column);
+    if(vector.Columns() != 1)
+        throw std::invalid_argument("Invalid argument. A broadcast column must have exactly one column");
+    return BroadcastExpression<T>(vector, vector.Rows(), numCols, false);
+}
+
+// Matrix products with an expression on either side. The GEMM kernels need their operands
+// in memory, so only the expression sides are materialized; matrices and views go in as they are.
+
+template <class E>
+Matrix<typename E::ValueType> ProductOperand(const MatrixExpression<E> & expr) { return Matrix<typename E::ValueType>(expr.Self()); }
+template <class T, class Order>
+MatrixView<const T> ProductOperand(const Matrix<T, Order> & m) { return m.View(); }
+template <class U>
+MatrixView<const typename std::remove_const<U>::type> ProductOperand(const MatrixView<U> & v) { return v; }
+
+template <class L, class R, class = typename std::enable_if<ExpressionOperand<L>::value && ExpressionOperand<R>::value
+                                                            && (IsMatrixExpression<L>::value || IsMatrixExpression<R>::value)>::type>
+Matrix<typename ExpressionOperand<L>::Type::ValueType> operator*(const L & lhs, const R & rhs) {
+    const auto & left = ProductOperand(lhs);
+    const auto & right = ProductOperand(rhs);
+    return Multiply(ConstView(left), ConstView(right));
+}
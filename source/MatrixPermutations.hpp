@@ -0,0 +1,303 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "Matrix.hpp"
+
+/**
+ * Reordering rows and columns by index lists: gathers (a new matrix made of the listed rows
+ * or columns of a matrix, in list order, repeats allowed), scatters (writing the rows or
+ * columns of a matrix to the listed positions of another) and in-place permutations.
+ *
+ * Everything is done in terms of whole lines. A column of a column-major matrix is a
+ * contiguous run, so gathering, scattering and permuting columns are one memcpy per
+ * column. Gathering rows of a column-major matrix gathers down one column at a time, so the
+ * random reads stay within a column that fits in cache and the writes are contiguous.
+ * Gathering rows of a row-major matrix into a column-major one copies whole rows into a
+ * small tile that the SIMD transpose kernel then writes out. Row-major matrices take the
+ * transposed route of each of these. Large jobs are split between the threads.
+ *
+ * Permutations follow the gather convention: PermuteColumns(A, p) leaves column k of A
+ * holding what was column p[k], as A = GatherColumns(A, p) would. Whole lines are moved
+ * around the cycles of the permutation through a single line of scratch space; permuting
+ * the elements within each line goes through a copy of the line, one line at a time.
+ * Empty gather lists, indices out of range, repeated scatter indices and lists that are
+ * not permutations throw std::invalid_argument.
+ */
+
+namespace MatrixKernels {
+
+/// Side of the tiles of the strided gather and scatter kernels, in lines and in elements along them.
+const size_t kGatherTile = 64;
+
+/// Throws unless every index is below limit and, if distinct is set, no index repeats.
+inline void CheckIndices(const std::vector<size_t> & indices, size_t limit, bool distinct) {
+    std::vector<bool> seen(distinct ? limit : 0, false);
+    for(size_t index : indices) {
+        if(index >= limit)
+            throw std::invalid_argument("Invalid argument. Index out of range");
+        if(distinct) {
+            if(seen[index])
+                throw std::invalid_argument("Invalid argument. Indices must be distinct");
+            seen[index] = true;
+        }
+    }
+}
+
+/// Throws unless permutation holds each of 0 to count - 1 exactly once.
+inline void CheckPermutation(const std::vector<size_t> & permutation, size_t count) {
+    if(permutation.size() != count)
+        throw std::invalid_argument("Invalid argument. A permutation must list every row (column) once");
+    CheckIndices(permutation, count, true);
+}
+
+/**
+ * Copies line srcLines[k] of src to line dstLines[k] of dst for k < count, where the lines
+ * are the columns and a null list means 0, 1, 2, ...
+ */
+template <class T>
+void CopyLines(const MatrixView<const T> & src, const size_t * srcLines, const MatrixView<T> & dst, const size_t * dstLines, size_t count) {
+    const size_t m = dst.Rows();
+    const size_t srcRow = src.RowStride(), dstRow = dst.RowStride();
+    auto sourceLine = [&](size_t k) { return src.Data() + (srcLines ? srcLines[k] : k) * src.ColumnStride(); };
+    auto destinationLine = [&](size_t k) { return dst.Data() + (dstLines ? dstLines[k] : k) * dst.ColumnStride(); };
+    const bool parallel = m * count * sizeof(T) >= kParallelMemoryThreshold;
+    (void)parallel; // Only read by the OpenMP clauses.
+
+    //Contiguous lines: one copy each.
+    if(srcRow == 1 && dstRow == 1) {
+        #pragma omp parallel for schedule(static) if(parallel)
+        for(size_t k = 0; k < count; k++)
+            std::copy(sourceLine(k), sourceLine(k) + m, destinationLine(k));
+        return;
+    }
+
+    const size_t rowTiles = (m + kGatherTile - 1) / kGatherTile;
+    const size_t tiles = (count + kGatherTile - 1) / kGatherTile * rowTiles;
+
+    //Contiguous source lines into consecutive destination lines whose rows are contiguous: copy
+    //a tile of lines into scratch, then transpose the tile into place.
+    if(srcRow == 1 && dst.ColumnStride() == 1 && !dstLines) {
+        #pragma omp parallel if(parallel)
+        {
+            AlignedBuffer<T> scratch(kGatherTile * kGatherTile);
+            #pragma omp for schedule(static)
+            for(size_t t = 0; t < tiles; t++) {
+                const size_t k = t / rowTiles * kGatherTile, i = t % rowTiles * kGatherTile;
+                const size_t lines = std::min(kGatherTile, count - k), rows = std::min(kGatherTile, m - i);
+                for(size_t l = 0; l < lines; l++)
+                    std::copy(sourceLine(k + l) + i, sourceLine(k + l) + i + rows, scratch.data() + l * rows);
+                TransposeTile(scratch.data(), rows, dst.Data() + k + i * dstRow, dstRow, rows, lines);
+            }
+        }
+        return;
+    }
+
+    //Lines across contiguous runs, such as the rows of a column-major matrix: gather along each
+    //run in turn, so that the reads stay within one run and the writes are contiguous.
+    if(dst.ColumnStride() == 1) {
+        #pragma omp parallel for schedule(static) if(parallel)
+        for(size_t r = 0; r < m; r++) {
+            const T * in = src.Data() + r * srcRow;
+            T * out = dst.Data() + r * dstRow;
+            for(size_t l = 0; l < count; l++)
+                out[dstLines ? dstLines[l] : l] = in[(srcLines ? srcLines[l] : l) * src.ColumnStride()];
+        }
+        return;
+    }
+
+    //Any other strides: element by element, a tile at a time.
+    #pragma omp parallel for schedule(static) if(parallel)
+    for(size_t t = 0; t < tiles; t++) {
+        const size_t k = t / rowTiles * kGatherTile, i = t % rowTiles * kGatherTile;
+        const size_t kEnd = std::min(count, k + kGatherTile), iEnd = std::min(m, i + kGatherTile);
+        for(size_t l = k; l < kEnd; l++) {
+            const T * in = sourceLine(l);
+            T * out = destinationLine(l);
+            for(size_t r = i; r < iEnd; r++)
+                out[r * dstRow] = in[r * srcRow];
+        }
+    }
+}
+
+/// The cycles of permutation longer than one, one after another, each closed by a repeat of its first entry.
+inline std::vector<size_t> PermutationCycles(const std::vector<size_t> & permutation) {
+    std::vector<size_t> cycles;
+    std::vector<bool> visited(permutation.size(), false);
+    for(size_t start = 0; start < permutation.size(); start++) {
+        if(visited[start] || permutation[start] == start)
+            continue;
+        size_t k = start;
+        do {
+            visited[k] = true;
+            cycles.push_back(k);
+            k = permutation[k];
+        } while(k != start);
+        cycles.push_back(start);
+    }
+    return cycles;
+}
+
+/**
+ * Permutes the columns of view, column k becoming what was column permutation[k]. Each cycle
+ * parks its first column in scratch, pulls every other column one step along and finishes
+ * with the parked one.
+ */
+template <class T>
+void PermuteLines(const MatrixView<T> & view, const std::vector<size_t> & permutation) {
+    const std::vector<size_t> cycles = PermutationCycles(permutation);
+    const size_t m = view.Rows(), stride = view.RowStride();
+    auto line = [&](size_t j) { return view.Data() + j * view.ColumnStride(); };
+    auto copy = [&](const T * from, size_t fromStride, T * to, size_t toStride) {
+        if(fromStride == 1 && toStride == 1)
+            std::copy(from, from + m, to);
+        else
+            for(size_t i = 0; i < m; i++)
+                to[i * toStride] = from[i * fromStride];
+    };
+    AlignedBuffer<T> scratch(m);
+    for(size_t c = 0; c < cycles.size(); c++) {
+        const size_t start = cycles[c];
+        copy(line(start), stride, scratch.data(), 1);
+        for(c++; cycles[c] != start; c++)
+            copy(line(permutation[cycles[c - 1]]), stride, line(cycles[c - 1]), stride);
+        copy(scratch.data(), 1, line(cycles[c - 1]), stride);
+    }
+}
+
+/// Permutes the rows of view, row i becoming what was row permutation[i], through a copy of each column.
+template <class T>
+void PermuteWithinLines(const MatrixView<T> & view, const std::vector<size_t> & permutation) {
+    const size_t m = view.Rows(), n = view.Columns(), stride = view.RowStride();
+    const bool parallel = m * n * sizeof(T) >= kParallelMemoryThreshold;
+    (void)parallel; // Only read by the OpenMP clauses.
+    #pragma omp parallel if(parallel)
+    {
+        AlignedBuffer<T> copy(m);
+        #pragma omp for schedule(static)
+        for(size_t j = 0; j < n; j++) {
+            T * column = view.Data() + j * view.ColumnStride();
+            for(size_t i = 0; i < m; i++)
+                copy[i] = column[i * stride];
+            for(size_t i = 0; i < m; i++)
+                column[i * stride] = copy[permutation[i]];
+        }
+    }
+}
+
+/// True if the rows of view are contiguous and its columns are not.
+template <class T>
+bool RowsContiguous(const MatrixView<T> & view) {
+    return view.ColumnStride() == 1 && view.RowStride() != 1;
+}
+
+} // namespace MatrixKernels
+
+/// The matrix whose column k is column indices[k] of source.
+template <class T>
+Matrix<typename std::remove_const<T>::type> GatherColumns(const MatrixView<T> & source, const std::vector<size_t> & indices) {
+    typedef typename std::remove_const<T>::type U;
+    if(indices.empty())
+        throw std::invalid_argument("Invalid argument. Cannot gather an empty list of columns");
+    MatrixKernels::CheckIndices(indices, source.Columns(), false);
+    Matrix<U> result(source.Rows(), indices.size(), Uninitialized);
+    MatrixKernels::CopyLines(MatrixView<const U>(source), indices.data(), result.View(), nullptr, indices.size());
+    return result;
+}
+
+/// The matrix whose row k is row indices[k] of source.
+template <class T>
+Matrix<typename std::remove_const<T>::type> GatherRows(const MatrixView<T> & source, const std::vector<size_t> & indices) {
+    typedef typename std::remove_const<T>::type U;
+    if(indices.empty())
+        throw std::invalid_argument("Invalid argument. Cannot gather an empty list of rows");
+    MatrixKernels::CheckIndices(indices, source.Rows(), false);
+    Matrix<U> result(indices.size(), source.Columns(), Uninitialized);
+    MatrixKernels::CopyLines(MatrixView<const U>(source).Transpose(), indices.data(), result.View().Transpose(), nullptr, indices.size());
+    return result;
+}
+
+template <class T, class Order>
+Matrix<T> GatherColumns(const Matrix<T, Order> & source, const std::vector<size_t> & indices) {
+    return GatherColumns(source.View(), indices);
+}
+
+template <class T, class Order>
+Matrix<T> GatherRows(const Matrix<T, Order> & source, const std::vector<size_t> & indices) {
+    return GatherRows(source.View(), indices);
+}
+
+/// Writes column k of source over column indices[k] of destination. The indices must be distinct.
+template <class U, class T>
+void ScatterColumns(const MatrixView<U> & source, const std::vector<size_t> & indices, const MatrixView<T> & destination) {
+    static_assert(!std::is_const<T>::value, "Cannot scatter through a read-only view");
+    if(source.Columns() != indices.size() || source.Rows() != destination.Rows())
+        throw std::invalid_argument("Invalid argument. Source must have a column per index and the rows of the destination");
+    MatrixKernels::CheckIndices(indices, destination.Columns(), true);
+    const MatrixView<const T> in(source);
+    if(MatrixKernels::Overlaps(in, MatrixView<const T>(destination))) {
+        const Matrix<T> copy(in);
+        MatrixKernels::CopyLines(copy.View(), nullptr, destination, indices.data(), indices.size());
+        return;
+    }
+    MatrixKernels::CopyLines(in, nullptr, destination, indices.data(), indices.size());
+}
+
+/// Writes row k of source over row indices[k] of destination. The indices must be distinct.
+template <class U, class T>
+void ScatterRows(const MatrixView<U> & source, const std::vector<size_t> & indices, const MatrixView<T> & destination) {
+    ScatterColumns(source.Transpose(), indices, destination.Transpose());
+}
+
+template <class U, class T, class Order>
+void ScatterColumns(const MatrixView<U> & source, const std::vector<size_t> & indices, Matrix<T, Order> & destination) {
+    ScatterColumns(source, indices, destination.View());
+}
+
+template <class U, class T, class Order>
+void ScatterRows(const MatrixView<U> & source, const std::vector<size_t> & indices, Matrix<T, Order> & destination) {
+    ScatterRows(source, indices, destination.View());
+}
+
+template <class T, class SourceOrder, class Order>
+void ScatterColumns(const Matrix<T, SourceOrder> & source, const std::vector<size_t> & indices, Matrix<T, Order> & destination) {
+    ScatterColumns(source.View(), indices, destination.View());
+}
+
+template <class T, class SourceOrder, class Order>
+void ScatterRows(const Matrix<T, SourceOrder> & source, const std::vector<size_t> & indices, Matrix<T, Order> & destination) {
+    ScatterRows(source.View(), indices, destination.View());
+}
+
+/// Reorders the columns in place, so that column k holds what was column permutation[k].
+template <class T>
+void PermuteColumns(const MatrixView<T> & view, const std::vector<size_t> & permutation) {
+    static_assert(!std::is_const<T>::value, "Cannot permute through a read-only view");
+    MatrixKernels::CheckPermutation(permutation, view.Columns());
+    if(MatrixKernels::RowsContiguous(view))
+        MatrixKernels::PermuteWithinLines(view.Transpose(), permutation);
+    else
+        MatrixKernels::PermuteLines(view, permutation);
+}
+
+/// Reorders the rows in place, so that row i holds what was row permutation[i].
+template <class T>
+void PermuteRows(const MatrixView<T> & view, const std::vector<size_t> & permutation) {
+    static_assert(!std::is_const<T>::value, "Cannot permute through a read-only view");
+    MatrixKernels::CheckPermutation(permutation, view.Rows());
+    if(MatrixKernels::RowsContiguous(view))
+        MatrixKernels::PermuteLines(view.Transpose(), permutation);
+    else
+        MatrixKernels::PermuteWithinLines(view, permutation);
+}
+
+template <class T, class Order>
+void PermuteColumns(Matrix<T, Order> & matrix, const std::vector<size_t> & permutation) {
+    PermuteColumns(matrix.View(), permutation);
+}
+
+template <class T, class Order>
+void PermuteRows(Matrix<T, Order> & matrix, const std::vector<size_t> & permutation) {
+    PermuteRows(matrix.View(), permutation);
+}
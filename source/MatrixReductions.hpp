@@ -0,0 +1,419 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "Matrix.hpp"
+
+/**
+ * Reductions over matrices, views and elementwise expressions: whole-matrix sums, means,
+ * extrema, norms and dot products, and the same per row or per column. Sum(A - B) and
+ * Dot(A, B) read their operands once and never build the intermediate matrix.
+ *
+ * Each column is reduced a register at a time into several independent accumulators, so
+ * the adds overlap instead of waiting on each other. Large matrices are split into a fixed
+ * number of chunks of columns, or of pieces of columns when there are only a few long ones,
+ * reduced in parallel and combined pairwise. This keeps floating point results the same
+ * whatever the thread count. Row-wise reductions sweep blocks of
+ * rows across all columns, so they read the column-major storage contiguously as well.
+ *
+ * Extrema skip NaNs, as std::fmin and std::fmax do, so a NaN anywhere leaves the result and
+ * its position alone. Where every element is NaN, the extremum is infinity (minus infinity
+ * for maxima) and ArgMin and ArgMax give (0, 0).
+ *
+ * Sums, extrema and norms other than FrobeniusNorm are computed in the element type, so
+ * integer sums that overflow it are undefined for signed types, as any signed overflow is.
+ * Means, variances and the Frobenius norm of integer matrices are computed in double.
+ */
+
+/// The element type of a matrix, view or expression.
+template <class X>
+using OperandValue = typename ExpressionOperand<X>::Type::ValueType;
+
+/// The type statistics of T are computed in: T itself for floating point types, else double.
+template <class T>
+using RealType = typename std::conditional<std::is_floating_point<T>::value, T, double>::type;
+
+namespace MatrixKernels {
+
+/// Number of chunks the columns of a large matrix are split into for a parallel reduction.
+const size_t kReductionChunks = 64;
+/// The fewest elements worth a piece of their own when columns are cut into pieces.
+const size_t kReductionMinPieceElements = 4 * 1024;
+/// Bytes of partial results kept per row block of a row-wise reduction; fits in L1.
+const size_t kReductionRowBlockBytes = 8 * 1024;
+/// Number of row blocks a row-wise reduction aims for, when they fit in kReductionRowBlockBytes.
+/// More blocks share out better between threads but reread each column in shorter pieces.
+const size_t kReductionRowBlocks = 4;
+
+template <class T>
+struct SumReduction : AddOp {
+    static T Identity() { return T(0); }
+};
+
+//The running result always comes first, and P::Min and P::Max keep their first operand when
+//either is NaN, so NaN elements are skipped, as by std::fmin and std::fmax. Where two elements
+//are combined directly, ApplyEither picks the other one when the first is NaN.
+template <class T>
+struct MinReduction : MinOp {
+    static T Identity() { return std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::max(); }
+};
+
+template <class T>
+struct MaxReduction : MaxOp {
+    static T Identity() { return std::numeric_limits<T>::has_infinity ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::lowest(); }
+};
+
+template <class Op> struct SkipsNaN : std::false_type {};
+template <class T> struct SkipsNaN<MinReduction<T>> : std::is_floating_point<T> {};
+template <class T> struct SkipsNaN<MaxReduction<T>> : std::is_floating_point<T> {};
+
+template <class P>
+typename P::Type SkipNaN(typename P::Type result, typename P::Type a, typename P::Type b, std::true_type) {
+    return P::Select(P::Equal(a, a), result, b);
+}
+
+template <class P>
+typename P::Type SkipNaN(typename P::Type result, typename P::Type, typename P::Type, std::false_type) {
+    return result;
+}
+
+/// Op::Apply for two operands either of which may be NaN.
+template <class Op, class P>
+typename P::Type ApplyEither(typename P::Type a, typename P::Type b) {
+    return SkipNaN<P>(Op::template Apply<P>(a, b), a, b, SkipsNaN<Op>());
+}
+
+/// Number of pieces each of n columns of length m is cut into for a parallel reduction.
+/// Depends only on the shape, so that results don't depend on the thread count.
+inline size_t ReductionPieces(size_t n, size_t m) {
+    if(n >= kReductionChunks)
+        return 1;
+    return std::max<size_t>(1, std::min((kReductionChunks + n - 1) / n, m / kReductionMinPieceElements));
+}
+
+/// Reduces rows [begin, end) of column j of expr. wide says whether the column may be read a register at a time.
+template <class Op, class E>
+typename E::ValueType ReduceColumn(const E & expr, size_t j, size_t begin, size_t end, bool wide) {
+    typedef typename E::ValueType T;
+    typedef Packet<T> P;
+    typedef ScalarPacket<T> S;
+    T result = Op::Identity();
+    size_t i = begin;
+    if(wide && P::Width > 1 && end - begin >= P::Width) {
+        //Four accumulators hide the latency of each add.
+        typename P::Type acc0 = P::Set(Op::Identity()), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+        for(; i + 4 * P::Width <= end; i += 4 * P::Width) {
+            acc0 = Op::template Apply<P>(acc0, expr.template Evaluate<P>(i, j));
+            acc1 = Op::template Apply<P>(acc1, expr.template Evaluate<P>(i + P::Width, j));
+            acc2 = Op::template Apply<P>(acc2, expr.template Evaluate<P>(i + 2 * P::Width, j));
+            acc3 = Op::template Apply<P>(acc3, expr.template Evaluate<P>(i + 3 * P::Width, j));
+        }
+        for(; i + P::Width <= end; i += P::Width)
+            acc0 = Op::template Apply<P>(acc0, expr.template Evaluate<P>(i, j));
+        acc0 = Op::template Apply<P>(Op::template Apply<P>(acc0, acc1), Op::template Apply<P>(acc2, acc3));
+        T lanes[P::Width];
+        P::Store(lanes, acc0);
+        for(size_t k = 0; k < P::Width; k++)
+            result = Op::template Apply<S>(result, lanes[k]);
+    }
+    for(; i < end; i++)
+        result = Op::template Apply<S>(result, expr.template Evaluate<S>(i, j));
+    return result;
+}
+
+/// True when expr is read faster along its rows, e.g. a row-major matrix.
+template <class E>
+bool PrefersTranspose(const E & expr) {
+    return !expr.UnitRowStride() && expr.Transposed().UnitRowStride();
+}
+
+/// Reduces every element of expr.
+template <class Op, class E>
+typename E::ValueType Reduce(const E & expr) {
+    typedef typename E::ValueType T;
+    if(PrefersTranspose(expr))
+        return Reduce<Op>(expr.Transposed());
+
+    const size_t m = expr.Rows();
+    const size_t n = expr.Columns();
+    const bool wide = expr.UnitRowStride();
+    if(m * n * sizeof(T) < kParallelMemoryThreshold) {
+        T result = Op::Identity();
+        for(size_t j = 0; j < n; j++)
+            result = Op::template Apply<ScalarPacket<T>>(result, ReduceColumn<Op>(expr, j, 0, m, wide));
+        return result;
+    }
+
+    //Each column is one piece, unless there are too few columns to go round,
+    //in which case long columns are cut into pieces of rows as well.
+    const size_t pieces = ReductionPieces(n, m);
+    const size_t units = n * pieces;
+    const size_t chunks = std::min(units, kReductionChunks);
+    std::vector<T> partial(chunks, Op::Identity());
+    #pragma omp parallel for schedule(static)
+    for(size_t c = 0; c < chunks; c++) {
+        for(size_t u = c * units / chunks; u < (c + 1) * units / chunks; u++) {
+            const size_t j = u / pieces;
+            const size_t piece = u % pieces;
+            const T value = ReduceColumn<Op>(expr, j, piece * m / pieces, (piece + 1) * m / pieces, wide);
+            partial[c] = Op::template Apply<ScalarPacket<T>>(partial[c], value);
+        }
+    }
+    //Combine pairwise, as a tree.
+    for(size_t step = 1; step < chunks; step *= 2)
+        for(size_t c = 0; c + step < chunks; c += 2 * step)
+            partial[c] = Op::template Apply<ScalarPacket<T>>(partial[c], partial[c + step]);
+    return partial[0];
+}
+
+template <class Op, class E, class T>
+void ReduceRows(const E & expr, T * out, size_t outStride);
+
+/// Reduces each column of expr into out[j * outStride].
+template <class Op, class E, class T>
+void ReduceColumns(const E & expr, T * out, size_t outStride) {
+    if(PrefersTranspose(expr)) {
+        ReduceRows<Op>(expr.Transposed(), out, outStride);
+        return;
+    }
+    const size_t n = expr.Columns();
+    const bool wide = expr.UnitRowStride();
+    if(expr.Rows() * n * sizeof(T) < kParallelMemoryThreshold) {
+        for(size_t j = 0; j < n; j++)
+            out[j * outStride] = ReduceColumn<Op>(expr, j, 0, expr.Rows(), wide);
+        return;
+    }
+    #pragma omp parallel for schedule(static)
+    for(size_t j = 0; j < n; j++)
+        out[j * outStride] = ReduceColumn<Op>(expr, j, 0, expr.Rows(), wide);
+}
+
+/**
+ * Reduces each row of expr into out[i * outStride]. Going along a row would stride through
+ * the columns, so instead a block of rows keeps its partial results in out, which stays in
+ * cache, while the block is swept across all the columns a register at a time.
+ */
+template <class Op, class E, class T>
+void ReduceRows(const E & expr, T * out, size_t outStride) {
+    if(PrefersTranspose(expr)) {
+        ReduceColumns<Op>(expr.Transposed(), out, outStride);
+        return;
+    }
+    if(outStride != 1) {
+        std::vector<T> packed(expr.Rows());
+        ReduceRows<Op>(expr, packed.data(), 1);
+        for(size_t i = 0; i < packed.size(); i++)
+            out[i * outStride] = packed[i];
+        return;
+    }
+
+    typedef Packet<T> P;
+    typedef ScalarPacket<T> S;
+    const size_t m = expr.Rows();
+    const size_t n = expr.Columns();
+    const bool wide = P::Width > 1 && expr.UnitRowStride();
+    //A few blocks for the threads to share, each a whole number of registers.
+    const size_t maxBlock = kReductionRowBlockBytes / sizeof(T);
+    const size_t minBlock = P::Width * 4;
+    size_t block = std::min(maxBlock, (m / kReductionRowBlocks + P::Width - 1) / P::Width * P::Width);
+    block = std::max(block, minBlock);
+    const size_t blocks = (m + block - 1) / block;
+
+    auto reduceBlock = [&](size_t b) {
+        const size_t first = b * block;
+        const size_t last = std::min(m, first + block);
+        for(size_t i = first; i < last; i++)
+            out[i] = Op::Identity();
+        size_t j = 0;
+        if(wide) {
+            //Four columns at a time, so the partial results are loaded and stored a quarter as often.
+            for(; j + 4 <= n; j += 4) {
+                size_t i = first;
+                for(; i + P::Width <= last; i += P::Width) {
+                    const typename P::Type pair0 = ApplyEither<Op, P>(expr.template Evaluate<P>(i, j), expr.template Evaluate<P>(i, j + 1));
+                    const typename P::Type pair1 = ApplyEither<Op, P>(expr.template Evaluate<P>(i, j + 2), expr.template Evaluate<P>(i, j + 3));
+                    P::Store(out + i, Op::template Apply<P>(P::Load(out + i), ApplyEither<Op, P>(pair0, pair1)));
+                }
+                for(; i < last; i++)
+                    for(size_t k = j; k < j + 4; k++)
+                        out[i] = Op::template Apply<S>(out[i], expr.template Evaluate<S>(i, k));
+            }
+        }
+        for(; j < n; j++) {
+            size_t i = first;
+            if(wide) {
+                for(; i + P::Width <= last; i += P::Width)
+                    P::Store(out + i, Op::template Apply<P>(P::Load(out + i), expr.template Evaluate<P>(i, j)));
+            }
+            for(; i < last; i++)
+                out[i] = Op::template Apply<S>(out[i], expr.template Evaluate<S>(i, j));
+        }
+    };
+
+    if(m * n * sizeof(T) < kParallelMemoryThreshold) {
+        for(size_t b = 0; b < blocks; b++)
+            reduceBlock(b);
+        return;
+    }
+    #pragma omp parallel for schedule(static)
+    for(size_t b = 0; b < blocks; b++)
+        reduceBlock(b);
+}
+
+/// The position of the first element of expr, in column-major order, equal to value.
+template <class E>
+std::pair<size_t, size_t> Find(const E & expr, typename E::ValueType value) {
+    typedef ScalarPacket<typename E::ValueType> S;
+    for(size_t j = 0; j < expr.Columns(); j++)
+        for(size_t i = 0; i < expr.Rows(); i++)
+            if(expr.template Evaluate<S>(i, j) == value)
+                return std::make_pair(i, j);
+    return std::make_pair(size_t(0), size_t(0));
+}
+
+} // namespace MatrixKernels
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+OperandValue<X> Sum(const X & operand) {
+    return MatrixKernels::Reduce<MatrixKernels::SumReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand));
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+OperandValue<X> MinElement(const X & operand) {
+    return MatrixKernels::Reduce<MatrixKernels::MinReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand));
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+OperandValue<X> MaxElement(const X & operand) {
+    return MatrixKernels::Reduce<MatrixKernels::MaxReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand));
+}
+
+/// The (row, column) of the smallest element other than NaN; the first in column-major order on ties.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+std::pair<size_t, size_t> ArgMin(const X & operand) {
+    const auto expr = ExpressionOperand<X>::Make(operand);
+    return MatrixKernels::Find(expr, MatrixKernels::Reduce<MatrixKernels::MinReduction<OperandValue<X>>>(expr));
+}
+
+/// The (row, column) of the largest element other than NaN; the first in column-major order on ties.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+std::pair<size_t, size_t> ArgMax(const X & operand) {
+    const auto expr = ExpressionOperand<X>::Make(operand);
+    return MatrixKernels::Find(expr, MatrixKernels::Reduce<MatrixKernels::MaxReduction<OperandValue<X>>>(expr));
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+RealType<OperandValue<X>> Mean(const X & operand) {
+    typedef RealType<OperandValue<X>> R;
+    return Sum(Cast<R>(operand)) / R(operand.Rows() * operand.Columns());
+}
+
+/// The population variance, the mean squared deviation from the mean.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+RealType<OperandValue<X>> Variance(const X & operand) {
+    typedef RealType<OperandValue<X>> R;
+    const auto deviation = Cast<R>(operand) - Mean(operand);
+    return Sum(Hadamard(deviation, deviation)) / R(operand.Rows() * operand.Columns());
+}
+
+/// The sum of the elementwise products.
+template <class L, class R, class = EnableIfOperands<L, R>>
+OperandValue<L> Dot(const L & lhs, const R & rhs) {
+    return Sum(Hadamard(lhs, rhs));
+}
+
+/// The square root of the sum of squares of the elements.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+RealType<OperandValue<X>> FrobeniusNorm(const X & operand) {
+    typedef RealType<OperandValue<X>> R;
+    const auto elements = Cast<R>(operand);
+    return std::sqrt(Sum(Hadamard(elements, elements)));
+}
+
+/// The sum of the diagonal elements.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+OperandValue<X> Trace(const X & operand) {
+    typedef OperandValue<X> T;
+    const auto expr = ExpressionOperand<X>::Make(operand);
+    T result = T(0);
+    for(size_t i = 0; i < std::min(expr.Rows(), expr.Columns()); i++)
+        result = T(result + expr.template Evaluate<MatrixKernels::ScalarPacket<T>>(i, i));
+    return result;
+}
+
+// Per-column reductions give a 1 x Columns() matrix, per-row ones a Rows() x 1 matrix.
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> ColumnSums(const X & operand) {
+    Matrix<OperandValue<X>> result(1, operand.Columns(), Uninitialized);
+    const auto out = result.View();
+    MatrixKernels::ReduceColumns<MatrixKernels::SumReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand), out.Data(), out.ColumnStride());
+    return result;
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> RowSums(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), 1, Uninitialized);
+    const auto out = result.View();
+    MatrixKernels::ReduceRows<MatrixKernels::SumReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand), out.Data(), out.RowStride());
+    return result;
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> ColumnMinima(const X & operand) {
+    Matrix<OperandValue<X>> result(1, operand.Columns(), Uninitialized);
+    const auto out = result.View();
+    MatrixKernels::ReduceColumns<MatrixKernels::MinReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand), out.Data(), out.ColumnStride());
+    return result;
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> RowMinima(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), 1, Uninitialized);
+    const auto out = result.View();
+    MatrixKernels::ReduceRows<MatrixKernels::MinReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand), out.Data(), out.RowStride());
+    return result;
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> ColumnMaxima(const X & operand) {
+    Matrix<OperandValue<X>> result(1, operand.Columns(), Uninitialized);
+    const auto out = result.View();
+    MatrixKernels::ReduceColumns<MatrixKernels::MaxReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand), out.Data(), out.ColumnStride());
+    return result;
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> RowMaxima(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), 1, Uninitialized);
+    const auto out = result.View();
+    MatrixKernels::ReduceRows<MatrixKernels::MaxReduction<OperandValue<X>>>(ExpressionOperand<X>::Make(operand), out.Data(), out.RowStride());
+    return result;
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<RealType<OperandValue<X>>> ColumnMeans(const X & operand) {
+    typedef RealType<OperandValue<X>> R;
+    return ColumnSums(Cast<R>(operand)) / R(operand.Rows());
+}
+
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<RealType<OperandValue<X>>> RowMeans(const X & operand) {
+    typedef RealType<OperandValue<X>> R;
+    return RowSums(Cast<R>(operand)) / R(operand.Columns());
+}
+
+/// The induced 1-norm, the largest sum of absolute values in a column.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+OperandValue<X> NormL1(const X & operand) {
+    return MaxElement(ColumnSums(Abs(operand)));
+}
+
+/// The induced infinity norm, the largest sum of absolute values in a row.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+OperandValue<X> NormInf(const X & operand) {
+    return MaxElement(RowSums(Abs(operand)));
+}
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "MatrixReductions.hpp"
+
+/**
+ * Prefix sums of matrices, views and elementwise expressions: running sums down each column
+ * or along each row, inclusive (element i is the sum of elements 0 to i) or exclusive (of
+ * elements 0 to i - 1, so the first is 0), and 2D integral images, also known as
+ * summed-area tables.
+ *
+ * A column scan goes down the contiguous column a register at a time: the register is
+ * scanned in place with a few shifts and adds, then the running sum is added to every lane.
+ * A row scan sweeps a block of rows across all the columns, adding each column to the block
+ * of running sums, which stays in cache. An integral image does both in one pass, adding
+ * each scanned column to the previous one.
+ *
+ * Large scans with many columns (rows for row scans) are split between the threads by
+ * columns. Scans of a few long lines are split along the lines as well, into a fixed number
+ * of pieces: each piece is scanned on its own in parallel, the totals of the pieces are
+ * scanned, and a second parallel pass adds them to the later pieces. Floating point
+ * results therefore depend on the shape but not the thread count, and may differ in the
+ * last bits from a sequential loop. Integer sums that overflow are undefined for signed
+ * types, as any signed overflow is.
+ */
+
+namespace MatrixKernels {
+
+/// Number of pieces a large scan is split into, when it has fewer lines than this.
+const size_t kScanPieces = 64;
+/// The fewest elements worth a piece of their own; smaller scans are split less.
+const size_t kScanMinPieceElements = 4 * 1024;
+/// Bytes of running sums per row block of a row scan; fits in L1.
+const size_t kScanRowBlockBytes = 8 * 1024;
+
+/// Number of pieces each of lines lines is cut into, when a line is length steps of width
+/// elements. Depends only on the shape, so that results don't depend on the thread count.
+inline size_t ScanPieces(size_t lines, size_t length, size_t width, size_t bytes) {
+    if(bytes < kParallelMemoryThreshold || lines >= kScanPieces)
+        return 1;
+    return std::max<size_t>(1, std::min((kScanPieces + lines - 1) / lines, length * width / kScanMinPieceElements));
+}
+
+/// Scans one register v onto running, the sum of everything before it, and moves running past it.
+template <class P>
+typename P::Type ScanStep(typename P::Type v, typename P::Type & running, bool exclusive) {
+    const typename P::Type inclusive = P::Add(running, P::PrefixSum(v));
+    const typename P::Type result = exclusive ? P::ShiftUp(running, inclusive) : inclusive;
+    running = P::BroadcastLast(inclusive);
+    return result;
+}
+
+/// Scans rows [begin, end) of column j of expr into dst, from 0, and returns their total.
+template <class E, class T>
+T ScanColumnPiece(const E & expr, const MatrixView<T> & dst, size_t j, size_t begin, size_t end, bool exclusive, bool wide) {
+    typedef Packet<T> P;
+    typedef ScalarPacket<T> S;
+    T * out = dst.Data() + j * dst.ColumnStride();
+    T total = T(0);
+    size_t i = begin;
+    if(wide && end - begin >= P::Width) {
+        typename P::Type running = P::Set(T(0));
+        for(; i + P::Width <= end; i += P::Width)
+            P::Store(out + i, ScanStep<P>(expr.template Evaluate<P>(i, j), running, exclusive));
+        T lanes[P::Width];
+        P::Store(lanes, running);
+        total = lanes[0];
+    }
+    for(; i < end; i++)
+        out[i * dst.RowStride()] = ScanStep<S>(expr.template Evaluate<S>(i, j), total, exclusive);
+    return total;
+}
+
+/// Adds offset to rows [begin, end) of column j of dst.
+template <class T>
+void AddToColumn(const MatrixView<T> & dst, size_t j, size_t begin, size_t end, T offset) {
+    typedef Packet<T> P;
+    T * out = dst.Data() + j * dst.ColumnStride();
+    size_t i = begin;
+    if(dst.RowStride() == 1) {
+        const typename P::Type add = P::Set(offset);
+        for(; i + P::Width <= end; i += P::Width)
+            P::Store(out + i, P::Add(P::Load(out + i), add));
+    }
+    for(; i < end; i++)
+        out[i * dst.RowStride()] = T(out[i * dst.RowStride()] + offset);
+}
+
+template <class E, class T>
+void ScanRows(const E & expr, const MatrixView<T> & dst, bool exclusive);
+
+/// Scans each column of expr into dst, which has its shape.
+template <class E, class T>
+void ScanColumns(const E & expr, const MatrixView<T> & dst, bool exclusive) {
+    if(dst.RowStride() != 1 && dst.ColumnStride() == 1) {
+        //Row-major destination: its columns are strided, its rows contiguous.
+        ScanRows(expr.Transposed(), dst.Transpose(), exclusive);
+        return;
+    }
+    const size_t m = dst.Rows();
+    const size_t n = dst.Columns();
+    const bool wide = Packet<T>::Width > 1 && dst.RowStride() == 1 && expr.UnitRowStride();
+    const size_t pieces = ScanPieces(n, m, 1, m * n * sizeof(T));
+    if(pieces == 1) {
+        if(m * n * sizeof(T) < kParallelMemoryThreshold) {
+            for(size_t j = 0; j < n; j++)
+                ScanColumnPiece(expr, dst, j, 0, m, exclusive, wide);
+            return;
+        }
+        #pragma omp parallel for schedule(static)
+        for(size_t j = 0; j < n; j++)
+            ScanColumnPiece(expr, dst, j, 0, m, exclusive, wide);
+        return;
+    }
+
+    //Pieces a whole number of registers long, so that only the last piece of a column has a scalar tail.
+    const size_t length = ((m + pieces - 1) / pieces + Packet<T>::Width - 1) / Packet<T>::Width * Packet<T>::Width;
+    const size_t units = n * pieces;
+    std::vector<T> totals(units, T(0));
+    #pragma omp parallel for schedule(static)
+    for(size_t k = 0; k < units; k++) {
+        const size_t begin = std::min(m, (k % pieces) * length);
+        totals[k] = ScanColumnPiece(expr, dst, k / pieces, begin, std::min(m, begin + length), exclusive, wide);
+    }
+    //Each piece's offset is the sum of the totals of the pieces above it.
+    for(size_t j = 0; j < n; j++) {
+        T offset = T(0);
+        for(size_t p = 0; p < pieces; p++) {
+            const T total = totals[j * pieces + p];
+            totals[j * pieces + p] = offset;
+            offset = T(offset + total);
+        }
+    }
+    #pragma omp parallel for schedule(static)
+    for(size_t k = 0; k < units; k++) {
+        const size_t begin = std::min(m, (k % pieces) * length);
+        if(k % pieces != 0)
+            AddToColumn(dst, k / pieces, begin, std::min(m, begin + length), totals[k]);
+    }
+}
+
+/**
+ * Scans rows [rowBegin, rowEnd) of columns [begin, end) of expr into dst. running holds the
+ * sums of each row before column begin, and is left holding them through column end - 1.
+ */
+template <class E, class T>
+void ScanRowPiece(const E & expr, const MatrixView<T> & dst, size_t rowBegin, size_t rowEnd, size_t begin, size_t end,
+                  T * running, bool exclusive, bool wide) {
+    typedef Packet<T> P;
+    typedef ScalarPacket<T> S;
+    for(size_t j = begin; j < end; j++) {
+        T * out = dst.Data() + j * dst.ColumnStride();
+        size_t i = rowBegin;
+        if(wide) {
+            for(; i + P::Width <= rowEnd; i += P::Width) {
+                T * sums = running + (i - rowBegin);
+                const typename P::Type before = P::Load(sums);
+                const typename P::Type after = P::Add(before, expr.template Evaluate<P>(i, j));
+                P::Store(sums, after);
+                P::Store(out + i, exclusive ? before : after);
+            }
+        }
+        for(; i < rowEnd; i++) {
+            T & sum = running[i - rowBegin];
+            const T before = sum;
+            sum = S::Add(before, expr.template Evaluate<S>(i, j));
+            out[i * dst.RowStride()] = exclusive ? before : sum;
+        }
+    }
+}
+
+/// Scans each row of expr into dst, which has its shape, a block of rows at a time.
+template <class E, class T>
+void ScanRows(const E & expr, const MatrixView<T> & dst, bool exclusive) {
+    if(dst.RowStride() != 1 && dst.ColumnStride() == 1) {
+        ScanColumns(expr.Transposed(), dst.Transpose(), exclusive);
+        return;
+    }
+    typedef Packet<T> P;
+    const size_t m = dst.Rows();
+    const size_t n = dst.Columns();
+    const bool wide = P::Width > 1 && dst.RowStride() == 1 && expr.UnitRowStride();
+    const size_t block = std::max(size_t(P::Width), kScanRowBlockBytes / sizeof(T));
+    const size_t blocks = (m + block - 1) / block;
+    const size_t pieces = ScanPieces(blocks, n, std::min(m, block), m * n * sizeof(T));
+    const size_t length = (n + pieces - 1) / pieces;
+    const size_t units = blocks * pieces;
+
+    //The running sums of unit k's rows at the end of its piece of columns.
+    std::vector<T> totals(units * block, T(0));
+    auto scanUnit = [&](size_t k) {
+        const size_t first = (k / pieces) * block;
+        const size_t begin = std::min(n, (k % pieces) * length);
+        ScanRowPiece(expr, dst, first, std::min(m, first + block), begin, std::min(n, begin + length), &totals[k * block], exclusive, wide);
+    };
+    if(m * n * sizeof(T) < kParallelMemoryThreshold) {
+        for(size_t k = 0; k < units; k++)
+            scanUnit(k);
+    }
+    else {
+        #pragma omp parallel for schedule(static)
+        for(size_t k = 0; k < units; k++)
+            scanUnit(k);
+    }
+    if(pieces == 1)
+        return;
+
+    //Turn each piece's totals into the offsets of its rows, the sums over the pieces to its left.
+    for(size_t b = 0; b < blocks; b++) {
+        std::vector<T> offsets(block, T(0));
+        for(size_t p = 0; p < pieces; p++) {
+            T * sums = &totals[(b * pieces + p) * block];
+            for(size_t r = 0; r < block; r++) {
+                const T total = sums[r];
+                sums[r] = offsets[r];
+                offsets[r] = T(offsets[r] + total);
+            }
+        }
+    }
+    #pragma omp parallel for schedule(static)
+    for(size_t k = 0; k < units; k++) {
+        if(k % pieces == 0)
+            continue;
+        const size_t first = (k / pieces) * block;
+        const size_t last = std::min(m, first + block);
+        const size_t begin = std::min(n, (k % pieces) * length);
+        for(size_t j = begin; j < std::min(n, begin + length); j++) {
+            T * out = dst.Data() + j * dst.ColumnStride();
+            const T * offsets = &totals[k * block];
+            size_t i = first;
+            if(dst.RowStride() == 1) {
+                for(; i + P::Width <= last; i += P::Width)
+                    P::Store(out + i, P::Add(P::Load(out + i), P::Load(offsets + (i - first))));
+            }
+            for(; i < last; i++)
+                out[i * dst.RowStride()] = T(out[i * dst.RowStride()] + offsets[i - first]);
+        }
+    }
+}
+
+/// Integral image of columns [begin, end) of expr into dst, as if the columns before begin were 0.
+template <class E, class T>
+void IntegralImagePiece(const E & expr, const MatrixView<T> & dst, size_t begin, size_t end, bool wide) {
+    typedef Packet<T> P;
+    typedef ScalarPacket<T> S;
+    const size_t m = dst.Rows();
+    for(size_t j = begin; j < end; j++) {
+        T * out = dst.Data() + j * dst.ColumnStride();
+        //The integral image of the previous column, if it is in the piece.
+        const T * previous = j > begin ? out - dst.ColumnStride() : nullptr;
+        size_t i = 0;
+        T running = T(0);
+        if(wide && m >= P::Width) {
+            typename P::Type sums = P::Set(T(0));
+            for(; i + P::Width <= m; i += P::Width) {
+                const typename P::Type scanned = ScanStep<P>(expr.template Evaluate<P>(i, j), sums, false);
+                P::Store(out + i, previous ? P::Add(P::Load(previous + i), scanned) : scanned);
+            }
+            T lanes[P::Width];
+            P::Store(lanes, sums);
+            running = lanes[0];
+        }
+        for(; i < m; i++) {
+            running = S::Add(running, expr.template Evaluate<S>(i, j));
+            out[i * dst.RowStride()] = previous ? T(previous[i * dst.RowStride()] + running) : running;
+        }
+    }
+}
+
+/// The 2D inclusive prefix sums of expr into dst, which has its shape.
+template <class E, class T>
+void IntegralImage(const E & expr, const MatrixView<T> & dst) {
+    if(dst.RowStride() != 1 && dst.ColumnStride() == 1) {
+        //The integral image of the transpose is the transpose of the integral image.
+        IntegralImage(expr.Transposed(), dst.Transpose());
+        return;
+    }
+    const size_t m = dst.Rows();
+    const size_t n = dst.Columns();
+    const bool wide = Packet<T>::Width > 1 && dst.RowStride() == 1 && expr.UnitRowStride();
+    if(m * n * sizeof(T) < kParallelMemoryThreshold) {
+        IntegralImagePiece(expr, dst, 0, n, wide);
+        return;
+    }
+
+    //Pieces of columns, each integrated on its own, then offset by the last column of the
+    //pieces to their left.
+    const size_t pieces = std::min(n, kScanPieces);
+    const size_t length = (n + pieces - 1) / pieces;
+    #pragma omp parallel for schedule(static)
+    for(size_t p = 0; p < pieces; p++)
+        IntegralImagePiece(expr, dst, std::min(n, p * length), std::min(n, (p + 1) * length), wide);
+
+    std::vector<T> offsets(m * pieces, T(0));
+    for(size_t p = 1; p < pieces; p++) {
+        const size_t last = std::min(n, p * length);
+        const T * column = dst.Data() + (last - 1) * dst.ColumnStride();
+        for(size_t i = 0; i < m; i++)
+            offsets[p * m + i] = T(offsets[(p - 1) * m + i] + column[i * dst.RowStride()]);
+    }
+    #pragma omp parallel for schedule(static)
+    for(size_t k = length; k < n; k++) {
+        T * out = dst.Data() + k * dst.ColumnStride();
+        const T * offset = &offsets[(k / length) * m];
+        size_t i = 0;
+        if(dst.RowStride() == 1) {
+            for(; i + Packet<T>::Width <= m; i += Packet<T>::Width)
+                Packet<T>::Store(out + i, Packet<T>::Add(Packet<T>::Load(out + i), Packet<T>::Load(offset + i)));
+        }
+        for(; i < m; i++)
+            out[i * dst.RowStride()] = T(out[i * dst.RowStride()] + offset[i]);
+    }
+}
+
+} // namespace MatrixKernels
+
+/// The running sums down each column: element (i, j) is the sum of elements 0 to i of column j.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> InclusiveColumnScan(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), operand.Columns(), Uninitialized);
+    MatrixKernels::ScanColumns(ExpressionOperand<X>::Make(operand), result.View(), false);
+    return result;
+}
+
+/// The running sums down each column, of the elements above: row 0 is all 0.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> ExclusiveColumnScan(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), operand.Columns(), Uninitialized);
+    MatrixKernels::ScanColumns(ExpressionOperand<X>::Make(operand), result.View(), true);
+    return result;
+}
+
+/// The running sums along each row: element (i, j) is the sum of elements 0 to j of row i.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> InclusiveRowScan(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), operand.Columns(), Uninitialized);
+    MatrixKernels::ScanRows(ExpressionOperand<X>::Make(operand), result.View(), false);
+    return result;
+}
+
+/// The running sums along each row, of the elements to the left: column 0 is all 0.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> ExclusiveRowScan(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), operand.Columns(), Uninitialized);
+    MatrixKernels::ScanRows(ExpressionOperand<X>::Make(operand), result.View(), true);
+    return result;
+}
+
+/// The summed-area table: element (i, j) is the sum of the elements in rows 0 to i and columns 0 to j.
+template <class X, class = typename std::enable_if<ExpressionOperand<X>::value>::type>
+Matrix<OperandValue<X>> IntegralImage(const X & operand) {
+    Matrix<OperandValue<X>> result(operand.Rows(), operand.Columns(), Uninitialized);
+    MatrixKernels::IntegralImage(ExpressionOperand<X>::Make(operand), result.View());
+    return result;
+}
+
+/// The sum of the rows x columns box with top left corner (row, column), from an integral image.
+template <class T, class Order>
+T BoxSum(const Matrix<T, Order> & integral, size_t row, size_t column, size_t rows, size_t columns) {
+    if(rows == 0 || columns == 0)
+        return T(0);
+    if(row + rows > integral.Rows() || column + columns > integral.Columns())
+        throw std::invalid_argument("Invalid argument. Box must lie within the integral image");
+    const size_t bottom = row + rows - 1, right = column + columns - 1;
+    T sum = integral(bottom, right);
+    if(row > 0)
+        sum = T(sum - integral(row - 1, right));
+    if(column > 0)
+        sum = T(sum - integral(bottom, column - 1));
+    if(row > 0 && column > 0)
+        sum = T(sum + integral(row - 1, column - 1));
+    return sum;
+}
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <stdexcept>
+#include <cstddef>
+#include <algorithm>
+#include <iostream>
+#include <type_traits>
+#include <functional>
+#include "TransposeKernels.hpp"
+#include "StorageOrder.hpp"
+#include "BoundsCheck.hpp"
+#include "ElementIterator.hpp"
+
+/**
+ * A non-owning window onto matrix elements stored somewhere else.
+ * Element (row, col) lives at data[row * rowStride + col * colStride], so the same class
+ * describes a plain column-major matrix (rowStride 1) and its transpose (colStride 1)
+ * without moving any data. Use MatrixView<const T> for read-only access.
+ * The viewed storage must outlive the view.
+ * A view is also a range over its elements, taken down each column in turn, so the Row()
+ * and Column() views of a matrix are its strided row and column ranges for STL algorithms.
+ */
+template <class Derived> class MatrixExpression;
+
+template <class T>
+class MatrixView
+{
+public:
+    typedef typename std::remove_const<T>::type ValueType;
+    typedef ElementIterator<T> iterator;
+    typedef ElementIterator<T> const_iterator;
+
+    MatrixView(T * data, size_t numRows, size_t numCols, size_t rowStride, size_t colStride);
+    /// Views of mutable elements convert implicitly to read-only views.
+    template <class U, class = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    MatrixView(const MatrixView<U> & other)
+    : m_data(other.Data()), m_rows(other.Rows()), m_columns(other.Columns()),
+      m_rowStride(other.RowStride()), m_colStride(other.ColumnStride()) {}
+
+    /// Fetches the element at the given coordinates, checked as BoundsChecking<T> says.
+    T & operator()(size_t row, size_t col) const {
+        if(BoundsChecking<ValueType>::value) MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+        return GetUnchecked(row, col);
+    }
+    /// Fetches the element at the given coordinates
+    T & Get(size_t row, size_t col) const;
+    /// Fetches the element at the given coordinates, which must be in range.
+    T & GetUnchecked(size_t row, size_t col) const { return m_data[row * m_rowStride + col * m_colStride]; }
+
+    size_t Rows() const { return m_rows; }
+    size_t Columns() const { return m_columns; }
+    /// Distance, in elements, between vertically adjacent elements.
+    size_t RowStride() const { return m_rowStride; }
+    /// Distance, in elements, between horizontally adjacent elements.
+    size_t ColumnStride() const { return m_colStride; }
+    /// Pointer to element (0, 0).
+    T * Data() const { return m_data; }
+    /// Number of elements.
+    size_t size() const { return m_rows * m_columns; }
+    /// Iterates down each column, then across.
+    iterator begin() const { return iterator(m_data, 0, m_rows, m_rowStride, m_colStride); }
+    iterator end() const { return iterator(m_data + m_columns * m_colStride, 0, m_rows, m_rowStride, m_colStride); }
+
+    /// Returns a view of the transpose of these elements. Nothing is copied.
+    MatrixView Transpose() const { return MatrixView(m_data, m_columns, m_rows, m_colStride, m_rowStride); }
+    /// Returns a view of the numRows x numCols block whose top left element is (row, col).
+    MatrixView Block(size_t row, size_t col, size_t numRows, size_t numCols) const;
+    /// Returns a view of count consecutive rows, starting at row first.
+    MatrixView RowRange(size_t first, size_t count) const { return Block(first, 0, count, m_columns); }
+    /// Returns a view of count consecutive columns, starting at column first.
+    MatrixView ColumnRange(size_t first, size_t count) const { return Block(0, first, m_rows, count); }
+    /// Returns a 1 x Columns() view of one row.
+    MatrixView Row(size_t row) const { return Block(row, 0, 1, m_columns); }
+    /// Returns a Rows() x 1 view of one column.
+    MatrixView Column(size_t col) const { return Block(0, col, m_rows, 1); }
+    /// Returns a numRows x numCols view of every rowStep-th row and every colStep-th column,
+    /// starting at element (row, col).
+    MatrixView Slice(size_t row, size_t col, size_t numRows, size_t numCols, size_t rowStep, size_t colStep) const;
+    /// Returns a numRows x numCols view of the same elements, taken down each column in turn.
+    /// Nothing is copied, so those elements must be evenly spaced in memory, as the elements
+    /// of a column-major matrix without padding, a column or a row are.
+    MatrixView Reshape(size_t numRows, size_t numCols) const;
+    /// Overwrites the viewed elements with those of src, which must have the same dimensions.
+    /// src may overlap this view.
+    void Assign(const MatrixView<const ValueType> & src) const;
+    /// Evaluates an elementwise expression into the viewed elements. See MatrixExpression.hpp.
+    template <class E>
+    void Assign(const MatrixExpression<E> & expression) const;
+    /// Copies the viewed elements into a new, independent matrix.
+    Matrix<ValueType> Materialize() const;
+
+private:
+    T * m_data;
+    size_t m_rows;
+    size_t m_columns;
+    size_t m_rowStride;
+    size_t m_colStride;
+};
+
+template <class T>
+MatrixView<T>::MatrixView(T * data, size_t numRows, size_t numCols, size_t rowStride, size_t colStride)
+: m_data(data), m_rows(numRows), m_columns(numCols), m_rowStride(rowStride), m_colStride(colStride) {
+    if(numRows * numCols == 0) throw std::invalid_argument("Error. Cannot create view with 0 dimension(s)");
+}
+
+template <class T>
+T & MatrixView<T>::Get(size_t row, size_t col) const {
+    MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+    return GetUnchecked(row, col);
+}
+
+template <class T>
+MatrixView<T> MatrixView<T>::Block(size_t row, size_t col, size_t numRows, size_t numCols) const {
+    return Slice(row, col, numRows, numCols, 1, 1);
+}
+
+template <class T>
+MatrixView<T> MatrixView<T>::Slice(size_t row, size_t col, size_t numRows, size_t numCols, size_t rowStep, size_t colStep) const {
+    if(numRows * numCols * rowStep * colStep == 0)
+        throw std::invalid_argument("Error. Cannot create view with 0 dimension(s)");
+    if(row + (numRows - 1) * rowStep >= m_rows || col + (numCols - 1) * colStep >= m_columns)
+        throw std::invalid_argument("Invalid argument. The slice extends past the viewed elements");
+    return MatrixView(m_data + row * m_rowStride + col * m_colStride, numRows, numCols,
+                      m_rowStride * rowStep, m_colStride * colStep);
+}
+
+template <class T>
+MatrixView<T> MatrixView<T>::Reshape(size_t numRows, size_t numCols) const {
+    if(numRows * numCols != m_rows * m_columns)
+        throw std::invalid_argument("Invalid argument. Reshape must keep the number of elements");
+    const size_t step = m_rows > 1 ? m_rowStride : (m_columns > 1 ? m_colStride : 1);
+    if(m_rows > 1 && m_columns > 1 && m_colStride != m_rows * m_rowStride)
+        throw std::invalid_argument("Invalid argument. Only evenly spaced elements can be reshaped without a copy");
+    return MatrixView(m_data, numRows, numCols, step, step * numRows);
+}
+
+template <class T>
+std::ostream & operator<<(std::ostream & out, const MatrixView<T> & m) {
+    for (size_t i = 0; i < m.Rows(); i++) {
+        for(size_t j = 0; j < m.Columns(); j++) {
+            out << m.GetUnchecked(i, j) << ' ';
+        }
+        out << std::endl;
+    }
+
+    return out;
+}
+
+namespace MatrixKernels {
+
+/// Copies any view into a column-major buffer whose columns are ldd elements apart.
+template <class T>
+void CopyToColumnMajor(const MatrixView<const T> & src, T * dst, size_t ldd) {
+    const size_t m = src.Rows();
+    const size_t n = src.Columns();
+    if(src.RowStride() == 1) {
+        //Columns are already contiguous, copy them one at a time.
+        const bool streaming = UseStreamingStores<T>(m * n);
+        #pragma omp parallel if(m * n >= kTransposeParallelThreshold)
+        {
+            #pragma omp for
+            for(size_t j = 0; j < n; j++) {
+                const T * col = src.Data() + j * src.ColumnStride();
+                if(streaming)
+                    StreamCopy(col, dst + j * ldd, m);
+                else
+                    std::copy(col, col + m, dst + j * ldd);
+            }
+            if(streaming)
+                StreamFence();
+        }
+    } else if(src.ColumnStride() == 1) {
+        //Rows are contiguous, so the view is the transpose of a column-major matrix.
+        Transpose(src.Data(), src.RowStride(), dst, ldd, n, m);
+    } else {
+        #pragma omp parallel for if(m * n >= kTransposeParallelThreshold)
+        for(size_t j = 0; j < n; j++) {
+            for(size_t i = 0; i < m; i++)
+                dst[i + j * ldd] = src.Data()[i * src.RowStride() + j * src.ColumnStride()];
+        }
+    }
+}
+
+/// Copies src into dst, which must have the same dimensions and must not overlap it.
+template <class T>
+void Copy(const MatrixView<const T> & src, const MatrixView<T> & dst) {
+    const size_t m = dst.Rows(), n = dst.Columns();
+    const bool packedColumns = src.RowStride() == 1 && dst.RowStride() == 1 && (n == 1 || (src.ColumnStride() == m && dst.ColumnStride() == m));
+    const bool packedRows = src.ColumnStride() == 1 && dst.ColumnStride() == 1 && (m == 1 || (src.RowStride() == n && dst.RowStride() == n));
+    if(packedColumns || packedRows) {
+        //Both are one unbroken run of elements in the same order.
+        Copy(src.Data(), dst.Data(), m * n);
+    } else if(dst.RowStride() == 1) {
+        CopyToColumnMajor(src, dst.Data(), dst.ColumnStride());
+    } else if(dst.ColumnStride() == 1) {
+        //dst is the transpose of a column-major block, so write the transpose of src into that.
+        CopyToColumnMajor(src.Transpose(), dst.Data(), dst.RowStride());
+    } else {
+        //Neither direction is contiguous: copy in square blocks, so that the lines of both
+        //views that a block touches stay in cache while it is copied.
+        const size_t blockRows = (m + kTransposeLeaf - 1) / kTransposeLeaf;
+        const size_t blocks = blockRows * ((n + kTransposeLeaf - 1) / kTransposeLeaf);
+        #pragma omp parallel for schedule(static) if(m * n >= kTransposeParallelThreshold)
+        for(size_t b = 0; b < blocks; b++) {
+            const size_t i0 = b % blockRows * kTransposeLeaf, j0 = b / blockRows * kTransposeLeaf;
+            const size_t iEnd = std::min(m, i0 + kTransposeLeaf), jEnd = std::min(n, j0 + kTransposeLeaf);
+            for(size_t j = j0; j < jEnd; j++)
+                for(size_t i = i0; i < iEnd; i++)
+                    dst.Data()[i * dst.RowStride() + j * dst.ColumnStride()] = src.Data()[i * src.RowStride() + j * src.ColumnStride()];
+        }
+    }
+}
+
+/// True if the address ranges spanned by two views intersect. Interleaved slices that
+/// never touch the same element still count, so a false positive only costs a temporary.
+template <class T>
+bool Overlaps(const MatrixView<const T> & a, const MatrixView<const T> & b) {
+    std::less<const T *> before;
+    const T * aLast = a.Data() + (a.Rows() - 1) * a.RowStride() + (a.Columns() - 1) * a.ColumnStride();
+    const T * bLast = b.Data() + (b.Rows() - 1) * b.RowStride() + (b.Columns() - 1) * b.ColumnStride();
+    return !before(aLast, b.Data()) && !before(bLast, a.Data());
+}
+
+} // namespace MatrixKernels
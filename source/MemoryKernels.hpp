@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <type_traits>
+#ifdef USE_INTRINSICS
+#include "xmmintrin.h"
+#include "emmintrin.h"
+#endif
+
+/**
+ * Bulk fill and copy kernels.
+ *
+ * Writes to a buffer much larger than the last level cache evict everything useful and,
+ * with regular stores, first read every destination line in just to overwrite it.
+ * Above a size threshold these kernels switch to non-temporal (streaming) stores, which
+ * write whole lines straight to memory. Streaming stores are weakly ordered, so every
+ * streaming routine has to be followed by StreamFence() before another thread reads the data.
+ */
+namespace MatrixKernels {
+
+/// Buffers of at least this many bytes are written with streaming stores.
+/// Defaults to 32 MB, larger than the last level cache of most desktop and server parts.
+inline size_t & StreamingStoreThreshold() {
+    static size_t threshold = 32 * 1024 * 1024;
+    return threshold;
+}
+
+/// Returns true if writing count elements of T should bypass the cache.
+template <class T>
+inline bool UseStreamingStores(size_t count) {
+#ifdef USE_INTRINSICS
+    return std::is_arithmetic<T>::value && count * sizeof(T) >= StreamingStoreThreshold();
+#else
+    (void)count;
+    return false;
+#endif
+}
+
+/// Orders all preceding streaming stores of the calling thread before any later store.
+inline void StreamFence() {
+#ifdef USE_INTRINSICS
+    _mm_sfence();
+#endif
+}
+
+#ifdef USE_INTRINSICS
+
+/// Streams one 16 byte vector from src to the 16 byte aligned dst.
+/// The float/double moves never touch the bits, so they are fine for integer types too.
+template <class T>
+inline void StreamVector(const T * src, T * dst) {
+    if(sizeof(T) == 8)
+        _mm_stream_pd(reinterpret_cast<double *>(dst), _mm_loadu_pd(reinterpret_cast<const double *>(src)));
+    else
+        _mm_stream_ps(reinterpret_cast<float *>(dst), _mm_loadu_ps(reinterpret_cast<const float *>(src)));
+}
+
+/// Number of leading elements that have to be stored normally before dst reaches a 16 byte boundary.
+template <class T>
+inline size_t ElementsToAlignment(const T * dst, size_t count) {
+    size_t head = 0;
+    while(head < count && (reinterpret_cast<uintptr_t>(dst + head) & 15) != 0)
+        head++;
+    return head;
+}
+
+#endif
+
+/// Copies count elements with streaming stores. Call StreamFence() afterwards.
+template <class T>
+void StreamCopy(const T * src, T * dst, size_t count) {
+#ifdef USE_INTRINSICS
+    if(std::is_arithmetic<T>::value && 16 % sizeof(T) == 0) {
+        const size_t perVector = 16 / sizeof(T);
+        size_t k = ElementsToAlignment(dst, count);
+        std::copy(src, src + k, dst);
+        for(; k + perVector <= count; k += perVector)
+            StreamVector(src + k, dst + k);
+        std::copy(src + k, src + count, dst + k);
+        return;
+    }
+#endif
+    std::copy(src, src + count, dst);
+}
+
+/// Sets count elements to value with streaming stores. Call StreamFence() afterwards.
+template <class T>
+void StreamFill(T * dst, size_t count, const T & value) {
+#ifdef USE_INTRINSICS
+    if(std::is_arithmetic<T>::value && 16 % sizeof(T) == 0) {
+        const size_t perVector = 16 / sizeof(T);
+        T pattern[16 / sizeof(T) ? 16 / sizeof(T) : 1];
+        std::fill(pattern, pattern + perVector, value);
+
+        size_t k = ElementsToAlignment(dst, count);
+        std::fill(dst, dst + k, value);
+        for(; k + perVector <= count; k += perVector)
+            StreamVector(pattern, dst + k);
+        std::fill(dst + k, dst + count, value);
+        return;
+    }
+#endif
+    std::fill(dst, dst + count, value);
+}
+
+/// Buffers of at least this many bytes are filled and copied by all threads.
+const size_t kParallelMemoryThreshold = 1 << 21;
+/// Each thread takes contiguous runs of this many bytes, a multiple of the page size,
+/// so on NUMA machines a page is first touched by the thread that covers it.
+const size_t kFirstTouchChunk = 1 << 16;
+
+/**
+ * Calls op(begin, count) over consecutive pieces of [0, count). Large ranges are split
+ * statically over all threads, in the same order the omp for loops of the kernels use,
+ * and each thread fences its own streaming stores.
+ */
+template <class T, class Op>
+void ForEachChunk(size_t count, bool streaming, Op op) {
+    //Even a serialized parallel region costs more than filling a small buffer.
+    if(count * sizeof(T) < kParallelMemoryThreshold) {
+        op(0, count);
+        if(streaming)
+            StreamFence();
+        return;
+    }
+
+    const size_t chunk = std::max<size_t>(kFirstTouchChunk / sizeof(T), 1);
+    const size_t chunks = (count + chunk - 1) / chunk;
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for(size_t c = 0; c < chunks; c++)
+            op(c * chunk, std::min(chunk, count - c * chunk));
+        if(streaming)
+            StreamFence();
+    }
+}
+
+/// std::copy that runs in parallel, and with streaming stores, for large buffers.
+template <class T>
+void Copy(const T * src, T * dst, size_t count) {
+    const bool streaming = UseStreamingStores<T>(count);
+    ForEachChunk<T>(count, streaming, [=](size_t begin, size_t n) {
+        if(streaming)
+            StreamCopy(src + begin, dst + begin, n);
+        else
+            std::copy(src + begin, src + begin + n, dst + begin);
+    });
+}
+
+/// std::fill that runs in parallel, and with streaming stores, for large buffers.
+template <class T>
+void Fill(T * dst, size_t count, const T & value) {
+    const bool streaming = UseStreamingStores<T>(count);
+    ForEachChunk<T>(count, streaming, [=](size_t begin, size_t n) {
+        if(streaming)
+            StreamFill(dst + begin, n, value);
+        else
+            std::fill(dst + begin, dst + begin + n, value);
+    });
+}
+
+/// Moves the columns of a rows x cols matrix, in place, from a column stride of fromLd to toLd.
+template <class T>
+void ChangeLeadingDimension(T * data, size_t rows, size_t cols, size_t fromLd, size_t toLd) {
+    if(toLd < fromLd) {
+        //Every column moves towards the front, so walk front to back.
+        for(size_t j = 1; j < cols; j++)
+            std::copy(data + j * fromLd, data + j * fromLd + rows, data + j * toLd);
+    } else if(toLd > fromLd) {
+        for(size_t j = cols - 1; j > 0; j--)
+            std::copy_backward(data + j * fromLd, data + j * fromLd + rows, data + j * toLd + rows);
+    }
+}
+
+} // namespace MatrixKernels
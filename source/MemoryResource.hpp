@@ -0,0 +1,400 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <new>
+#include <vector>
+#include "AlignedMemory.hpp"
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+/**
+ * Pluggable memory resources for matrix storage and kernel scratch.
+ *
+ * A Matrix keeps a pointer to the MemoryResource its buffer came from, so matrices from
+ * different resources mix freely without being different types. New matrices take their
+ * resource from DefaultResource(), which is per thread and can be switched for a scope with
+ * ScopedResource. Copies are new matrices too: they allocate from the copying thread's
+ * DefaultResource(), not from the resource of the matrix they copy. A copy is usually made
+ * to outlive its source or to hand it to other code, and the source's resource, such as an
+ * arena reset after every request, may not live that long; to copy into the same resource,
+ * switch to it with ScopedResource first.
+ * Kernel scratch comes from ScratchResource(), the per-thread pools by default.
+ * Very large matrices can be backed by huge pages through HugePageMemory().
+ */
+namespace MatrixKernels {
+
+/// Interface every allocator for matrix memory implements.
+class MemoryResource
+{
+public:
+    virtual ~MemoryResource() {}
+
+    /// Returns at least bytes of memory aligned to the given power of two. Throws std::bad_alloc on failure.
+    virtual void * Allocate(size_t bytes, size_t alignment = kMatrixAlignment) = 0;
+    /// Gives back memory from Allocate. bytes and alignment must match that call.
+    virtual void Deallocate(void * ptr, size_t bytes, size_t alignment = kMatrixAlignment) = 0;
+};
+
+/// Plain aligned heap allocation. Every call reaches the system allocator.
+class HeapResource : public MemoryResource
+{
+public:
+    void * Allocate(size_t bytes, size_t alignment = kMatrixAlignment) override {
+        return AlignedAllocate(bytes, alignment);
+    }
+    void Deallocate(void * ptr, size_t, size_t = kMatrixAlignment) override {
+        AlignedFree(ptr);
+    }
+};
+
+/// The process-wide heap resource.
+inline MemoryResource * HeapMemory() {
+    //Never destroyed, so matrices with static storage duration can still free into it.
+    static MemoryResource * heap = new HeapResource;
+    return heap;
+}
+
+/**
+ * Caches freed blocks by size class and hands them out again, so a steady stream of
+ * same-sized temporaries only reaches the upstream resource on the first round.
+ * Size classes are spaced four per power of two, so a block wastes at most a quarter of itself.
+ * Blocks above kPoolMaxBlock bytes or with alignment above kMatrixAlignment bypass the pool.
+ * Not thread safe; see PerThreadPool() for the shared version.
+ */
+class PoolResource : public MemoryResource
+{
+public:
+    /// Largest block, in bytes, that is kept for reuse.
+    static const size_t kPoolMaxBlock = size_t(64) << 20;
+
+    explicit PoolResource(MemoryResource * upstream = HeapMemory()) : m_upstream(upstream) {
+        std::fill(m_free, m_free + kClassCount, static_cast<FreeBlock *>(nullptr));
+    }
+    ~PoolResource() { Release(); }
+
+    void * Allocate(size_t bytes, size_t alignment = kMatrixAlignment) override {
+        if(bytes > kPoolMaxBlock || alignment > kMatrixAlignment)
+            return m_upstream->Allocate(bytes, alignment);
+
+        const size_t sizeClass = SizeClass(bytes);
+        if(FreeBlock * block = m_free[sizeClass]) {
+            m_free[sizeClass] = block->next;
+            return block;
+        }
+        return m_upstream->Allocate(ClassBytes(sizeClass), kMatrixAlignment);
+    }
+
+    void Deallocate(void * ptr, size_t bytes, size_t alignment = kMatrixAlignment) override {
+        if(ptr == nullptr)
+            return;
+        if(bytes > kPoolMaxBlock || alignment > kMatrixAlignment) {
+            m_upstream->Deallocate(ptr, bytes, alignment);
+            return;
+        }
+        //The free list lives inside the cached blocks themselves, so caching never allocates.
+        const size_t sizeClass = SizeClass(bytes);
+        FreeBlock * block = static_cast<FreeBlock *>(ptr);
+        block->next = m_free[sizeClass];
+        m_free[sizeClass] = block;
+    }
+
+    /// Returns every cached block to the upstream resource.
+    void Release() {
+        for(size_t c = 0; c < kClassCount; c++) {
+            while(FreeBlock * block = m_free[c]) {
+                m_free[c] = block->next;
+                m_upstream->Deallocate(block, ClassBytes(c), kMatrixAlignment);
+            }
+        }
+    }
+
+private:
+    PoolResource(const PoolResource &);
+    PoolResource & operator=(const PoolResource &);
+
+    struct FreeBlock { FreeBlock * next; };
+
+    /// The smallest class holds one cache line; four classes per doubling up to kPoolMaxBlock.
+    static const size_t kMinClassShift = 6;
+    static const size_t kClassCount = (26 - kMinClassShift) * 4 + 1;
+
+    static size_t SizeClass(size_t bytes) {
+        bytes = std::max(bytes, size_t(1) << kMinClassShift);
+        size_t shift = kMinClassShift;
+        while((size_t(2) << shift) <= bytes)
+            shift++;
+        //bytes is in [2^shift, 2^(shift + 1)); split that range into four classes.
+        const size_t step = (size_t(1) << shift) / 4;
+        const size_t quarters = (bytes + step - 1) / step - 4;
+        return (shift - kMinClassShift) * 4 + quarters;
+    }
+
+    static size_t ClassBytes(size_t sizeClass) {
+        const size_t shift = sizeClass / 4 + kMinClassShift;
+        return (size_t(1) << shift) + (sizeClass % 4) * ((size_t(1) << shift) / 4);
+    }
+
+    MemoryResource * m_upstream;
+    FreeBlock * m_free[kClassCount];
+};
+
+/**
+ * A PoolResource per thread behind one shared resource. Each call works on the calling
+ * thread's pool, so there is no locking. A block freed on another thread than the one
+ * that allocated it simply joins the freeing thread's pool.
+ */
+class ThreadPoolResource : public MemoryResource
+{
+public:
+    void * Allocate(size_t bytes, size_t alignment = kMatrixAlignment) override {
+        return LocalPool().Allocate(bytes, alignment);
+    }
+
+    void Deallocate(void * ptr, size_t bytes, size_t alignment = kMatrixAlignment) override {
+        //Memory freed while the thread is shutting down goes straight back to the heap.
+        if(PoolDestroyed())
+            HeapMemory()->Deallocate(ptr, bytes, alignment);
+        else
+            LocalPool().Deallocate(ptr, bytes, alignment);
+    }
+
+private:
+    struct LocalPoolHolder {
+        PoolResource pool;
+        ~LocalPoolHolder() { PoolDestroyed() = true; }
+    };
+
+    static PoolResource & LocalPool() {
+        static thread_local LocalPoolHolder holder;
+        return holder.pool;
+    }
+
+    static bool & PoolDestroyed() {
+        static thread_local bool destroyed = false;
+        return destroyed;
+    }
+};
+
+/// The process-wide set of per-thread pools. Safe to use from any thread.
+inline MemoryResource * PerThreadPool() {
+    static MemoryResource * pools = new ThreadPoolResource;
+    return pools;
+}
+
+/**
+ * Bump allocator for request-scoped temporaries. Allocation just advances a cursor through
+ * chunks obtained from the upstream resource, deallocation does nothing, and Reset() makes
+ * all the memory available again at once. Chunks are kept across resets, so a reused arena
+ * stops calling upstream once it has grown to the size of a request.
+ * Not thread safe: give each thread its own arena.
+ */
+class ArenaResource : public MemoryResource
+{
+public:
+    explicit ArenaResource(size_t chunkBytes = size_t(1) << 20, MemoryResource * upstream = HeapMemory())
+    : m_upstream(upstream), m_chunkBytes(chunkBytes), m_current(0), m_offset(0), m_used(0) {}
+    ~ArenaResource() {
+        for(auto & chunk : m_chunks)
+            m_upstream->Deallocate(chunk.data, chunk.bytes, kMatrixAlignment);
+    }
+
+    void * Allocate(size_t bytes, size_t alignment = kMatrixAlignment) override {
+        while(m_current < m_chunks.size()) {
+            Chunk & chunk = m_chunks[m_current];
+            const size_t start = (reinterpret_cast<uintptr_t>(chunk.data) + m_offset + alignment - 1) / alignment * alignment
+                               - reinterpret_cast<uintptr_t>(chunk.data);
+            if(start + bytes <= chunk.bytes) {
+                m_offset = start + bytes;
+                m_used += bytes;
+                return chunk.data + start;
+            }
+            m_current++;
+            m_offset = 0;
+        }
+
+        Chunk chunk;
+        chunk.bytes = std::max(m_chunkBytes, bytes + alignment);
+        chunk.data = static_cast<char *>(m_upstream->Allocate(chunk.bytes, kMatrixAlignment));
+        m_chunks.push_back(chunk);
+        m_current = m_chunks.size() - 1;
+        m_offset = 0;
+        return Allocate(bytes, alignment);
+    }
+
+    void Deallocate(void *, size_t, size_t = kMatrixAlignment) override {}
+
+    /// Makes every chunk available again. Everything allocated from the arena becomes invalid.
+    void Reset() {
+        m_current = 0;
+        m_offset = 0;
+        m_used = 0;
+    }
+
+    /// Bytes handed out since the last reset.
+    size_t BytesUsed() const { return m_used; }
+    /// Bytes obtained from the upstream resource.
+    size_t BytesReserved() const {
+        size_t total = 0;
+        for(auto & chunk : m_chunks)
+            total += chunk.bytes;
+        return total;
+    }
+
+private:
+    ArenaResource(const ArenaResource &);
+    ArenaResource & operator=(const ArenaResource &);
+
+    struct Chunk { char * data; size_t bytes; };
+
+    MemoryResource * m_upstream;
+    size_t m_chunkBytes;
+    std::vector<Chunk> m_chunks;
+    size_t m_current;
+    size_t m_offset;
+    size_t m_used;
+};
+
+/// Size of the huge pages requested by HugePageResource.
+const size_t kHugePageSize = size_t(2) << 20;
+
+enum class HugePageMode {
+    /// Ask for transparent huge pages with madvise(MADV_HUGEPAGE). The kernel may still use
+    /// small pages, e.g. when THP is disabled or memory is fragmented.
+    Transparent,
+    /// Map from the hugetlbfs pool (MAP_HUGETLB) first, falling back to Transparent when the
+    /// pool (vm.nr_hugepages) is empty or too small.
+    Explicit
+};
+
+/**
+ * Backs large buffers with 2 MB pages, so walking a multi-gigabyte matrix across its columns
+ * needs one TLB entry per 2 MB instead of per 4 KB. Buffers of at least threshold bytes
+ * are mapped directly, rounded up to whole huge pages and aligned to one; smaller requests
+ * go to the upstream resource. Without mmap (non-Linux builds) everything goes upstream.
+ * Thread safe.
+ */
+class HugePageResource : public MemoryResource
+{
+public:
+    explicit HugePageResource(HugePageMode mode = HugePageMode::Transparent, size_t threshold = kHugePageSize,
+                              MemoryResource * upstream = HeapMemory())
+    : m_mode(mode), m_threshold(threshold), m_upstream(upstream) {}
+
+    void * Allocate(size_t bytes, size_t alignment = kMatrixAlignment) override {
+#ifdef __linux__
+        if(bytes >= m_threshold && alignment <= kHugePageSize) {
+            const size_t mapped = RoundToHugePages(bytes);
+#ifdef MAP_HUGETLB
+            if(m_mode == HugePageMode::Explicit) {
+                void * ptr = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if(ptr != MAP_FAILED)
+                    return ptr;
+            }
+#endif
+            //Over-map by one huge page and trim, so the buffer starts on a huge page boundary.
+            void * raw = mmap(nullptr, mapped + kHugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if(raw == MAP_FAILED)
+                throw std::bad_alloc();
+            char * start = static_cast<char *>(raw);
+            char * aligned = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(start) + kHugePageSize - 1) / kHugePageSize * kHugePageSize);
+            if(aligned != start)
+                munmap(start, aligned - start);
+            if(aligned + mapped != start + mapped + kHugePageSize)
+                munmap(aligned + mapped, start + kHugePageSize - aligned);
+#ifdef MADV_HUGEPAGE
+            madvise(aligned, mapped, MADV_HUGEPAGE);
+#endif
+            return aligned;
+        }
+#endif
+        return m_upstream->Allocate(bytes, alignment);
+    }
+
+    void Deallocate(void * ptr, size_t bytes, size_t alignment = kMatrixAlignment) override {
+#ifdef __linux__
+        if(bytes >= m_threshold && alignment <= kHugePageSize) {
+            munmap(ptr, RoundToHugePages(bytes));
+            return;
+        }
+#endif
+        m_upstream->Deallocate(ptr, bytes, alignment);
+    }
+
+    HugePageMode Mode() const { return m_mode; }
+
+private:
+    static size_t RoundToHugePages(size_t bytes) {
+        return (bytes + kHugePageSize - 1) / kHugePageSize * kHugePageSize;
+    }
+
+    HugePageMode m_mode;
+    size_t m_threshold;
+    MemoryResource * m_upstream;
+};
+
+/// The process-wide transparent huge page resource.
+inline MemoryResource * HugePageMemory() {
+    static MemoryResource * hugePages = new HugePageResource;
+    return hugePages;
+}
+
+/// The resource new matrices on the calling thread allocate from when none is given.
+inline MemoryResource *& DefaultResource() {
+    static thread_local MemoryResource * resource = HeapMemory();
+    return resource;
+}
+
+/// The resource kernels take their scratch buffers from. Kernels allocate on OpenMP worker
+/// threads, so this has to be safe to use from any thread.
+inline MemoryResource *& ScratchResource() {
+    static MemoryResource * resource = PerThreadPool();
+    return resource;
+}
+
+/// Makes a resource the calling thread's DefaultResource() until the end of the scope.
+class ScopedResource
+{
+public:
+    explicit ScopedResource(MemoryResource * resource) : m_previous(DefaultResource()) {
+        DefaultResource() = resource;
+    }
+    ~ScopedResource() { DefaultResource() = m_previous; }
+
+private:
+    ScopedResource(const ScopedResource &);
+    ScopedResource & operator=(const ScopedResource &);
+
+    MemoryResource * m_previous;
+};
+
+/// Fixed-size, cache line aligned scratch memory for kernels. Elements are left uninitialized.
+template <class T>
+class AlignedBuffer
+{
+public:
+    explicit AlignedBuffer(size_t count = 0, MemoryResource * resource = ScratchResource())
+    : m_resource(resource), m_count(count),
+      m_data(count ? static_cast<T *>(resource->Allocate(count * sizeof(T))) : nullptr) {}
+    ~AlignedBuffer() {
+        if(m_data)
+            m_resource->Deallocate(m_data, m_count * sizeof(T));
+    }
+
+    T * data() { return m_data; }
+    const T * data() const { return m_data; }
+    T & operator[](size_t i) { return m_data[i]; }
+    const T & operator[](size_t i) const { return m_data[i]; }
+
+private:
+    AlignedBuffer(const AlignedBuffer &);
+    AlignedBuffer & operator=(const AlignedBuffer &);
+
+    MemoryResource * m_resource;
+    size_t m_count;
+    T * m_data;
+};
+
+} // namespace MatrixKernels
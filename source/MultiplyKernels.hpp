@@ -0,0 +1,234 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#ifdef USE_INTRINSICS
+#include "xmmintrin.h"
+#include "pmmintrin.h"
+#include "emmintrin.h"
+#endif
+#include "MemoryResource.hpp"
+#include "MatrixView.hpp"
+
+namespace MatrixKernels {
+
+/// Sum of x[k] * y[k] over both contiguous arrays.
+template <class T>
+inline T DotProduct(const T * x, const T * y, size_t length) {
+    T res = 0;
+    for(size_t k = 0; k < length; k++)
+        res += x[k] * y[k];
+    return res;
+}
+
+/// y[k] += a * x[k] over both contiguous arrays.
+template <class T>
+inline void Axpy(T a, const T * x, T * y, size_t length) {
+    for(size_t k = 0; k < length; k++)
+        y[k] += a * x[k];
+}
+
+#ifdef USE_INTRINSICS //Versions of the fn that use SSE intrinsics.
+
+/// Dot product in SSE registers. Aligned picks _mm_load_* over _mm_loadu_*.
+template <bool Aligned>
+inline float DotProductSSE(const float * x, const float * y, size_t length) {
+    __m128 sum = _mm_setzero_ps();
+    size_t k = 0;
+    for(; k + 3 < length; k += 4) {
+        __m128 xVec = Aligned ? _mm_load_ps(x + k) : _mm_loadu_ps(x + k);
+        __m128 yVec = Aligned ? _mm_load_ps(y + k) : _mm_loadu_ps(y + k);
+        sum = _mm_add_ps(sum, _mm_mul_ps(xVec, yVec));
+    }
+    //The _mm_hadd_ps only adds adjacent elements, so run twice to get
+    //full horizontal add.
+    sum = _mm_hadd_ps(sum, sum);
+    sum = _mm_hadd_ps(sum, sum);
+    float res;
+    _mm_store_ss(&res, sum);
+
+    //Process the remainder values using standard scalar arithmetic.
+    for(; k < length; k++)
+        res += x[k] * y[k];
+    return res;
+}
+
+template <bool Aligned>
+inline double DotProductSSE(const double * x, const double * y, size_t length) {
+    __m128d sum = _mm_setzero_pd();
+    size_t k = 0;
+    for(; k + 1 < length; k += 2) {
+        __m128d xVec = Aligned ? _mm_load_pd(x + k) : _mm_loadu_pd(x + k);
+        __m128d yVec = Aligned ? _mm_load_pd(y + k) : _mm_loadu_pd(y + k);
+        sum = _mm_add_pd(sum, _mm_mul_pd(xVec, yVec));
+    }
+    sum = _mm_hadd_pd(sum, sum);
+    double res;
+    _mm_store_sd(&res, sum);
+
+    for(; k < length; k++)
+        res += x[k] * y[k];
+    return res;
+}
+
+//Matrix columns and kernel scratch start on register boundaries, so the aligned
+//loads are the common case; views into the middle of a matrix may not be.
+inline float DotProduct(const float * x, const float * y, size_t length) {
+    if(IsAligned(x, 16) && IsAligned(y, 16))
+        return DotProductSSE<true>(x, y, length);
+    return DotProductSSE<false>(x, y, length);
+}
+
+inline double DotProduct(const double * x, const double * y, size_t length) {
+    if(IsAligned(x, 16) && IsAligned(y, 16))
+        return DotProductSSE<true>(x, y, length);
+    return DotProductSSE<false>(x, y, length);
+}
+
+inline void Axpy(float a, const float * x, float * y, size_t length) {
+    const __m128 aVec = _mm_set1_ps(a);
+    const size_t vectorEnd = length & ~size_t(3);
+    size_t k = 0;
+    for(; k < vectorEnd; k += 4)
+        _mm_storeu_ps(y + k, _mm_add_ps(_mm_loadu_ps(y + k), _mm_mul_ps(aVec, _mm_loadu_ps(x + k))));
+    for(; k < length; k++)
+        y[k] += a * x[k];
+}
+
+inline void Axpy(double a, const double * x, double * y, size_t length) {
+    const __m128d aVec = _mm_set1_pd(a);
+    const size_t vectorEnd = length & ~size_t(1);
+    size_t k = 0;
+    for(; k < vectorEnd; k += 2)
+        _mm_storeu_pd(y + k, _mm_add_pd(_mm_loadu_pd(y + k), _mm_mul_pd(aVec, _mm_loadu_pd(x + k))));
+    for(; k < length; k++)
+        y[k] += a * x[k];
+}
+
+//Unfortunately, Intel SSE intrinsics for integer multiplication & addition
+//are not as robust as floating point. Given time, I believe there is a way
+//to write an vector SIMD implementation for integer matrices that is faster
+//than scalar arithmetic, but it isn't trivial, so I've tabled that for later.
+
+#endif
+
+/// Below this many multiply-adds the whole product runs on the calling thread.
+const size_t kMultiplyParallelThreshold = 32 * 32 * 32;
+
+/**
+ * C = A * B as dot products. Each element of C is the dot product of a row of A and a column
+ * of B, so both need to be contiguous. Rows of A are already contiguous when A is row-major
+ * or a transposed view; otherwise each row is gathered once per output row. Columns of B
+ * are packed once up front if needed.
+ */
+template <class T>
+void MultiplyDot(const MatrixView<const T> & A, const MatrixView<const T> & B, const MatrixView<T> & C) {
+    const size_t m = A.Rows();
+    const size_t k = A.Columns();
+    const size_t n = B.Columns();
+
+    //Packed columns are padded to whole SIMD registers so they all start aligned.
+    const size_t perRegister = (kColumnAlignment % sizeof(T) == 0) ? kColumnAlignment / sizeof(T) : 1;
+    const bool packB = B.RowStride() != 1;
+    const size_t packedLd = (k + perRegister - 1) / perRegister * perRegister;
+    AlignedBuffer<T> packedB(packB ? packedLd * n : 0);
+    const T * bData = B.Data();
+    size_t ldb = B.ColumnStride();
+    if(packB) {
+        CopyToColumnMajor(B, packedB.data(), packedLd);
+        bData = packedB.data();
+        ldb = packedLd;
+    }
+
+    const bool rowsContiguous = A.ColumnStride() == 1;
+    auto multiplyRow = [&](size_t i, T * rowData) {
+        const T * rowA = A.Data() + i * A.RowStride();
+        if(!rowsContiguous) {
+            //Copy the row elements into a contiguous array.
+            for(size_t h = 0; h < k; h++)
+                rowData[h] = rowA[h * A.ColumnStride()];
+            rowA = rowData;
+        }
+
+        T * rowC = C.Data() + i * C.RowStride();
+        for (size_t j = 0; j < n; j++)
+            rowC[j * C.ColumnStride()] = DotProduct(rowA, bData + j * ldb, k);
+    };
+
+    //Even a serialized parallel region costs more than a tiny product, so skip it entirely.
+    if(m * n * k < kMultiplyParallelThreshold) {
+        AlignedBuffer<T> rowData(rowsContiguous ? 0 : k);
+        for (size_t i = 0; i < m; i++)
+            multiplyRow(i, rowData.data());
+        return;
+    }
+
+    #pragma omp parallel
+    {
+        AlignedBuffer<T> rowData(rowsContiguous ? 0 : k);
+
+        #pragma omp for
+        for (size_t i = 0; i < m; i++)
+            multiplyRow(i, rowData.data());
+    }
+}
+
+/// Columns of C computed together by MultiplyAxpy, so each column of A is reused from cache.
+const size_t kAxpyColumnBlock = 8;
+
+/**
+ * C = A * B as sums of scaled columns: column j of C is the sum over p of B(p, j) times
+ * column p of A. Needs contiguous columns of A and C and nothing of B, so column-major
+ * operands multiply without gathering any rows.
+ */
+template <class T>
+void MultiplyAxpy(const MatrixView<const T> & A, const MatrixView<const T> & B, const MatrixView<T> & C) {
+    const size_t m = A.Rows();
+    const size_t k = A.Columns();
+    const size_t n = B.Columns();
+    const size_t blocks = (n + kAxpyColumnBlock - 1) / kAxpyColumnBlock;
+
+    auto multiplyBlock = [&](size_t block) {
+        const size_t j0 = block * kAxpyColumnBlock;
+        const size_t j1 = std::min(n, j0 + kAxpyColumnBlock);
+        for(size_t j = j0; j < j1; j++)
+            std::fill(C.Data() + j * C.ColumnStride(), C.Data() + j * C.ColumnStride() + m, T(0));
+        for(size_t p = 0; p < k; p++) {
+            const T * colA = A.Data() + p * A.ColumnStride();
+            for(size_t j = j0; j < j1; j++)
+                Axpy(B.Data()[p * B.RowStride() + j * B.ColumnStride()], colA, C.Data() + j * C.ColumnStride(), m);
+        }
+    };
+
+    if(m * n * k < kMultiplyParallelThreshold) {
+        for(size_t block = 0; block < blocks; block++)
+            multiplyBlock(block);
+        return;
+    }
+
+    #pragma omp parallel for
+    for(size_t block = 0; block < blocks; block++)
+        multiplyBlock(block);
+}
+
+/**
+ * C = A * B for any combination of views, using whichever kernel needs no repacking
+ * for the storage orders at hand:
+ *  - row-major A times column-major B: dot products of rows and columns.
+ *  - column-major A and C: scaled columns of A (MultiplyAxpy).
+ *  - row-major B and C: scaled rows of B, i.e. MultiplyAxpy on C^T = B^T * A^T.
+ *  - anything else: dot products after gathering rows of A and packing B.
+ */
+template <class T>
+void Multiply(const MatrixView<const T> & A, const MatrixView<const T> & B, const MatrixView<T> & C) {
+    if(A.ColumnStride() == 1 && B.RowStride() == 1)
+        MultiplyDot(A, B, C);
+    else if(A.RowStride() == 1 && C.RowStride() == 1)
+        MultiplyAxpy(A, B, C);
+    else if(B.ColumnStride() == 1 && C.ColumnStride() == 1)
+        MultiplyAxpy(B.Transpose(), A.Transpose(), C.Transpose());
+    else
+        MultiplyDot(A, B, C);
+}
+
+} // namespace MatrixKernels
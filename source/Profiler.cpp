@@ -1,7 +1,16 @@
 #include <iostream>
 #include <utility>
 #include <chrono>
+#include <cstring>
+#include <numeric>
 #include "Matrix.hpp"
+#include "DualMatrix.hpp"
+#include "TiledMatrix.hpp"
+#include "MatrixReductions.hpp"
+#include "MatrixMath.hpp"
+#include "MatrixScans.hpp"
+#include "MatrixPermutations.hpp"
+#include "MatrixConcatenation.hpp"
 #include "Rand.hpp"
 
 using namespace std;
@@ -19,6 +28,50 @@ template <class T>
 void profileMatrixMultiplication();
 template<class T>
 void profileMatrixTranspose();
+template<class T>
+void profileLargeTranspose();
+template<class T>
+void profileTransposeViewMultiplication();
+template<class T>
+void profileBatchTranspose();
+template<class T>
+void profileLeadingDimension();
+template<class T>
+void profileMemoryResources();
+template<class T>
+void profileConstruction();
+template<class T>
+void profileHugePages();
+template<class T>
+void profileSmallMatrices();
+template<class T>
+void profileStorageOrders();
+template<class T>
+void profileTiledStorage();
+template<class T>
+void profileSubMatrixViews();
+template<class T>
+void profileCopyOnWrite();
+template<class T>
+void profileExternalStorage();
+template<class T>
+void profileBoundsChecking();
+template<class T>
+void profileIterators();
+template<class T>
+void profileExpressionTemplates();
+template<class T>
+void profileElementwiseOperations();
+template<class T>
+void profileReductions();
+template<class T>
+void profileTranscendentals();
+template<class T>
+void profileScans();
+template<class T>
+void profileGatherScatter();
+template<class T>
+void profileConcatenation();
 
 int main() {
     std::fill(sectionBreak, sectionBreak + 79, '=');
@@ -27,9 +80,10 @@ int main() {
 
 
 	cout << "This program measures the execution time of my Matrix class." << endl;
-    cout << "All matrices in this suite are 100x100" << endl;
+    cout << "The multiplication, transpose and A^T * B benchmarks use 100x100 matrices." << endl;
     cout << "For each data type, the op is run " << iterations;
     cout << " times and the average run time is calculated." << endl;
+    cout << "The other benchmarks print their own sizes and run counts with their results." << endl;
 	cout << sectionBreak;
     
     cout << "Profiling FLOAT matrix multiplication" << endl;
@@ -81,6 +135,214 @@ int main() {
     cout << "Profiling LONG matrix transpose" << endl;
     profileMatrixTranspose<long>();
     cout << sectionBreak;
+
+    //------------------------------------------------
+
+    cout << "Profiling large FLOAT matrix transpose against memcpy" << endl;
+    profileLargeTranspose<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling large DOUBLE matrix transpose against memcpy" << endl;
+    profileLargeTranspose<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling large SHORT matrix transpose against memcpy" << endl;
+    profileLargeTranspose<short>();
+    cout << sectionBreak;
+
+    //------------------------------------------------
+
+    cout << "Profiling FLOAT A^T * B, eager transpose against a lazy view" << endl;
+    profileTransposeViewMultiplication<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling DOUBLE A^T * B, eager transpose against a lazy view" << endl;
+    profileTransposeViewMultiplication<double>();
+    cout << sectionBreak;
+
+    //------------------------------------------------
+
+    cout << "Profiling batched transpose of small FLOAT matrices" << endl;
+    profileBatchTranspose<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling batched transpose of small DOUBLE matrices" << endl;
+    profileBatchTranspose<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling batched transpose of small SHORT matrices" << endl;
+    profileBatchTranspose<short>();
+    cout << sectionBreak;
+
+    //------------------------------------------------
+
+    cout << "Profiling power-of-two FLOAT matrices against nearby sizes, with and without padding" << endl;
+    profileLeadingDimension<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling power-of-two DOUBLE matrices against nearby sizes, with and without padding" << endl;
+    profileLeadingDimension<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling request-scoped temporaries of small FLOAT matrices from the heap, pools and an arena" << endl;
+    profileMemoryResources<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling request-scoped temporaries of small DOUBLE matrices from the heap, pools and an arena" << endl;
+    profileMemoryResources<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling filled, uninitialized & copy construction of large FLOAT matrices" << endl;
+    profileConstruction<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling filled, uninitialized & copy construction of large DOUBLE matrices" << endl;
+    profileConstruction<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling TLB-bound walks over 4096x4096 FLOAT matrices with and without huge pages" << endl;
+    profileHugePages<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling TLB-bound walks over 4096x4096 DOUBLE matrices with and without huge pages" << endl;
+    profileHugePages<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling Kalman covariance updates on tiny FLOAT matrices" << endl;
+    profileSmallMatrices<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling Kalman covariance updates on tiny DOUBLE matrices" << endl;
+    profileSmallMatrices<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling FLOAT products for each combination of storage orders" << endl;
+    profileStorageOrders<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling DOUBLE products for each combination of storage orders" << endl;
+    profileStorageOrders<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling FLOAT products & transposes in tiled and Z-order storage" << endl;
+    profileTiledStorage<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling DOUBLE products & transposes in tiled and Z-order storage" << endl;
+    profileTiledStorage<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling a blocked FLOAT product on copied blocks against block views" << endl;
+    profileSubMatrixViews<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling a blocked DOUBLE product on copied blocks against block views" << endl;
+    profileSubMatrixViews<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling fan-out of a large FLOAT matrix by deep copy against copy-on-write" << endl;
+    profileCopyOnWrite<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling fan-out of a large DOUBLE matrix by deep copy against copy-on-write" << endl;
+    profileCopyOnWrite<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling use of an external FLOAT frame by copying against wrapping it" << endl;
+    profileExternalStorage<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling use of an external DOUBLE frame by copying against wrapping it" << endl;
+    profileExternalStorage<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling a user-written loop over a FLOAT matrix with checked & unchecked access" << endl;
+    profileBoundsChecking<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling a user-written loop over a DOUBLE matrix with checked & unchecked access" << endl;
+    profileBoundsChecking<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling sums over a padded FLOAT matrix by operator(), iterators & data()" << endl;
+    profileIterators<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling sums over a padded DOUBLE matrix by operator(), iterators & data()" << endl;
+    profileIterators<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling D = A + B * 2 - C on FLOAT matrices with temporaries, a loop & a fused expression" << endl;
+    profileExpressionTemplates<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling D = A + B * 2 - C on DOUBLE matrices with temporaries, a loop & a fused expression" << endl;
+    profileExpressionTemplates<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling Clamp(A * B + bias row) on FLOAT matrices with a loop & an expression" << endl;
+    profileElementwiseOperations<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling Clamp(A * B + bias row) on DOUBLE matrices with a loop & an expression" << endl;
+    profileElementwiseOperations<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling Clamp(A * B + bias row) on INT matrices with a loop & an expression" << endl;
+    profileElementwiseOperations<int>();
+    cout << sectionBreak;
+
+    cout << "Profiling Clamp(A * B + bias row) on SHORT matrices with a loop & an expression" << endl;
+    profileElementwiseOperations<short>();
+    cout << sectionBreak;
+
+    cout << "Profiling sums of a FLOAT matrix by loops & by reductions" << endl;
+    profileReductions<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling sums of a DOUBLE matrix by loops & by reductions" << endl;
+    profileReductions<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling sums of a INT matrix by loops & by reductions" << endl;
+    profileReductions<int>();
+    cout << sectionBreak;
+
+    cout << "Profiling exp and sigmoid of FLOAT matrices" << endl;
+    profileTranscendentals<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling exp and sigmoid of DOUBLE matrices" << endl;
+    profileTranscendentals<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling scans of FLOAT matrices" << endl;
+    profileScans<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling scans of DOUBLE matrices" << endl;
+    profileScans<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling scans of INT matrices" << endl;
+    profileScans<int>();
+    cout << sectionBreak;
+
+    cout << "Profiling gathers and permutations of FLOAT matrices" << endl;
+    profileGatherScatter<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling gathers and permutations of DOUBLE matrices" << endl;
+    profileGatherScatter<double>();
+    cout << sectionBreak;
+
+    cout << "Profiling stacking and splitting of FLOAT matrices" << endl;
+    profileConcatenation<float>();
+    cout << sectionBreak;
+
+    cout << "Profiling stacking and splitting of DOUBLE matrices" << endl;
+    profileConcatenation<double>();
+    cout << sectionBreak;
     
     
 	return 0;
@@ -123,6 +385,694 @@ void profileMatrixTranspose() {
 		<< " ms" << endl;
 }
 
+template <class T>
+void profileLargeTranspose() {
+    const size_t size = 2048;
+    const int largeIterations = 10;
+    Matrix<T> A(size, size, 1);
+    std::vector<T> copySrc(size * size, 1), copyDst(size * size);
+
+    Clock::duration transposeTotal(0), copyTotal(0);
+    for (int i = 0; i < largeIterations; i++) {
+        auto begin = Clock::now();
+        auto B = A.Transpose();
+        auto end = Clock::now();
+        transposeTotal += (end - begin);
+
+        begin = Clock::now();
+        std::memcpy(copyDst.data(), copySrc.data(), size * size * sizeof(T));
+        end = Clock::now();
+        copyTotal += (end - begin);
+    }
+
+    //Bytes read plus bytes written, per second.
+    const double bytes = 2.0 * size * size * sizeof(T) * largeIterations;
+    const double transposeSeconds = chrono::duration_cast<chrono::duration<double>>(transposeTotal).count();
+    const double copySeconds = chrono::duration_cast<chrono::duration<double>>(copyTotal).count();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", averaged over " << largeIterations << " runs" << endl;
+    cout << "Transpose bandwidth: " << bytes / transposeSeconds / 1e9 << " GB/s" << endl;
+    cout << "memcpy bandwidth:    " << bytes / copySeconds / 1e9 << " GB/s" << endl;
+}
+
+template <class T>
+void profileTransposeViewMultiplication() {
+    Clock::duration eagerTotal(0), viewTotal(0);
+    for (int i = 0; i < iterations; i++) {
+        auto A = generateMatrix<T>();
+        auto B = generateMatrix<T>();
+
+        auto begin = Clock::now();
+        A.Transpose() * B;
+        auto end = Clock::now();
+        eagerTotal += (end - begin);
+
+        begin = Clock::now();
+        A.TransposeView() * B;
+        end = Clock::now();
+        viewTotal += (end - begin);
+    }
+
+    cout << endl;
+    cout << "On average, A.Transpose() * B takes "
+        << chrono::duration_cast<chrono::microseconds>(eagerTotal).count() / (1000.f * (float)iterations)
+        << " ms" << endl;
+    cout << "On average, A.TransposeView() * B takes "
+        << chrono::duration_cast<chrono::microseconds>(viewTotal).count() / (1000.f * (float)iterations)
+        << " ms" << endl;
+}
+
+template <class T>
+void profileBatchTranspose() {
+    //Every batch holds the same number of elements, whatever the matrix size.
+    const size_t elementsPerBatch = 1 << 20;
+    const int batchIterations = 20;
+    const size_t sizes[] = { 4, 8, 16, 32 };
+
+    cout << endl;
+    for(size_t size : sizes) {
+        const size_t count = elementsPerBatch / (size * size);
+        std::vector<T> src(elementsPerBatch, 1), dst(elementsPerBatch);
+
+        Clock::duration batchTotal(0);
+        for (int i = 0; i < batchIterations; i++) {
+            auto begin = Clock::now();
+            MatrixKernels::BatchTranspose(src.data(), dst.data(), count, size, size);
+            auto end = Clock::now();
+            batchTotal += (end - begin);
+        }
+
+        //The same work one Matrix at a time, for comparison.
+        std::vector<Matrix<T>> matrices(count, Matrix<T>(size, size, 1));
+        Clock::duration singleTotal(0);
+        for (int i = 0; i < batchIterations; i++) {
+            auto begin = Clock::now();
+            for(auto & m : matrices)
+                m.Transpose();
+            auto end = Clock::now();
+            singleTotal += (end - begin);
+        }
+
+        const double transposed = double(count) * batchIterations;
+        cout << size << 'x' << size << ": "
+            << transposed / chrono::duration_cast<chrono::duration<double>>(batchTotal).count() / 1e6
+            << " million matrices/s batched, "
+            << transposed / chrono::duration_cast<chrono::duration<double>>(singleTotal).count() / 1e6
+            << " million matrices/s with Matrix::Transpose()" << endl;
+    }
+}
+
+template <class T>
+void profileLeadingDimension() {
+    //Both operations walk along rows, stepping a whole column at a time, which is where
+    //power-of-two column strides pile up in a handful of cache sets.
+    const size_t sizes[] = { 1000, 1024, 2000, 2048 };
+    const int strideIterations = 3;
+    bool & pad = MatrixKernels::PadLeadingDimension();
+
+    cout << endl;
+    for(size_t size : sizes) {
+        for(int padded = 0; padded < 2; padded++) {
+            pad = padded != 0;
+            Matrix<T> A(size, size, 1);
+            Matrix<T> B(size, 16, 1);
+
+            Clock::duration multiplyTotal(0), transposeTotal(0);
+            for (int i = 0; i < strideIterations; i++) {
+                auto begin = Clock::now();
+                A * B;
+                auto end = Clock::now();
+                multiplyTotal += (end - begin);
+
+                begin = Clock::now();
+                A.Transpose();
+                end = Clock::now();
+                transposeTotal += (end - begin);
+            }
+
+            cout << size << 'x' << size << (padded ? " padded  " : " packed  ")
+                << "(leading dimension " << A.LeadingDimension() << "): "
+                << "A * B[" << size << "x16] "
+                << chrono::duration_cast<chrono::microseconds>(multiplyTotal).count() / (1000.f * strideIterations)
+                << " ms, transpose "
+                << chrono::duration_cast<chrono::microseconds>(transposeTotal).count() / (1000.f * strideIterations)
+                << " ms" << endl;
+        }
+    }
+    pad = true;
+}
+
+template <class T>
+void profileMemoryResources() {
+    //Each request makes a handful of small temporaries, where allocation is a large share of the work.
+    const size_t size = 16;
+    const int requests = 20000;
+    Matrix<T> A(size, size, 1), B(size, size, 2);
+    MatrixKernels::ArenaResource arena;
+    const char * names[] = { "heap           ", "per-thread pool", "arena          " };
+    MatrixKernels::MemoryResource * resources[] = { MatrixKernels::HeapMemory(), MatrixKernels::PerThreadPool(), &arena };
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", averaged over " << requests << " requests" << endl;
+    for(int r = 0; r < 3; r++) {
+        auto begin = Clock::now();
+        for (int i = 0; i < requests; i++) {
+            MatrixKernels::ScopedResource scope(resources[r]);
+            Matrix<T> C = A * B;
+            Matrix<T> D = C.Transpose() * A;
+            D.TransposeInPlace();
+            arena.Reset();
+        }
+        auto end = Clock::now();
+        cout << names[r] << ": "
+            << chrono::duration_cast<chrono::nanoseconds>(end - begin).count() / (1000.f * requests)
+            << " us per request" << endl;
+    }
+}
+
+template <class T>
+void profileConstruction() {
+    const size_t size = 2048;
+    const int constructIterations = 10;
+    Matrix<T> source(size, size, 1);
+
+    Clock::duration filledTotal(0), uninitializedTotal(0), copyTotal(0);
+    for (int i = 0; i < constructIterations; i++) {
+        auto begin = Clock::now();
+        Matrix<T> filled(size, size, 0);
+        auto end = Clock::now();
+        filledTotal += (end - begin);
+
+        begin = Clock::now();
+        Matrix<T> uninitialized(size, size, Uninitialized);
+        end = Clock::now();
+        uninitializedTotal += (end - begin);
+
+        begin = Clock::now();
+        Matrix<T> copy(source);
+        end = Clock::now();
+        copyTotal += (end - begin);
+    }
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", averaged over " << constructIterations << " runs" << endl;
+    cout << "Filled:        " << chrono::duration_cast<chrono::microseconds>(filledTotal).count() / (1000.f * constructIterations) << " ms" << endl;
+    cout << "Uninitialized: " << chrono::duration_cast<chrono::microseconds>(uninitializedTotal).count() / (1000.f * constructIterations) << " ms" << endl;
+    cout << "Copy:          " << chrono::duration_cast<chrono::microseconds>(copyTotal).count() / (1000.f * constructIterations) << " ms" << endl;
+}
+
+template <class T>
+void profileHugePages() {
+    //Both operations step a whole column at a time along rows, touching a new 4 KB page on
+    //almost every access, so with small pages nearly every load misses the TLB.
+    const size_t size = 4096;
+    const int hugeIterations = 3;
+    const char * names[] = { "4 KB pages", "2 MB pages" };
+    MatrixKernels::MemoryResource * resources[] = { MatrixKernels::HeapMemory(), MatrixKernels::HugePageMemory() };
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", averaged over " << hugeIterations << " runs" << endl;
+    for(int r = 0; r < 2; r++) {
+        MatrixKernels::ScopedResource scope(resources[r]);
+        Matrix<T> A(size, size, 1);
+        Matrix<T> B(size, 16, 1);
+        Matrix<T> AT(size, size, Uninitialized);
+
+        Clock::duration multiplyTotal(0), transposeTotal(0);
+        for (int i = 0; i < hugeIterations; i++) {
+            auto begin = Clock::now();
+            A * B;
+            auto end = Clock::now();
+            multiplyTotal += (end - begin);
+
+            begin = Clock::now();
+            A.TransposeInto(AT);
+            end = Clock::now();
+            transposeTotal += (end - begin);
+        }
+
+        cout << names[r] << ": A * B[" << size << "x16] "
+            << chrono::duration_cast<chrono::microseconds>(multiplyTotal).count() / (1000.f * hugeIterations)
+            << " ms, transpose "
+            << chrono::duration_cast<chrono::microseconds>(transposeTotal).count() / (1000.f * hugeIterations)
+            << " ms" << endl;
+    }
+}
+
+template <class T>
+void profileSmallMatrices() {
+    //The covariance prediction of a Kalman filter, P = F * P * F^T + Q, makes several
+    //short-lived temporaries per step.
+    const int steps = 100000;
+    const size_t sizes[] = { 2, 4, 6 };
+
+    cout << endl;
+    for(size_t size : sizes) {
+        Matrix<T> F(size, size, 1), P(size, size, 1), Q(size, size, 0);
+        auto begin = Clock::now();
+        for (int i = 0; i < steps; i++) {
+            Matrix<T> FP = F * P;
+            P = FP * F.TransposeView();
+            P(0, 0) += Q(0, 0);
+        }
+        auto end = Clock::now();
+        cout << size << 'x' << size << ": "
+            << chrono::duration_cast<chrono::nanoseconds>(end - begin).count() / (1000.f * steps)
+            << " us per step" << endl;
+    }
+}
+
+template <class T>
+void profileStorageOrders() {
+    const size_t size = 300;
+    const int orderIterations = 3;
+    Matrix<T, ColumnMajor> A(size, size, 1), B(size, size, 2);
+    Matrix<T, RowMajor> ARow(A.View()), BRow(B.View());
+    DualMatrix<T> ADual(A), BDual(B);
+
+    Clock::duration totals[5] = {};
+    for (int i = 0; i < orderIterations; i++) {
+        auto t0 = Clock::now();
+        A * B;
+        auto t1 = Clock::now();
+        ARow * B;
+        auto t2 = Clock::now();
+        A * BRow;
+        auto t3 = Clock::now();
+        ARow * BRow;
+        auto t4 = Clock::now();
+        ADual * BDual;
+        auto t5 = Clock::now();
+        totals[0] += t1 - t0; totals[1] += t2 - t1; totals[2] += t3 - t2; totals[3] += t4 - t3; totals[4] += t5 - t4;
+    }
+
+    const char * names[] = { "column * column", "row    * column", "column * row   ", "row    * row   ", "dual   * dual  " };
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", averaged over " << orderIterations << " runs" << endl;
+    for(int c = 0; c < 5; c++)
+        cout << names[c] << ": " << chrono::duration_cast<chrono::microseconds>(totals[c]).count() / (1000.f * orderIterations) << " ms" << endl;
+}
+
+template <class T>
+void profileTiledStorage() {
+    const size_t size = 512;
+    const int tiledIterations = 3;
+    Matrix<T> A(size, size, 1), B(size, size, 2);
+    TiledMatrix<T> ATiled(A.View(), TileOrder::RowMajor), BTiled(B.View(), TileOrder::RowMajor);
+    TiledMatrix<T> AMorton(A.View()), BMorton(B.View());
+
+    Clock::duration totals[6] = {};
+    for (int i = 0; i < tiledIterations; i++) {
+        auto t0 = Clock::now();
+        A * B;
+        auto t1 = Clock::now();
+        ATiled * BTiled;
+        auto t2 = Clock::now();
+        AMorton * BMorton;
+        auto t3 = Clock::now();
+        A.Transpose();
+        auto t4 = Clock::now();
+        ATiled.Transpose();
+        auto t5 = Clock::now();
+        AMorton.Transpose();
+        auto t6 = Clock::now();
+        totals[0] += t1 - t0; totals[1] += t2 - t1; totals[2] += t3 - t2;
+        totals[3] += t4 - t3; totals[4] += t5 - t4; totals[5] += t6 - t5;
+    }
+
+    const char * names[] = { "multiply, standard  ", "multiply, row tiles ", "multiply, Z-order   ",
+                             "transpose, standard ", "transpose, row tiles", "transpose, Z-order  " };
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", averaged over " << tiledIterations << " runs" << endl;
+    for(int c = 0; c < 6; c++)
+        cout << names[c] << ": " << chrono::duration_cast<chrono::microseconds>(totals[c]).count() / (1000.f * tiledIterations) << " ms" << endl;
+}
+
+template <class T>
+void profileSubMatrixViews() {
+    const size_t size = 512, half = size / 2;
+    const int viewIterations = 3;
+    Matrix<T> A(size, size, 1), B(size, size, 2), C(size, size, Uninitialized);
+
+    Clock::duration copied(0), viewed(0);
+    for (int i = 0; i < viewIterations; i++) {
+        //Each quadrant of C as a separate task: copying its operands out and the result back in...
+        auto t0 = Clock::now();
+        for(size_t bi = 0; bi < size; bi += half) {
+            for(size_t bj = 0; bj < size; bj += half) {
+                Matrix<T> rows = A.RowRange(bi, half).Materialize(), cols = B.ColumnRange(bj, half).Materialize();
+                C.Block(bi, bj, half, half).Assign((rows * cols).View());
+            }
+        }
+        //...or reading and writing the blocks where they are.
+        auto t1 = Clock::now();
+        for(size_t bi = 0; bi < size; bi += half)
+            for(size_t bj = 0; bj < size; bj += half)
+                Multiply(A.RowRange(bi, half), B.ColumnRange(bj, half), C.Block(bi, bj, half, half));
+        auto t2 = Clock::now();
+        copied += t1 - t0;
+        viewed += t2 - t1;
+    }
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << ", split in " << half << 'x' << half << " blocks, averaged over " << viewIterations << " runs" << endl;
+    cout << "Copied blocks: " << chrono::duration_cast<chrono::microseconds>(copied).count() / (1000.f * viewIterations) << " ms" << endl;
+    cout << "Block views:   " << chrono::duration_cast<chrono::microseconds>(viewed).count() / (1000.f * viewIterations) << " ms" << endl;
+}
+
+template <class T>
+void profileCopyOnWrite() {
+    const size_t size = 2048;
+    const int stages = 8;
+    Matrix<T> source(size, size, 1);
+    Matrix<T> shared(source);
+    shared.EnableCopyOnWrite();
+
+    //Fan a matrix out to stages that only read it, by value.
+    T sum = 0;
+    auto t0 = Clock::now();
+    for(int s = 0; s < stages; s++) {
+        const Matrix<T> stage(source);
+        sum += stage(s, s);
+    }
+    auto t1 = Clock::now();
+    for(int s = 0; s < stages; s++) {
+        const Matrix<T> stage(shared);
+        sum += stage(s, s);
+    }
+    auto t2 = Clock::now();
+    //One stage that does write pays for a single copy.
+    Matrix<T> writer(shared);
+    writer(0, 0) = sum;
+    auto t3 = Clock::now();
+
+    cout << endl;
+    cout << "Matrix is " << size << 'x' << size << ", copied to " << stages << " reading stages" << endl;
+    cout << "Deep copies:          " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Copy-on-write copies: " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "First write to a copy-on-write copy: " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileExternalStorage() {
+    const size_t size = 2048;
+    std::vector<T> frame(size * size, T(1));
+
+    //A frame received from elsewhere: copied in element by element, as a block, or wrapped.
+    auto t0 = Clock::now();
+    Matrix<T> elementwise(size, size, Uninitialized);
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            elementwise(i, j) = frame[i + j * size];
+    auto t1 = Clock::now();
+    Matrix<T> copied(MatrixView<const T>(frame.data(), size, size, 1, size));
+    auto t2 = Clock::now();
+    Matrix<T> wrapped(frame.data(), size, size, size);
+    auto t3 = Clock::now();
+
+    cout << endl;
+    cout << "Frame is " << size << 'x' << size << endl;
+    cout << "Copied element by element: " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Copied from a view:        " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Wrapped in place:          " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileBoundsChecking() {
+    const size_t size = 2048;
+    Matrix<T> A(size, size, 1);
+
+    //A user-written element loop: a checked access may throw on every element, so the
+    //compiler can't vectorize it; the unchecked one is a plain strided load and store.
+    auto t0 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            A.Get(i, j) = A.Get(i, j) * T(3) + T(1);
+    auto t1 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            A.GetUnchecked(i, j) = A.GetUnchecked(i, j) * T(3) + T(1);
+    auto t2 = Clock::now();
+    const MatrixView<T> view = A.View();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            view.GetUnchecked(i, j) = view.GetUnchecked(i, j) * T(3) + T(1);
+    auto t3 = Clock::now();
+
+    cout << endl;
+    cout << "Matrix is " << size << 'x' << size << ", operator() is " << (BoundsChecking<T>::value ? "checked" : "unchecked") << endl;
+    cout << "Get():                 " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "GetUnchecked():        " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "View().GetUnchecked(): " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileIterators() {
+    const size_t size = 2050; //Not a multiple of the register width, so the lines are padded.
+    Matrix<T> A(size, size, 1);
+    const Matrix<T> & constA = A;
+
+    //Summing with a user-written loop over operator(), an STL algorithm over the element
+    //iterators, and a loop over the contiguous lines from data().
+    T sums[3] = {};
+    auto t0 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            sums[0] += constA(i, j);
+    auto t1 = Clock::now();
+    sums[1] = std::accumulate(constA.begin(), constA.end(), T(0));
+    auto t2 = Clock::now();
+    for(size_t j = 0; j < size; j++) {
+        const T * column = constA.data() + j * constA.LeadingDimension();
+        sums[2] = std::accumulate(column, column + size, sums[2]);
+    }
+    auto t3 = Clock::now();
+
+    cout << endl;
+    cout << "Matrix is " << size << 'x' << size << " (sums " << sums[0] << ", " << sums[1] << ", " << sums[2] << ")" << endl;
+    cout << "operator() loop:           " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "std::accumulate, iterators: " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "std::accumulate per line:   " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileExpressionTemplates() {
+    const size_t size = 4096;
+    const Matrix<T> A(size, size, 1), B(size, size, 2), C(size, size, 3);
+    Matrix<T> D(size, size, 0);
+
+    //D = A + B * 2 - C evaluated one operation at a time through temporaries, as a
+    //hand-written loop, and as one fused expression.
+    auto t0 = Clock::now();
+    {
+        const Matrix<T> scaled = B * 2;
+        const Matrix<T> sum = A + scaled;
+        D = sum - C;
+    }
+    auto t1 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            D(i, j) = A(i, j) + B(i, j) * 2 - C(i, j);
+    auto t2 = Clock::now();
+    D = A + B * 2 - C;
+    auto t3 = Clock::now();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << " (D(0, 0) = " << D(0, 0) << ")" << endl;
+    cout << "Temporaries:       " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "operator() loop:   " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Fused expression:  " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileElementwiseOperations() {
+    const size_t size = 4096;
+    const Matrix<T> A(size, size, 3), B(size, size, 2), bias(1, size, 1);
+    Matrix<T> D(size, size, 0);
+
+    //Clamp(A * B + bias row, 0, 10) as a hand-written loop and as one expression.
+    auto t0 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            D(i, j) = std::min(std::max(T(A(i, j) * B(i, j) + bias(0, j)), T(0)), T(10));
+    auto t1 = Clock::now();
+    D = Clamp(Hadamard(A, B) + BroadcastRow(bias, size), 0, 10);
+    auto t2 = Clock::now();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << " (D(0, 0) = " << D(0, 0) << ")" << endl;
+    cout << "operator() loop:  " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Expression:       " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileReductions() {
+    const size_t size = 4096;
+    Matrix<T> A(size, size, 1);
+
+    //Whole-matrix and per-row sums, as loops over operator() and as reductions.
+    T loopSum = 0;
+    auto t0 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            loopSum += A(i, j);
+    auto t1 = Clock::now();
+    const T sum = Sum(A);
+    auto t2 = Clock::now();
+    Matrix<T> loopRows(size, 1, 0);
+    for(size_t i = 0; i < size; i++)
+        for(size_t j = 0; j < size; j++)
+            loopRows(i, 0) += A(i, j);
+    auto t3 = Clock::now();
+    const Matrix<T> rows = RowSums(A);
+    auto t4 = Clock::now();
+    const Matrix<T> columns = ColumnSums(A);
+    auto t5 = Clock::now();
+
+    cout << endl;
+    cout << "Matrix is " << size << 'x' << size << " (sums " << loopSum << ", " << sum << ", " << loopRows(0, 0) << ", " << rows(0, 0)
+         << ", " << columns(0, 0) << ")" << endl;
+    cout << "Sum, operator() loop:      " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Sum():                     " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Row sums, operator() loop: " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+    cout << "RowSums():                 " << chrono::duration_cast<chrono::microseconds>(t4 - t3).count() / 1000.f << " ms" << endl;
+    cout << "ColumnSums():              " << chrono::duration_cast<chrono::microseconds>(t5 - t4).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileTranscendentals() {
+    const size_t size = 2048;
+    const Matrix<T> A(size, size, T(0.5));
+    Matrix<T> D(size, size, 0);
+
+    //Exp and Sigmoid as loops over the standard library and as expressions.
+    auto t0 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            D(i, j) = std::exp(A(i, j));
+    auto t1 = Clock::now();
+    D = Exp(A);
+    auto t2 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            D(i, j) = T(1) / (T(1) + std::exp(-A(i, j)));
+    auto t3 = Clock::now();
+    D = Sigmoid(A);
+    auto t4 = Clock::now();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << " (D(0, 0) = " << D(0, 0) << ")" << endl;
+    cout << "std::exp loop:      " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Exp:                " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Sigmoid loop:       " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+    cout << "Sigmoid:            " << chrono::duration_cast<chrono::microseconds>(t4 - t3).count() / 1000.f << " ms" << endl;
+}
+
+template <class T>
+void profileScans() {
+    const size_t size = 4096;
+    const Matrix<T> A(size, size, 1);
+    Matrix<T> D(size, size, 0);
+
+    //Column scans, row scans and integral images as loops over operator() and as scans.
+    auto t0 = Clock::now();
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            D(i, j) = (i > 0 ? D(i - 1, j) : T(0)) + A(i, j);
+    auto t1 = Clock::now();
+    D = InclusiveColumnScan(A);
+    auto t2 = Clock::now();
+    for(size_t i = 0; i < size; i++)
+        for(size_t j = 0; j < size; j++)
+            D(i, j) = (j > 0 ? D(i, j - 1) : T(0)) + A(i, j);
+    auto t3 = Clock::now();
+    D = InclusiveRowScan(A);
+    auto t4 = Clock::now();
+    D = IntegralImage(A);
+    auto t5 = Clock::now();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << " (D(1, 1) = " << D(1, 1) << ")" << endl;
+    cout << "Column loop:      " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Column scan:      " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Row loop:         " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+    cout << "Row scan:         " << chrono::duration_cast<chrono::microseconds>(t4 - t3).count() / 1000.f << " ms" << endl;
+    cout << "Integral image:   " << chrono::duration_cast<chrono::microseconds>(t5 - t4).count() / 1000.f << " ms" << endl;
+}
+
+template<class T>
+void profileGatherScatter() {
+    const size_t size = 4096;
+    Matrix<T> A(size, size, 1);
+    const Matrix<T, RowMajor> ARow(A.View());
+    Matrix<T> D;
+    std::vector<size_t> indices(size);
+    for(size_t k = 0; k < size; k++)
+        indices[k] = (k * 2654435761u) % size;
+
+    //Row and column gathers as loops over operator() and as gathers, then in-place permutations.
+    auto t0 = Clock::now();
+    Matrix<T> L(size, size, Uninitialized);
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            L(i, j) = A(indices[i], j);
+    auto t1 = Clock::now();
+    D = GatherRows(A, indices);
+    auto t2 = Clock::now();
+    D = GatherRows(ARow, indices);
+    auto t3 = Clock::now();
+    D = GatherColumns(A, indices);
+    auto t4 = Clock::now();
+    for(size_t k = 0; k < size; k++)
+        indices[k] = size - 1 - k;
+    PermuteRows(A, indices);
+    auto t5 = Clock::now();
+    PermuteColumns(A, indices);
+    auto t6 = Clock::now();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << " (D(1, 1) = " << D(1, 1) + L(1, 1) << ")" << endl;
+    cout << "Row loop:               " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Row gather:             " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Row gather (row-major): " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+    cout << "Column gather:          " << chrono::duration_cast<chrono::microseconds>(t4 - t3).count() / 1000.f << " ms" << endl;
+    cout << "Row permutation:        " << chrono::duration_cast<chrono::microseconds>(t5 - t4).count() / 1000.f << " ms" << endl;
+    cout << "Column permutation:     " << chrono::duration_cast<chrono::microseconds>(t6 - t5).count() / 1000.f << " ms" << endl;
+}
+
+template<class T>
+void profileConcatenation() {
+    const size_t size = 2048;
+    const Matrix<T> A(size, size, 1), B(size, size, 2);
+    const Matrix<T, RowMajor> BRow(B.View());
+
+    //Stacking as loops over operator() and as stacks, then splitting.
+    auto t0 = Clock::now();
+    Matrix<T> L(size, 2 * size, Uninitialized);
+    for(size_t j = 0; j < size; j++)
+        for(size_t i = 0; i < size; i++)
+            L(i, j) = A(i, j), L(i, size + j) = B(i, j);
+    auto t1 = Clock::now();
+    const Matrix<T> wide = HorizontalStack(A, B);
+    auto t2 = Clock::now();
+    const Matrix<T> mixed = HorizontalStack(A, BRow);
+    auto t3 = Clock::now();
+    const Matrix<T> tall = VerticalStack(A, B);
+    auto t4 = Clock::now();
+    const std::vector<Matrix<T>> parts = SplitColumns(wide, std::vector<size_t>{size, size});
+    auto t5 = Clock::now();
+
+    cout << endl;
+    cout << "Matrices are " << size << 'x' << size << " (sum of corners = "
+         << L(1, 1) + wide(1, 1) + mixed(1, 1) + tall(1, 1) + parts[1](1, 1) << ")" << endl;
+    cout << "Loop:                     " << chrono::duration_cast<chrono::microseconds>(t1 - t0).count() / 1000.f << " ms" << endl;
+    cout << "Side by side:             " << chrono::duration_cast<chrono::microseconds>(t2 - t1).count() / 1000.f << " ms" << endl;
+    cout << "Side by side (row-major): " << chrono::duration_cast<chrono::microseconds>(t3 - t2).count() / 1000.f << " ms" << endl;
+    cout << "One above the other:      " << chrono::duration_cast<chrono::microseconds>(t4 - t3).count() / 1000.f << " ms" << endl;
+    cout << "Split:                    " << chrono::duration_cast<chrono::microseconds>(t5 - t4).count() / 1000.f << " ms" << endl;
+}
+
 template <class T> Matrix<T> generateMatrix() {
     static int rows = 100;
     static int columns = 100;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Storage order policies for Matrix.
+ *
+ * A matrix is stored as a set of contiguous lines (columns for column-major, rows for
+ * row-major), consecutive lines starting the leading dimension apart. The storage of a
+ * row-major matrix is exactly the column-major storage of its transpose, which is how the
+ * column-major kernels serve both orders.
+ */
+
+/// Each column is contiguous. The default, and the layout of the original Matrix.
+struct ColumnMajor
+{
+    /// Length of one contiguous line.
+    static size_t LineLength(size_t rows, size_t) { return rows; }
+    /// Number of lines.
+    static size_t LineCount(size_t, size_t cols) { return cols; }
+    static size_t Index(size_t row, size_t col, size_t ld) { return col * ld + row; }
+    static size_t RowStride(size_t) { return 1; }
+    static size_t ColumnStride(size_t ld) { return ld; }
+    /// The view whose column-major layout is this order's layout of view.
+    template <class View>
+    static View AsColumnMajor(const View & view) { return view; }
+};
+
+/// Each row is contiguous.
+struct RowMajor
+{
+    static size_t LineLength(size_t, size_t cols) { return cols; }
+    static size_t LineCount(size_t rows, size_t) { return rows; }
+    static size_t Index(size_t row, size_t col, size_t ld) { return row * ld + col; }
+    static size_t RowStride(size_t ld) { return ld; }
+    static size_t ColumnStride(size_t) { return 1; }
+    template <class View>
+    static View AsColumnMajor(const View & view) { return view.Transpose(); }
+};
+
+template <class T, class Order = ColumnMajor> class Matrix;
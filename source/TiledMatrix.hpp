@@ -0,0 +1,332 @@
+#pragma once
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <utility>
+#include "Matrix.hpp"
+
+/// The order tiles are laid out in memory.
+enum class TileOrder {
+    /// Down each column of tiles, then across.
+    ColumnMajor,
+    /// Across each row of tiles, then down.
+    RowMajor,
+    /// Z-order: tiles that are close in both directions are close in memory at every scale.
+    Morton
+};
+
+namespace MatrixKernels {
+
+/// Interleaves the bits of row and col (row in the odd bits) into a Z-order index.
+inline uint64_t MortonCode(uint32_t row, uint32_t col) {
+    auto spread = [](uint64_t x) {
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return x;
+    };
+    return (spread(row) << 1) | spread(col);
+}
+
+/// c += a * b for column-major Tile x Tile blocks, as one contiguous column AXPY per element of b.
+template <class T, size_t Tile>
+inline void MultiplyTile(const T * a, const T * b, T * c) {
+    for(size_t j = 0; j < Tile; j++) {
+        for(size_t k = 0; k < Tile; k++)
+            Axpy(b[k + j * Tile], a + k * Tile, c + j * Tile, Tile);
+    }
+}
+
+} // namespace MatrixKernels
+
+/**
+ * A matrix stored as a grid of Tile x Tile blocks, each contiguous and column-major inside.
+ * Whole tiles are the unit of every kernel, so blocked algorithms read each operand tile as one
+ * short contiguous run instead of Tile strided columns, and nothing needs packing first.
+ * Tiles on the bottom and right edges are padded with zeros to full size; the kernels rely
+ * on that to treat every tile alike.
+ *
+ * This is a separate class rather than another Matrix storage policy, because no single pair
+ * of strides describes tiled storage, so it can't be handed out as a MatrixView. Use
+ * TileView() for one tile, or convert with the view constructor and ToMatrix().
+ */
+template <class T, size_t Tile = 32>
+class TiledMatrix
+{
+    static_assert(Tile > 0 && (Tile & (Tile - 1)) == 0, "The tile size must be a power of two");
+    static_assert(std::is_trivially_copyable<T>::value, "Matrix elements are moved around as raw memory");
+
+public:
+    /// Elements per tile, padding included.
+    static const size_t kTileElements = Tile * Tile;
+
+    TiledMatrix(size_t numRows = 4, size_t numCols = 4, T defaultValue = 0, TileOrder order = TileOrder::Morton,
+                MatrixKernels::MemoryResource * resource = nullptr);
+    /// Copies any view into tiled storage.
+    template <class U, class = typename std::enable_if<std::is_same<typename std::remove_const<U>::type, T>::value>::type>
+    explicit TiledMatrix(const MatrixView<U> & view, TileOrder order = TileOrder::Morton,
+                         MatrixKernels::MemoryResource * resource = nullptr);
+    /// The copy allocates from the calling thread's default resource, like a Matrix copy.
+    TiledMatrix(const TiledMatrix & other);
+    TiledMatrix(TiledMatrix && other) noexcept;
+    ~TiledMatrix();
+    TiledMatrix & operator=(TiledMatrix other) noexcept;
+    void Swap(TiledMatrix & other) noexcept;
+
+    /// Fetches the element at the given coordinates, checked as BoundsChecking<T> says.
+    const T & operator()(size_t row, size_t col) const {
+        if(BoundsChecking<T>::value) MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+        return GetUnchecked(row, col);
+    }
+    /// Fetches the element at the given coordinates, checked as BoundsChecking<T> says.
+    T & operator()(size_t row, size_t col) {
+        if(BoundsChecking<T>::value) MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+        return GetUnchecked(row, col);
+    }
+    /// Fetches the element at the given coordinates
+    const T & Get(size_t row, size_t col) const;
+    /// Fetches the element at the given coordinates
+    T & Get(size_t row, size_t col);
+    /// Fetches the element at the given coordinates, which must be in range.
+    const T & GetUnchecked(size_t row, size_t col) const { return TileData(row / Tile, col / Tile)[(row % Tile) + (col % Tile) * Tile]; }
+    /// Fetches the element at the given coordinates, which must be in range.
+    T & GetUnchecked(size_t row, size_t col) { return TileData(row / Tile, col / Tile)[(row % Tile) + (col % Tile) * Tile]; }
+
+    size_t Rows() const { return m_rows; }
+    size_t Columns() const { return m_columns; }
+    /// Number of tiles down a column of tiles.
+    size_t TileRows() const { return m_tileRows; }
+    /// Number of tiles across a row of tiles.
+    size_t TileColumns() const { return m_tileColumns; }
+    TileOrder Order() const { return m_order; }
+    /// The resource the tiles are allocated from.
+    MatrixKernels::MemoryResource * Resource() const { return m_resource; }
+
+    /// Pointer to the Tile x Tile column-major block holding element (tileRow * Tile, tileCol * Tile).
+    T * TileData(size_t tileRow, size_t tileCol) { return m_data + Slot(tileRow, tileCol) * kTileElements; }
+    const T * TileData(size_t tileRow, size_t tileCol) const { return m_data + Slot(tileRow, tileCol) * kTileElements; }
+    /// View of the real (unpadded) elements of one tile.
+    MatrixView<T> TileView(size_t tileRow, size_t tileCol);
+    MatrixView<const T> TileView(size_t tileRow, size_t tileCol) const;
+
+    /// Copies the elements into an ordinary matrix.
+    template <class Order = ColumnMajor>
+    Matrix<T, Order> ToMatrix() const;
+    /// Returns the transpose, with the same tile order. Each tile is transposed on its own.
+    TiledMatrix Transpose() const;
+    /// Tile by tile product. Tiles of C are computed independently and in parallel.
+    TiledMatrix operator*(const TiledMatrix & rhs) const;
+
+private:
+    /// Position of a tile in storage, in units of tiles.
+    size_t Slot(size_t tileRow, size_t tileCol) const { return m_slots[tileRow + tileCol * m_tileRows]; }
+    /// Sets the dimensions, builds the tile slot table and allocates uninitialized storage.
+    void Allocate(size_t numRows, size_t numCols);
+
+    size_t m_rows = 0;
+    size_t m_columns = 0;
+    size_t m_tileRows = 0;
+    size_t m_tileColumns = 0;
+    TileOrder m_order;
+    /// Slot of each tile, indexed column-major by tile coordinate.
+    std::vector<size_t> m_slots;
+    T * m_data = nullptr;
+    MatrixKernels::MemoryResource * m_resource;
+};
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile>::TiledMatrix(size_t numRows, size_t numCols, T defaultValue, TileOrder order,
+                                  MatrixKernels::MemoryResource * resource)
+: m_order(order), m_resource(resource ? resource : MatrixKernels::DefaultResource()) {
+    Allocate(numRows, numCols);
+    //Only the real elements get the value; the edge padding has to stay zero.
+    MatrixKernels::Fill(m_data, m_tileRows * m_tileColumns * kTileElements, T(0));
+    if(defaultValue != T(0)) {
+        for(size_t tj = 0; tj < m_tileColumns; tj++) {
+            for(size_t ti = 0; ti < m_tileRows; ti++) {
+                MatrixView<T> tile = TileView(ti, tj);
+                for(size_t j = 0; j < tile.Columns(); j++)
+                    std::fill(tile.Data() + j * Tile, tile.Data() + j * Tile + tile.Rows(), defaultValue);
+            }
+        }
+    }
+}
+
+template <class T, size_t Tile>
+template <class U, class>
+TiledMatrix<T, Tile>::TiledMatrix(const MatrixView<U> & view, TileOrder order, MatrixKernels::MemoryResource * resource)
+: m_order(order), m_resource(resource ? resource : MatrixKernels::DefaultResource()) {
+    Allocate(view.Rows(), view.Columns());
+    const MatrixView<const T> src(view);
+
+    #pragma omp parallel for schedule(static) if(m_rows * m_columns >= MatrixKernels::kTransposeParallelThreshold)
+    for(size_t t = 0; t < m_tileRows * m_tileColumns; t++) {
+        const size_t ti = t % m_tileRows, tj = t / m_tileRows;
+        T * tile = TileData(ti, tj);
+        std::fill(tile, tile + kTileElements, T(0));
+        const size_t h = std::min(Tile, m_rows - ti * Tile);
+        const size_t w = std::min(Tile, m_columns - tj * Tile);
+        const MatrixView<const T> block(src.Data() + ti * Tile * src.RowStride() + tj * Tile * src.ColumnStride(),
+                                        h, w, src.RowStride(), src.ColumnStride());
+        MatrixKernels::CopyToColumnMajor(block, tile, Tile);
+    }
+}
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile>::TiledMatrix(const TiledMatrix & other)
+: m_rows(other.m_rows), m_columns(other.m_columns), m_tileRows(other.m_tileRows), m_tileColumns(other.m_tileColumns),
+  m_order(other.m_order), m_slots(other.m_slots), m_resource(MatrixKernels::DefaultResource()) {
+    const size_t count = m_tileRows * m_tileColumns * kTileElements;
+    m_data = static_cast<T *>(m_resource->Allocate(count * sizeof(T)));
+    MatrixKernels::Copy(other.m_data, m_data, count);
+}
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile>::TiledMatrix(TiledMatrix && other) noexcept
+: m_rows(other.m_rows), m_columns(other.m_columns), m_tileRows(other.m_tileRows), m_tileColumns(other.m_tileColumns),
+  m_order(other.m_order), m_slots(std::move(other.m_slots)), m_data(other.m_data), m_resource(other.m_resource) {
+    other.m_rows = other.m_columns = other.m_tileRows = other.m_tileColumns = 0;
+    other.m_data = nullptr;
+}
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile>::~TiledMatrix() {
+    if(m_data)
+        m_resource->Deallocate(m_data, m_tileRows * m_tileColumns * kTileElements * sizeof(T));
+}
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile> & TiledMatrix<T, Tile>::operator=(TiledMatrix other) noexcept {
+    Swap(other);
+    return *this;
+}
+
+template <class T, size_t Tile>
+void TiledMatrix<T, Tile>::Swap(TiledMatrix & other) noexcept {
+    std::swap(m_rows, other.m_rows);
+    std::swap(m_columns, other.m_columns);
+    std::swap(m_tileRows, other.m_tileRows);
+    std::swap(m_tileColumns, other.m_tileColumns);
+    std::swap(m_order, other.m_order);
+    m_slots.swap(other.m_slots);
+    std::swap(m_data, other.m_data);
+    std::swap(m_resource, other.m_resource);
+}
+
+template <class T, size_t Tile>
+void TiledMatrix<T, Tile>::Allocate(size_t numRows, size_t numCols) {
+    if(numRows * numCols == 0) throw std::invalid_argument("Error. Cannot create matrix with 0 dimension(s)");
+
+    m_rows = numRows;
+    m_columns = numCols;
+    m_tileRows = (numRows + Tile - 1) / Tile;
+    m_tileColumns = (numCols + Tile - 1) / Tile;
+    const size_t tiles = m_tileRows * m_tileColumns;
+
+    //Rank the tiles in the requested order. Z-order ranks by Morton code, which keeps the
+    //storage dense for any grid shape, not just powers of two.
+    std::vector<std::pair<uint64_t, size_t>> keys(tiles);
+    for(size_t tj = 0; tj < m_tileColumns; tj++) {
+        for(size_t ti = 0; ti < m_tileRows; ti++) {
+            uint64_t key = 0;
+            switch(m_order) {
+                case TileOrder::ColumnMajor: key = tj * m_tileRows + ti; break;
+                case TileOrder::RowMajor: key = ti * m_tileColumns + tj; break;
+                case TileOrder::Morton: key = MatrixKernels::MortonCode(uint32_t(ti), uint32_t(tj)); break;
+            }
+            keys[ti + tj * m_tileRows] = std::make_pair(key, ti + tj * m_tileRows);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    m_slots.resize(tiles);
+    for(size_t slot = 0; slot < tiles; slot++)
+        m_slots[keys[slot].second] = slot;
+
+    m_data = static_cast<T *>(m_resource->Allocate(tiles * kTileElements * sizeof(T)));
+}
+
+template <class T, size_t Tile>
+const T & TiledMatrix<T, Tile>::Get(size_t row, size_t col) const {
+    MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+    return GetUnchecked(row, col);
+}
+
+template <class T, size_t Tile>
+T & TiledMatrix<T, Tile>::Get(size_t row, size_t col) {
+    MatrixKernels::CheckBounds(row, col, m_rows, m_columns);
+    return GetUnchecked(row, col);
+}
+
+template <class T, size_t Tile>
+MatrixView<T> TiledMatrix<T, Tile>::TileView(size_t tileRow, size_t tileCol) {
+    return MatrixView<T>(TileData(tileRow, tileCol), std::min(Tile, m_rows - tileRow * Tile),
+                         std::min(Tile, m_columns - tileCol * Tile), 1, Tile);
+}
+
+template <class T, size_t Tile>
+MatrixView<const T> TiledMatrix<T, Tile>::TileView(size_t tileRow, size_t tileCol) const {
+    return MatrixView<const T>(TileData(tileRow, tileCol), std::min(Tile, m_rows - tileRow * Tile),
+                               std::min(Tile, m_columns - tileCol * Tile), 1, Tile);
+}
+
+template <class T, size_t Tile>
+template <class Order>
+Matrix<T, Order> TiledMatrix<T, Tile>::ToMatrix() const {
+    Matrix<T, Order> result(m_rows, m_columns, Uninitialized);
+    MatrixView<T> dst = result.View();
+
+    #pragma omp parallel for schedule(static) if(m_rows * m_columns >= MatrixKernels::kTransposeParallelThreshold)
+    for(size_t t = 0; t < m_tileRows * m_tileColumns; t++) {
+        const size_t ti = t % m_tileRows, tj = t / m_tileRows;
+        const MatrixView<const T> tile = TileView(ti, tj);
+        T * corner = dst.Data() + ti * Tile * dst.RowStride() + tj * Tile * dst.ColumnStride();
+        //Write the tile through the layout of the destination, as column-major storage.
+        if(dst.RowStride() == 1)
+            MatrixKernels::CopyToColumnMajor(tile, corner, dst.ColumnStride());
+        else
+            MatrixKernels::CopyToColumnMajor(tile.Transpose(), corner, dst.RowStride());
+    }
+    return result;
+}
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile> TiledMatrix<T, Tile>::Transpose() const {
+    TiledMatrix result(m_columns, m_rows, 0, m_order, m_resource);
+
+    //Whole tiles, padding included: the zero padding of a transposed edge tile is still
+    //exactly where the transposed edge tile needs it.
+    #pragma omp parallel for schedule(static) if(m_rows * m_columns >= MatrixKernels::kTransposeParallelThreshold)
+    for(size_t t = 0; t < m_tileRows * m_tileColumns; t++) {
+        const size_t ti = t % m_tileRows, tj = t / m_tileRows;
+        MatrixKernels::TransposeTile(TileData(ti, tj), Tile, result.TileData(tj, ti), Tile, Tile, Tile);
+    }
+    return result;
+}
+
+template <class T, size_t Tile>
+TiledMatrix<T, Tile> TiledMatrix<T, Tile>::operator*(const TiledMatrix & rhs) const {
+    if(m_columns != rhs.m_rows)
+        throw std::invalid_argument("Invalid argument. Width (columns) of first matrix must match height (rows) of second matrix");
+
+    TiledMatrix result(m_rows, rhs.m_columns, 0, m_order, m_resource);
+    const size_t depth = m_tileColumns;
+
+    //C(ti, tj) += A(ti, p) * B(p, tj) over whole tiles. Every operand is a contiguous
+    //column-major block, so the inner loop is a plain column AXPY with no packing. The
+    //zero padding adds nothing to the sums.
+    #pragma omp parallel for schedule(static) if(m_rows * m_columns * rhs.m_columns >= MatrixKernels::kMultiplyParallelThreshold)
+    for(size_t t = 0; t < result.m_tileRows * result.m_tileColumns; t++) {
+        const size_t ti = t % result.m_tileRows, tj = t / result.m_tileRows;
+        T * c = result.TileData(ti, tj);
+        for(size_t p = 0; p < depth; p++) {
+            const T * a = TileData(ti, p);
+            const T * b = rhs.TileData(p, tj);
+            MatrixKernels::MultiplyTile<T, Tile>(a, b, c);
+        }
+    }
+    return result;
+}
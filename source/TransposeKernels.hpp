@@ -0,0 +1,549 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <type_traits>
+#include "MemoryKernels.hpp"
+#include "MemoryResource.hpp"
+#ifdef USE_INTRINSICS
+#include "xmmintrin.h"
+#include "emmintrin.h"
+#ifdef __AVX__
+#include "immintrin.h"
+#endif
+#endif
+
+/**
+ * Raw-pointer transpose kernels shared by the Matrix class.
+ *
+ * Every routine works on a column-major source of m rows and n columns whose
+ * columns are lds elements apart, and writes its n x m transpose into a
+ * column-major destination whose columns are ldd elements apart.
+ * No bounds checking is done here; callers are expected to have validated shapes.
+ */
+namespace MatrixKernels {
+
+/// Largest block (in either dimension) the recursion hands to the tile loop.
+/// A 64x64 block of 8 byte values is 32 KB for the source plus 32 KB for the destination.
+const size_t kTransposeLeaf = 64;
+/// Side of the blocks distributed across threads.
+const size_t kTransposeBlock = 256;
+/// Below this many elements the whole transpose runs on the calling thread.
+const size_t kTransposeParallelThreshold = 128 * 128;
+/// Number of strided columns gathered together by the in-place rectangular transpose,
+/// so every cache line that is pulled in gets fully used.
+const size_t kInPlaceColumnGroup = 16;
+/// Length of the destination column segments written by the streaming transpose.
+const size_t kTransposeStreamSegment = 512;
+
+/// Plain element-by-element transpose, used for remainders and non-arithmetic types.
+template <class T>
+inline void TransposeScalar(const T * src, size_t lds, T * dst, size_t ldd, size_t m, size_t n) {
+    for (size_t j = 0; j < n; j++) {
+        const T * srcCol = src + j * lds;
+        for (size_t i = 0; i < m; i++)
+            dst[j + i * ldd] = srcCol[i];
+    }
+}
+
+/**
+ * Transposes a single Width x Width square held in registers.
+ * Specializations are picked by element size, since the shuffles only move bits around.
+ * Available tells whether this build has a kernel for the requested width.
+ */
+template <class T, size_t Width, size_t Bytes = (std::is_arithmetic<T>::value ? sizeof(T) : 0)>
+struct RegisterTranspose {
+    static const bool Available = false;
+    static void Run(const T *, size_t, T *, size_t) {}
+};
+
+/// A 1x1 transpose is a plain copy, so it is always available.
+template <class T, size_t Bytes>
+struct RegisterTranspose<T, 1, Bytes> {
+    static const bool Available = true;
+    static void Run(const T * src, size_t, T * dst, size_t) { *dst = *src; }
+};
+
+#ifdef USE_INTRINSICS
+
+/// 8x8 block of 16 bit values (short), three rounds of SSE2 unpacks.
+template <class T>
+struct RegisterTranspose<T, 8, 2> {
+    static const bool Available = true;
+    static void Run(const T * src, size_t lds, T * dst, size_t ldd) {
+        __m128i a0 = _mm_loadu_si128((const __m128i *)(src));
+        __m128i a1 = _mm_loadu_si128((const __m128i *)(src + lds));
+        __m128i a2 = _mm_loadu_si128((const __m128i *)(src + 2 * lds));
+        __m128i a3 = _mm_loadu_si128((const __m128i *)(src + 3 * lds));
+        __m128i a4 = _mm_loadu_si128((const __m128i *)(src + 4 * lds));
+        __m128i a5 = _mm_loadu_si128((const __m128i *)(src + 5 * lds));
+        __m128i a6 = _mm_loadu_si128((const __m128i *)(src + 6 * lds));
+        __m128i a7 = _mm_loadu_si128((const __m128i *)(src + 7 * lds));
+
+        //Interleave pairs of columns 16 bits at a time...
+        __m128i b0 = _mm_unpacklo_epi16(a0, a1);
+        __m128i b1 = _mm_unpackhi_epi16(a0, a1);
+        __m128i b2 = _mm_unpacklo_epi16(a2, a3);
+        __m128i b3 = _mm_unpackhi_epi16(a2, a3);
+        __m128i b4 = _mm_unpacklo_epi16(a4, a5);
+        __m128i b5 = _mm_unpackhi_epi16(a4, a5);
+        __m128i b6 = _mm_unpacklo_epi16(a6, a7);
+        __m128i b7 = _mm_unpackhi_epi16(a6, a7);
+        //...then 32 bits at a time...
+        __m128i c0 = _mm_unpacklo_epi32(b0, b2);
+        __m128i c1 = _mm_unpackhi_epi32(b0, b2);
+        __m128i c2 = _mm_unpacklo_epi32(b1, b3);
+        __m128i c3 = _mm_unpackhi_epi32(b1, b3);
+        __m128i c4 = _mm_unpacklo_epi32(b4, b6);
+        __m128i c5 = _mm_unpackhi_epi32(b4, b6);
+        __m128i c6 = _mm_unpacklo_epi32(b5, b7);
+        __m128i c7 = _mm_unpackhi_epi32(b5, b7);
+        //...and finally 64 bits at a time, which leaves one source row per register.
+        _mm_storeu_si128((__m128i *)(dst), _mm_unpacklo_epi64(c0, c4));
+        _mm_storeu_si128((__m128i *)(dst + ldd), _mm_unpackhi_epi64(c0, c4));
+        _mm_storeu_si128((__m128i *)(dst + 2 * ldd), _mm_unpacklo_epi64(c1, c5));
+        _mm_storeu_si128((__m128i *)(dst + 3 * ldd), _mm_unpackhi_epi64(c1, c5));
+        _mm_storeu_si128((__m128i *)(dst + 4 * ldd), _mm_unpacklo_epi64(c2, c6));
+        _mm_storeu_si128((__m128i *)(dst + 5 * ldd), _mm_unpackhi_epi64(c2, c6));
+        _mm_storeu_si128((__m128i *)(dst + 6 * ldd), _mm_unpacklo_epi64(c3, c7));
+        _mm_storeu_si128((__m128i *)(dst + 7 * ldd), _mm_unpackhi_epi64(c3, c7));
+    }
+};
+
+/// 4x4 block of 32 bit values (float, int, unsigned int) in SSE registers.
+template <class T>
+struct RegisterTranspose<T, 4, 4> {
+    static const bool Available = true;
+    static void Run(const T * src, size_t lds, T * dst, size_t ldd) {
+        const float * s = reinterpret_cast<const float *>(src);
+        float * d = reinterpret_cast<float *>(dst);
+        __m128 c0 = _mm_loadu_ps(s);
+        __m128 c1 = _mm_loadu_ps(s + lds);
+        __m128 c2 = _mm_loadu_ps(s + 2 * lds);
+        __m128 c3 = _mm_loadu_ps(s + 3 * lds);
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(d, c0);
+        _mm_storeu_ps(d + ldd, c1);
+        _mm_storeu_ps(d + 2 * ldd, c2);
+        _mm_storeu_ps(d + 3 * ldd, c3);
+    }
+};
+
+/// 2x2 block of 64 bit values (double, long) in SSE2 registers.
+template <class T>
+struct RegisterTranspose<T, 2, 8> {
+    static const bool Available = true;
+    static void Run(const T * src, size_t lds, T * dst, size_t ldd) {
+        const double * s = reinterpret_cast<const double *>(src);
+        double * d = reinterpret_cast<double *>(dst);
+        __m128d c0 = _mm_loadu_pd(s);
+        __m128d c1 = _mm_loadu_pd(s + lds);
+        _mm_storeu_pd(d, _mm_unpacklo_pd(c0, c1));
+        _mm_storeu_pd(d + ldd, _mm_unpackhi_pd(c0, c1));
+    }
+};
+
+#ifdef __AVX__
+
+/// 8x8 block of 32 bit values (float, int, unsigned int) in AVX registers.
+template <class T>
+struct RegisterTranspose<T, 8, 4> {
+    static const bool Available = true;
+    static void Run(const T * src, size_t lds, T * dst, size_t ldd) {
+        const float * s = reinterpret_cast<const float *>(src);
+        float * d = reinterpret_cast<float *>(dst);
+        __m256 r0 = _mm256_loadu_ps(s);
+        __m256 r1 = _mm256_loadu_ps(s + lds);
+        __m256 r2 = _mm256_loadu_ps(s + 2 * lds);
+        __m256 r3 = _mm256_loadu_ps(s + 3 * lds);
+        __m256 r4 = _mm256_loadu_ps(s + 4 * lds);
+        __m256 r5 = _mm256_loadu_ps(s + 5 * lds);
+        __m256 r6 = _mm256_loadu_ps(s + 6 * lds);
+        __m256 r7 = _mm256_loadu_ps(s + 7 * lds);
+
+        __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+        __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+        __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+        __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+        __m256 t4 = _mm256_unpacklo_ps(r4, r5);
+        __m256 t5 = _mm256_unpackhi_ps(r4, r5);
+        __m256 t6 = _mm256_unpacklo_ps(r6, r7);
+        __m256 t7 = _mm256_unpackhi_ps(r6, r7);
+
+        __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+        __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+        __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+        //The 128 bit lanes still hold rows 0-3 and 4-7 separately, so swap halves.
+        _mm256_storeu_ps(d, _mm256_permute2f128_ps(u0, u4, 0x20));
+        _mm256_storeu_ps(d + ldd, _mm256_permute2f128_ps(u1, u5, 0x20));
+        _mm256_storeu_ps(d + 2 * ldd, _mm256_permute2f128_ps(u2, u6, 0x20));
+        _mm256_storeu_ps(d + 3 * ldd, _mm256_permute2f128_ps(u3, u7, 0x20));
+        _mm256_storeu_ps(d + 4 * ldd, _mm256_permute2f128_ps(u0, u4, 0x31));
+        _mm256_storeu_ps(d + 5 * ldd, _mm256_permute2f128_ps(u1, u5, 0x31));
+        _mm256_storeu_ps(d + 6 * ldd, _mm256_permute2f128_ps(u2, u6, 0x31));
+        _mm256_storeu_ps(d + 7 * ldd, _mm256_permute2f128_ps(u3, u7, 0x31));
+    }
+};
+
+/// 4x4 block of 64 bit values (double, long) in AVX registers.
+template <class T>
+struct RegisterTranspose<T, 4, 8> {
+    static const bool Available = true;
+    static void Run(const T * src, size_t lds, T * dst, size_t ldd) {
+        const double * s = reinterpret_cast<const double *>(src);
+        double * d = reinterpret_cast<double *>(dst);
+        __m256d r0 = _mm256_loadu_pd(s);
+        __m256d r1 = _mm256_loadu_pd(s + lds);
+        __m256d r2 = _mm256_loadu_pd(s + 2 * lds);
+        __m256d r3 = _mm256_loadu_pd(s + 3 * lds);
+
+        __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+        __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+        __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+        __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+        _mm256_storeu_pd(d, _mm256_permute2f128_pd(t0, t2, 0x20));
+        _mm256_storeu_pd(d + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+        _mm256_storeu_pd(d + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+        _mm256_storeu_pd(d + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+    }
+};
+
+#endif // __AVX__
+#endif // USE_INTRINSICS
+
+/**
+ * Picks the widest register kernel this build has for T whose width divides both R and C.
+ * Leaving R and C at 0 puts no constraint on the width.
+ */
+template <class T, size_t R = 0, size_t C = 0>
+struct WidestRegisterTranspose {
+    template <size_t W>
+    struct Fits {
+        static const bool value = RegisterTranspose<T, W>::Available && R % W == 0 && C % W == 0;
+    };
+    static const size_t Width = Fits<8>::value ? 8 : Fits<4>::value ? 4 : Fits<2>::value ? 2 : 1;
+    typedef RegisterTranspose<T, Width> Kernel;
+};
+
+/// The register kernel used to sweep tiles of any size.
+template <class T>
+struct TransposeMicroKernel : WidestRegisterTranspose<T>::Kernel {
+    static const size_t Width = WidestRegisterTranspose<T>::Width;
+};
+
+/// Transposes a block that fits in cache by sweeping it with the register micro kernel.
+template <class T>
+inline void TransposeTile(const T * src, size_t lds, T * dst, size_t ldd, size_t m, size_t n) {
+    typedef TransposeMicroKernel<T> Kernel;
+    const size_t w = Kernel::Width;
+    if(w == 1) {
+        TransposeScalar(src, lds, dst, ldd, m, n);
+        return;
+    }
+
+    size_t j = 0;
+    for(; j + w <= n; j += w) {
+        size_t i = 0;
+        for(; i + w <= m; i += w)
+            Kernel::Run(src + i + j * lds, lds, dst + j + i * ldd, ldd);
+        //Leftover rows at the bottom of this strip of columns.
+        TransposeScalar(src + i + j * lds, lds, dst + j + i * ldd, ldd, m - i, w);
+    }
+    //Leftover columns on the right.
+    TransposeScalar(src + j * lds, lds, dst + j, ldd, m, n - j);
+}
+
+/**
+ * Cache-oblivious transpose: halve the longer side until the block fits in cache.
+ * Split points are kept on multiples of 8 so the micro kernels never straddle a split.
+ */
+template <class T>
+void TransposeRecursive(const T * src, size_t lds, T * dst, size_t ldd, size_t m, size_t n) {
+    if(m <= kTransposeLeaf && n <= kTransposeLeaf) {
+        TransposeTile(src, lds, dst, ldd, m, n);
+        return;
+    }
+
+    if(m >= n) {
+        size_t mid = (m / 2) & ~size_t(7);
+        TransposeRecursive(src, lds, dst, ldd, mid, n);
+        TransposeRecursive(src + mid, lds, dst + mid * ldd, ldd, m - mid, n);
+    } else {
+        size_t mid = (n / 2) & ~size_t(7);
+        TransposeRecursive(src, lds, dst, ldd, m, mid);
+        TransposeRecursive(src + mid * lds, lds, dst + mid, ldd, m, n - mid);
+    }
+}
+
+/**
+ * Transpose for destinations far larger than the cache. Each L x S block is transposed into a
+ * per-thread scratch tile first, so that long destination column segments (S elements, many
+ * full cache lines) can be written out with streaming stores. Short segments would leave the
+ * write-combining buffers partially filled and end up slower than regular stores.
+ */
+template <class T>
+void TransposeStreaming(const T * src, size_t lds, T * dst, size_t ldd, size_t m, size_t n) {
+    const size_t L = kTransposeLeaf;
+    const size_t S = kTransposeStreamSegment;
+    const size_t blockRows = (m + L - 1) / L;
+    const size_t blockCols = (n + S - 1) / S;
+
+    #pragma omp parallel
+    {
+        AlignedBuffer<T> scratch(L * S);
+
+        //Walking the source columns innermost writes each destination column front to back.
+        #pragma omp for schedule(static)
+        for(size_t bi = 0; bi < blockRows; bi++) {
+            const size_t i = bi * L;
+            const size_t mi = std::min(L, m - i);
+            for(size_t bj = 0; bj < blockCols; bj++) {
+                const size_t j = bj * S;
+                const size_t nj = std::min(S, n - j);
+                TransposeRecursive(src + i + j * lds, lds, scratch.data(), nj, mi, nj);
+                for(size_t c = 0; c < mi; c++)
+                    StreamCopy(scratch.data() + c * nj, dst + j + (i + c) * ldd, nj);
+            }
+        }
+        StreamFence();
+    }
+}
+
+/// Transposes the m x n source into the destination, spreading large jobs over threads.
+template <class T>
+void Transpose(const T * src, size_t lds, T * dst, size_t ldd, size_t m, size_t n) {
+    if(UseStreamingStores<T>(m * n)) {
+        TransposeStreaming(src, lds, dst, ldd, m, n);
+        return;
+    }
+    if(m * n < kTransposeParallelThreshold) {
+        TransposeRecursive(src, lds, dst, ldd, m, n);
+        return;
+    }
+
+    //Each thread takes whole blocks, so no two threads ever write the same cache line
+    //except along block edges.
+    const size_t blockRows = (m + kTransposeBlock - 1) / kTransposeBlock;
+    const size_t blockCols = (n + kTransposeBlock - 1) / kTransposeBlock;
+    const size_t numBlocks = blockRows * blockCols;
+
+    #pragma omp parallel for schedule(static)
+    for(size_t b = 0; b < numBlocks; b++) {
+        const size_t i = (b % blockRows) * kTransposeBlock;
+        const size_t j = (b / blockRows) * kTransposeBlock;
+        const size_t bm = (m - i < kTransposeBlock) ? m - i : kTransposeBlock;
+        const size_t bn = (n - j < kTransposeBlock) ? n - j : kTransposeBlock;
+        TransposeRecursive(src + i + j * lds, lds, dst + j + i * ldd, ldd, bm, bn);
+    }
+}
+
+/**
+ * In-place transpose of an n x n matrix whose columns are ld elements apart.
+ * Blocks above the diagonal are swapped with their mirror blocks below it, going through
+ * a per-thread scratch tile so the SIMD tile kernel can be reused for both halves.
+ */
+template <class T>
+void TransposeInPlaceSquare(T * data, size_t ld, size_t n) {
+    const size_t L = kTransposeLeaf;
+    const size_t numBlocks = (n + L - 1) / L;
+
+    #pragma omp parallel if(n * n >= kTransposeParallelThreshold)
+    {
+        AlignedBuffer<T> scratch(L * L);
+
+        //Later block columns hold more pairs, hence the dynamic schedule.
+        #pragma omp for schedule(dynamic)
+        for(size_t bj = 0; bj < numBlocks; bj++) {
+            const size_t j = bj * L;
+            const size_t nj = std::min(L, n - j);
+            for(size_t bi = 0; bi <= bj; bi++) {
+                const size_t i = bi * L;
+                const size_t mi = std::min(L, n - i);
+                T * upper = data + i + j * ld; // mi x nj block above the diagonal
+                T * lower = data + j + i * ld; // nj x mi mirror block below it
+
+                TransposeTile(upper, ld, scratch.data(), nj, mi, nj);
+                if(bi != bj)
+                    TransposeTile(lower, ld, upper, ld, nj, mi);
+                for(size_t c = 0; c < mi; c++)
+                    std::copy(scratch.data() + c * nj, scratch.data() + (c + 1) * nj, lower + c * ld);
+            }
+        }
+    }
+}
+
+inline size_t GreatestCommonDivisor(size_t a, size_t b) {
+    while(b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * In-place transpose of a contiguous rows x cols column-major matrix, using the decomposition from
+ * Catanzaro, Keller & Garland, "A Decomposition for In-place Matrix Transposition" (PPoPP 2014).
+ *
+ * The buffer is viewed as a row-major m x n array with m = cols and n = rows, so each of its
+ * rows is one of our (contiguous) columns. Its transpose is exactly our transpose, and it can be
+ * done in three passes that each only permute elements within one row or one column of the view:
+ *  1. rotate column j up by j / b (only needed when gcd(m, n) > 1),
+ *  2. scatter each row i with d_i(j) = ((i + j / b) mod m + j * m) mod n,
+ *  3. gather each column j with s_j(i) = (j + i * n - i / a) mod m,
+ * where c = gcd(m, n), a = m / c and b = n / c. Every pass parallelizes over rows or columns and
+ * only needs O(max(m, n)) scratch per thread.
+ */
+template <class T>
+void TransposeInPlaceRectangular(T * data, size_t rows, size_t cols) {
+    const size_t m = cols;
+    const size_t n = rows;
+    const size_t c = GreatestCommonDivisor(m, n);
+    const size_t a = m / c;
+    const size_t b = n / c;
+    const size_t G = kInPlaceColumnGroup;
+    const size_t numGroups = (n + G - 1) / G;
+    const bool parallel = m * n >= kTransposeParallelThreshold;
+    (void)parallel; // Only read by the OpenMP clauses.
+
+    //Pass 1: rotate the strided columns, a group of neighbouring columns at a time.
+    if(c > 1) {
+        #pragma omp parallel if(parallel)
+        {
+            AlignedBuffer<T> scratch(m * G);
+            #pragma omp for schedule(static)
+            for(size_t g = 0; g < numGroups; g++) {
+                const size_t j0 = g * G;
+                const size_t width = std::min(G, n - j0);
+                for(size_t i = 0; i < m; i++) {
+                    for(size_t k = 0; k < width; k++) {
+                        size_t src = i + (j0 + k) / b; // j / b < c <= m, so one wrap at most
+                        if(src >= m) src -= m;
+                        scratch[i * width + k] = data[src * n + j0 + k];
+                    }
+                }
+                for(size_t i = 0; i < m; i++)
+                    std::copy(scratch.data() + i * width, scratch.data() + (i + 1) * width, data + i * n + j0);
+            }
+        }
+    }
+
+    //Pass 2: shuffle within each contiguous row. All the modular arithmetic is incremental.
+    #pragma omp parallel if(parallel)
+    {
+        AlignedBuffer<T> scratch(n);
+        const size_t mModN = m % n;
+        #pragma omp for schedule(static)
+        for(size_t i = 0; i < m; i++) {
+            T * row = data + i * n;
+            size_t jm = 0; // (j * m) mod n
+            for(size_t q = 0; q * b < n; q++) {
+                const size_t rotation = ((i + q) % m) % n;
+                const size_t end = std::min(n, (q + 1) * b);
+                for(size_t j = q * b; j < end; j++) {
+                    size_t d = rotation + jm;
+                    if(d >= n) d -= n;
+                    scratch[d] = row[j];
+                    jm += mModN;
+                    if(jm >= n) jm -= n;
+                }
+            }
+            std::copy(scratch.data(), scratch.data() + n, row);
+        }
+    }
+
+    //Pass 3: gather within the strided columns, again a group of columns at a time.
+    #pragma omp parallel if(parallel)
+    {
+        AlignedBuffer<T> scratch(m * G);
+        AlignedBuffer<size_t> jModM(G);
+        #pragma omp for schedule(static)
+        for(size_t g = 0; g < numGroups; g++) {
+            const size_t j0 = g * G;
+            const size_t width = std::min(G, n - j0);
+            for(size_t k = 0; k < width; k++)
+                jModM[k] = (j0 + k) % m;
+            for(size_t i = 0; i < m; i++) {
+                const size_t base = (i * n - i / a) % m;
+                for(size_t k = 0; k < width; k++) {
+                    size_t src = base + jModM[k];
+                    if(src >= m) src -= m;
+                    scratch[i * width + k] = data[src * n + j0 + k];
+                }
+            }
+            for(size_t i = 0; i < m; i++)
+                std::copy(scratch.data() + i * width, scratch.data() + (i + 1) * width, data + i * n + j0);
+        }
+    }
+}
+
+/// Transposes one R x C matrix with every loop bound known at compile time, so the
+/// register kernels unroll completely.
+template <class T, size_t R, size_t C>
+void TransposeFixed(const T * src, T * dst, size_t, size_t) {
+    typedef WidestRegisterTranspose<T, R, C> Widest;
+    const size_t w = Widest::Width;
+    for(size_t j = 0; j < C; j += w)
+        for(size_t i = 0; i < R; i += w)
+            Widest::Kernel::Run(src + i + j * R, R, dst + j + i * C, C);
+}
+
+/// Transposes one matrix of any shape, for batches without a fixed-size kernel.
+template <class T>
+void TransposeDynamic(const T * src, T * dst, size_t rows, size_t cols) {
+    TransposeTile(src, rows, dst, cols, rows, cols);
+}
+
+/// Signature shared by the per-matrix kernels of the batched transpose.
+template <class T>
+struct BatchTransposeKernel {
+    typedef void (*Type)(const T * src, T * dst, size_t rows, size_t cols);
+};
+
+template <class T, size_t R>
+typename BatchTransposeKernel<T>::Type SelectTransposeFixed(size_t cols) {
+    switch(cols) {
+        case 4: return &TransposeFixed<T, R, 4>;
+        case 8: return &TransposeFixed<T, R, 8>;
+        case 16: return &TransposeFixed<T, R, 16>;
+        case 32: return &TransposeFixed<T, R, 32>;
+        default: return &TransposeDynamic<T>;
+    }
+}
+
+/// Returns the kernel for one rows x cols matrix: unrolled for 4, 8, 16 and 32 in
+/// each dimension, the generic tile loop otherwise.
+template <class T>
+typename BatchTransposeKernel<T>::Type SelectBatchTransposeKernel(size_t rows, size_t cols) {
+    switch(rows) {
+        case 4: return SelectTransposeFixed<T, 4>(cols);
+        case 8: return SelectTransposeFixed<T, 8>(cols);
+        case 16: return SelectTransposeFixed<T, 16>(cols);
+        case 32: return SelectTransposeFixed<T, 32>(cols);
+        default: return &TransposeDynamic<T>;
+    }
+}
+
+/**
+ * Transposes count rows x cols column-major matrices stored back to back in src, writing the
+ * cols x rows results back to back in dst. src and dst must not overlap.
+ * The kernel is chosen once for the whole batch, and threads split the batch between them.
+ */
+template <class T>
+void BatchTranspose(const T * src, T * dst, size_t count, size_t rows, size_t cols) {
+    typename BatchTransposeKernel<T>::Type kernel = SelectBatchTransposeKernel<T>(rows, cols);
+    const size_t size = rows * cols;
+
+    #pragma omp parallel for schedule(static) if(count * size >= kTransposeParallelThreshold)
+    for(size_t b = 0; b < count; b++)
+        kernel(src + b * size, dst + b * size, rows, cols);
+}
+
+} // namespace MatrixKernels